@@ -0,0 +1,99 @@
+//board_hal.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Thin layer over the peripheral calls of the MIDI and display paths, so the
+// same code can run against the hardware (board_hal_esp.c) or against a
+// recorded timeline on Linux (board_hal_linux.c).
+//
+// On the board, inputs and outputs can be recorded into a RAM ring
+// (CONFIG_BOARD_HAL_RECORD) and dumped as a text timeline. On Linux, a
+// timeline is replayed against a virtual clock and every output is captured
+// with the virtual time at which it would have left the board.
+//
+// USB Host transfers are submitted through board_hal_usb_host.h (ESP only).
+
+// ---------------------------------------------------------------------------
+// Timeline events
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    BOARD_HAL_EV_GPIO = 0,      // input level change: arg = pin, data[0] = level
+    BOARD_HAL_EV_UART_RX,       // bytes read from a UART: arg = port
+    BOARD_HAL_EV_USB_RX,        // USB-MIDI packets received (host or device mode)
+    BOARD_HAL_EV_UART_TX,       // bytes written to a UART: arg = port
+    BOARD_HAL_EV_USB_TX,        // USB-MIDI packets sent (host or device mode)
+    BOARD_HAL_EV_I2C_TX,        // I2C write, data truncated to BOARD_HAL_EVENT_DATA
+    BOARD_HAL_EV_COUNT
+} board_hal_event_type_t;
+
+#define BOARD_HAL_EVENT_DATA    16      // payload bytes kept per event
+
+typedef struct {
+    int64_t time_us;
+    uint8_t type;                       // board_hal_event_type_t
+    uint8_t arg;
+    uint16_t length;                    // full length, may exceed BOARD_HAL_EVENT_DATA
+    uint8_t data[BOARD_HAL_EVENT_DATA];
+} board_hal_event_t;
+
+// Inputs are what a replay feeds back; outputs are only captured
+static inline bool board_hal_event_is_input(const board_hal_event_t *ev)
+{
+    return ev->type <= BOARD_HAL_EV_USB_RX;
+}
+
+// One line of the text timeline:
+//   <time_us> <name> <arg> <hex bytes> [+<bytes not shown>]
+// e.g. "1250 uart_rx 1 90 40 7F", "2000 usb_rx 0 09 90 40 7F",
+// "3000 gpio 6 00". Returns the length written (without the newline).
+size_t board_hal_event_format(const board_hal_event_t *ev, char *line, size_t size);
+
+// Parse one timeline line. Returns false on a syntax error; blank lines and
+// '#' comments are reported through *empty with a true return.
+bool board_hal_event_parse(const char *line, board_hal_event_t *ev, bool *empty);
+
+// ---------------------------------------------------------------------------
+// Peripheral calls
+// ---------------------------------------------------------------------------
+
+int64_t board_hal_time_us(void);
+
+// gpio_get_level
+int board_hal_gpio_get_level(int gpio);
+
+// uart_write_bytes / uart_read_bytes (timeout in RTOS ticks)
+int board_hal_uart_write(int port, const uint8_t *data, size_t length);
+int board_hal_uart_read(int port, uint8_t *data, size_t length, uint32_t timeout_ticks);
+
+// TinyUSB device: tud_midi_mounted, tud_midi_packet_write, tud_midi_n_packet_read.
+// The firmware moves whole 4-byte event packets, so these take the place of
+// the byte-stream tud_midi_stream_write.
+bool board_hal_usb_device_mounted(void);
+bool board_hal_usb_device_write(const uint8_t packet[4]);
+bool board_hal_usb_device_read(uint8_t itf, uint8_t packet[4]);
+
+// i2c_master_transmit; dev is the i2c_master_dev_handle_t
+int board_hal_i2c_transmit(void *dev, const uint8_t *data, size_t length, int timeout_ms);
+
+// Record an input that does not come through one of the calls above (USB
+// Host RX arrives in a transfer callback). No-op unless recording.
+void board_hal_record(board_hal_event_type_t type, uint8_t arg, const uint8_t *data, size_t length);
+
+// Recording control (board only). start clears the ring; when it fills, the
+// oldest events are overwritten. dump prints the timeline, oldest first, in
+// the format the Linux replay reads.
+void board_hal_record_start(void);
+void board_hal_record_stop(void);
+void board_hal_record_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,217 @@
+//board_hal_esp.c
+#include "board_hal.h"
+#include "board_hal_usb_host.h"
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#if !CONFIG_LEGACY_DRIVER
+#include "driver/i2c_master.h"
+#endif
+#include "esp_timer.h"
+#include "tusb.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
+#include <string.h>
+
+#if CONFIG_BOARD_HAL_RECORD
+
+#define RECORD_MASK     (CONFIG_BOARD_HAL_RECORD_EVENTS - 1)
+
+_Static_assert((CONFIG_BOARD_HAL_RECORD_EVENTS & RECORD_MASK) == 0,
+               "CONFIG_BOARD_HAL_RECORD_EVENTS must be a power of two");
+
+// Written from tasks and from the button ISR, so a short critical section
+// instead of the lock-free single-producer rings used elsewhere
+static board_hal_event_t record_ring[CONFIG_BOARD_HAL_RECORD_EVENTS];
+static unsigned record_head = 0;
+static unsigned record_count = 0;
+static volatile bool recording = false;
+static portMUX_TYPE record_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Last level seen per pin: polling only records the edges
+static uint64_t gpio_levels = ~0ULL;
+
+void board_hal_record(board_hal_event_type_t type, uint8_t arg, const uint8_t *data, size_t length)
+{
+    if (!recording) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+
+    // Long writes are split so every MIDI byte is kept; I2C (display) writes
+    // only keep their head and length
+    do {
+        size_t chunk = length;
+        if (chunk > BOARD_HAL_EVENT_DATA && type != BOARD_HAL_EV_I2C_TX) {
+            chunk = BOARD_HAL_EVENT_DATA;
+        }
+
+        portENTER_CRITICAL_SAFE(&record_lock);
+        board_hal_event_t *ev = &record_ring[record_head++ & RECORD_MASK];
+        ev->time_us = now;
+        ev->type = (uint8_t)type;
+        ev->arg = arg;
+        ev->length = chunk > UINT16_MAX ? UINT16_MAX : (uint16_t)chunk;
+        memcpy(ev->data, data, chunk < BOARD_HAL_EVENT_DATA ? chunk : BOARD_HAL_EVENT_DATA);
+        if (record_count < CONFIG_BOARD_HAL_RECORD_EVENTS) {
+            record_count++;
+        }
+        portEXIT_CRITICAL_SAFE(&record_lock);
+
+        data += chunk;
+        length -= chunk;
+    } while (length > 0);
+}
+
+void board_hal_record_start(void)
+{
+    portENTER_CRITICAL_SAFE(&record_lock);
+    record_head = 0;
+    record_count = 0;
+    gpio_levels = ~0ULL;
+    recording = true;
+    portEXIT_CRITICAL_SAFE(&record_lock);
+}
+
+void board_hal_record_stop(void)
+{
+    recording = false;
+}
+
+void board_hal_record_dump(void)
+{
+    char line[128];
+    unsigned head = record_head;
+    unsigned count = record_count;
+
+    // Events are copied one at a time; stop recording for an exact dump
+    for (unsigned i = head - count; i != head; i++) {
+        board_hal_event_t ev;
+        portENTER_CRITICAL_SAFE(&record_lock);
+        ev = record_ring[i & RECORD_MASK];
+        portEXIT_CRITICAL_SAFE(&record_lock);
+        board_hal_event_format(&ev, line, sizeof(line));
+        printf("%s\n", line);
+    }
+    printf("# %u events%s\n", count, recording ? " (still recording)" : "");
+}
+
+static inline void record_gpio(int gpio, int level)
+{
+    if (!recording || gpio < 0 || gpio >= 64) {
+        return;
+    }
+    uint64_t bit = 1ULL << gpio;
+    bool changed;
+    portENTER_CRITICAL_SAFE(&record_lock);
+    changed = ((gpio_levels & bit) != 0) != (level != 0);
+    gpio_levels ^= changed ? bit : 0;
+    portEXIT_CRITICAL_SAFE(&record_lock);
+    if (!changed) {
+        return;
+    }
+    uint8_t value = (uint8_t)level;
+    board_hal_record(BOARD_HAL_EV_GPIO, (uint8_t)gpio, &value, 1);
+}
+
+#else
+
+void board_hal_record(board_hal_event_type_t type, uint8_t arg, const uint8_t *data, size_t length)
+{
+}
+
+void board_hal_record_start(void)
+{
+    printf("recording disabled (CONFIG_BOARD_HAL_RECORD)\n");
+}
+
+void board_hal_record_stop(void)
+{
+}
+
+void board_hal_record_dump(void)
+{
+    printf("recording disabled (CONFIG_BOARD_HAL_RECORD)\n");
+}
+
+static inline void record_gpio(int gpio, int level)
+{
+}
+
+#endif
+
+int64_t board_hal_time_us(void)
+{
+    return esp_timer_get_time();
+}
+
+int board_hal_gpio_get_level(int gpio)
+{
+    int level = gpio_get_level(gpio);
+    record_gpio(gpio, level);
+    return level;
+}
+
+int board_hal_uart_write(int port, const uint8_t *data, size_t length)
+{
+    int written = uart_write_bytes(port, (const char *)data, length);
+    if (written > 0) {
+        board_hal_record(BOARD_HAL_EV_UART_TX, (uint8_t)port, data, (size_t)written);
+    }
+    return written;
+}
+
+int board_hal_uart_read(int port, uint8_t *data, size_t length, uint32_t timeout_ticks)
+{
+    int len = uart_read_bytes(port, data, length, timeout_ticks);
+    if (len > 0) {
+        board_hal_record(BOARD_HAL_EV_UART_RX, (uint8_t)port, data, (size_t)len);
+    }
+    return len;
+}
+
+bool board_hal_usb_device_mounted(void)
+{
+    return tud_midi_mounted();
+}
+
+bool board_hal_usb_device_write(const uint8_t packet[4])
+{
+    if (!tud_midi_packet_write(packet)) {
+        return false;
+    }
+    board_hal_record(BOARD_HAL_EV_USB_TX, 0, packet, 4);
+    return true;
+}
+
+bool board_hal_usb_device_read(uint8_t itf, uint8_t packet[4])
+{
+    if (!tud_midi_n_packet_read(itf, packet)) {
+        return false;
+    }
+    board_hal_record(BOARD_HAL_EV_USB_RX, itf, packet, 4);
+    return true;
+}
+
+// Linking the new i2c driver next to the legacy one aborts at startup, so
+// the wrapper only exists when ssd1306 uses the new driver
+#if !CONFIG_LEGACY_DRIVER
+int board_hal_i2c_transmit(void *dev, const uint8_t *data, size_t length, int timeout_ms)
+{
+    esp_err_t err = i2c_master_transmit((i2c_master_dev_handle_t)dev, data, length, timeout_ms);
+    if (err == ESP_OK) {
+        board_hal_record(BOARD_HAL_EV_I2C_TX, 0, data, length);
+    }
+    return err;
+}
+#endif
+
+esp_err_t board_hal_usb_host_submit(usb_transfer_t *transfer)
+{
+    esp_err_t err = usb_host_transfer_submit(transfer);
+    // IN transfers are recorded when their data arrives (board_hal_record)
+    if (err == ESP_OK && !(transfer->bEndpointAddress & 0x80)) {
+        board_hal_record(BOARD_HAL_EV_USB_TX, 0, transfer->data_buffer, transfer->num_bytes);
+    }
+    return err;
+}
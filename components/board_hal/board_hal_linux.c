@@ -0,0 +1,325 @@
+//board_hal_linux.c
+#include "board_hal.h"
+#include "board_hal_replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GPIO_COUNT          64
+#define UART_PORTS          3
+#define FIFO_SIZE           4096    // bytes per input FIFO (power of two)
+#define FIFO_MASK           (FIFO_SIZE - 1)
+
+typedef struct {
+    uint8_t data[FIFO_SIZE];
+    unsigned head;
+    unsigned tail;
+} fifo_t;
+
+typedef struct {
+    board_hal_event_t *events;
+    size_t count;
+    size_t capacity;
+} event_list_t;
+
+static board_hal_replay_config_t config = BOARD_HAL_REPLAY_CONFIG_DEFAULT();
+static int64_t now_us = 0;
+
+static event_list_t timeline;
+static size_t timeline_next = 0;
+static event_list_t capture;
+
+static uint64_t gpio_levels = ~0ULL;
+static fifo_t uart_rx[UART_PORTS];
+static fifo_t usb_rx;
+static uint32_t dropped = 0;
+
+// When each link finishes what was already queued on it
+static int64_t uart_free_us[UART_PORTS];
+static int64_t i2c_free_us = 0;
+
+static board_hal_i2c_sink_t i2c_sink = NULL;
+static void *i2c_sink_ctx = NULL;
+
+static bool list_append(event_list_t *list, const board_hal_event_t *ev)
+{
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        board_hal_event_t *events = realloc(list->events, capacity * sizeof(*events));
+        if (events == NULL) {
+            return false;
+        }
+        list->events = events;
+        list->capacity = capacity;
+    }
+    list->events[list->count++] = *ev;
+    return true;
+}
+
+static void fifo_push(fifo_t *fifo, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        if (fifo->head - fifo->tail == FIFO_SIZE) {
+            dropped += (uint32_t)(length - i);
+            return;
+        }
+        fifo->data[fifo->head++ & FIFO_MASK] = data[i];
+    }
+}
+
+static size_t fifo_pop(fifo_t *fifo, uint8_t *data, size_t length)
+{
+    size_t n = 0;
+    while (n < length && fifo->tail != fifo->head) {
+        data[n++] = fifo->data[fifo->tail++ & FIFO_MASK];
+    }
+    return n;
+}
+
+static void capture_output(board_hal_event_type_t type, uint8_t arg, const uint8_t *data, size_t length,
+                           int64_t done_us)
+{
+    board_hal_event_t ev = {
+        .time_us = done_us,
+        .type = (uint8_t)type,
+        .arg = arg,
+        .length = length > UINT16_MAX ? UINT16_MAX : (uint16_t)length,
+    };
+    memcpy(ev.data, data, length < BOARD_HAL_EVENT_DATA ? length : BOARD_HAL_EVENT_DATA);
+    if (!list_append(&capture, &ev)) {
+        fprintf(stderr, "board_hal: out of memory, output not captured\n");
+    }
+}
+
+// Time a transfer of length bytes finishes on a serial link that is busy
+// until *free_us
+static int64_t link_done(int64_t *free_us, size_t length, uint32_t bits_per_byte, uint32_t hz)
+{
+    int64_t start = *free_us > now_us ? *free_us : now_us;
+    *free_us = start + (int64_t)((length * bits_per_byte * 1000000ULL + hz - 1) / hz);
+    return *free_us;
+}
+
+// ---------------------------------------------------------------------------
+// Replay control
+// ---------------------------------------------------------------------------
+
+void board_hal_replay_init(const board_hal_replay_config_t *cfg)
+{
+    board_hal_replay_config_t defaults = BOARD_HAL_REPLAY_CONFIG_DEFAULT();
+    config = cfg ? *cfg : defaults;
+
+    free(timeline.events);
+    free(capture.events);
+    memset(&timeline, 0, sizeof(timeline));
+    memset(&capture, 0, sizeof(capture));
+    timeline_next = 0;
+
+    now_us = 0;
+    gpio_levels = ~0ULL;
+    memset(uart_rx, 0, sizeof(uart_rx));
+    memset(&usb_rx, 0, sizeof(usb_rx));
+    memset(uart_free_us, 0, sizeof(uart_free_us));
+    i2c_free_us = 0;
+    dropped = 0;
+}
+
+bool board_hal_replay_add(const board_hal_event_t *ev)
+{
+    if (!board_hal_event_is_input(ev)) {
+        return true;
+    }
+    if (timeline.count > 0 && ev->time_us < timeline.events[timeline.count - 1].time_us) {
+        return false;
+    }
+    if (ev->length > BOARD_HAL_EVENT_DATA || (ev->type == BOARD_HAL_EV_GPIO && ev->length != 1)) {
+        return false;
+    }
+    return list_append(&timeline, ev);
+}
+
+int board_hal_replay_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int line_no = 0;
+    size_t before = timeline.count;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        board_hal_event_t ev;
+        bool empty;
+        if (!board_hal_event_parse(line, &ev, &empty)) {
+            fprintf(stderr, "%s:%d: syntax error\n", path, line_no);
+            fclose(f);
+            return -1;
+        }
+        if (!empty && !board_hal_replay_add(&ev)) {
+            fprintf(stderr, "%s:%d: time goes backwards or bad payload\n", path, line_no);
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return (int)(timeline.count - before);
+}
+
+bool board_hal_replay_next(int64_t *time_us)
+{
+    if (timeline_next == timeline.count) {
+        return false;
+    }
+    *time_us = timeline.events[timeline_next].time_us;
+    return true;
+}
+
+void board_hal_replay_advance(int64_t time_us)
+{
+    if (time_us > now_us) {
+        now_us = time_us;
+    }
+
+    while (timeline_next < timeline.count && timeline.events[timeline_next].time_us <= now_us) {
+        const board_hal_event_t *ev = &timeline.events[timeline_next++];
+        switch (ev->type) {
+        case BOARD_HAL_EV_GPIO:
+            if (ev->arg < GPIO_COUNT) {
+                uint64_t bit = 1ULL << ev->arg;
+                gpio_levels = ev->data[0] ? (gpio_levels | bit) : (gpio_levels & ~bit);
+            }
+            break;
+        case BOARD_HAL_EV_UART_RX:
+            if (ev->arg < UART_PORTS) {
+                fifo_push(&uart_rx[ev->arg], ev->data, ev->length);
+            }
+            break;
+        case BOARD_HAL_EV_USB_RX:
+            fifo_push(&usb_rx, ev->data, ev->length & ~3u);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void board_hal_replay_set_i2c_sink(board_hal_i2c_sink_t sink, void *ctx)
+{
+    i2c_sink = sink;
+    i2c_sink_ctx = ctx;
+}
+
+uint32_t board_hal_replay_dropped(void)
+{
+    return dropped;
+}
+
+size_t board_hal_capture_count(void)
+{
+    return capture.count;
+}
+
+const board_hal_event_t *board_hal_capture_get(size_t index)
+{
+    return index < capture.count ? &capture.events[index] : NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Peripheral calls
+// ---------------------------------------------------------------------------
+
+int64_t board_hal_time_us(void)
+{
+    return now_us;
+}
+
+int board_hal_gpio_get_level(int gpio)
+{
+    if (gpio < 0 || gpio >= GPIO_COUNT) {
+        return 1;
+    }
+    return (gpio_levels >> gpio) & 1;
+}
+
+int board_hal_uart_write(int port, const uint8_t *data, size_t length)
+{
+    if (port < 0 || port >= UART_PORTS) {
+        return -1;
+    }
+    // Captured in event-sized pieces, each stamped when its last byte is out
+    for (size_t offset = 0; offset < length; offset += BOARD_HAL_EVENT_DATA) {
+        size_t chunk = length - offset < BOARD_HAL_EVENT_DATA ? length - offset : BOARD_HAL_EVENT_DATA;
+        int64_t done = link_done(&uart_free_us[port], chunk, 10, config.uart_baud);
+        capture_output(BOARD_HAL_EV_UART_TX, (uint8_t)port, &data[offset], chunk, done);
+    }
+    return (int)length;
+}
+
+// Never blocks: the virtual clock only moves through board_hal_replay_advance
+int board_hal_uart_read(int port, uint8_t *data, size_t length, uint32_t timeout_ticks)
+{
+    (void)timeout_ticks;
+    if (port < 0 || port >= UART_PORTS) {
+        return -1;
+    }
+    return (int)fifo_pop(&uart_rx[port], data, length);
+}
+
+bool board_hal_usb_device_mounted(void)
+{
+    return true;
+}
+
+bool board_hal_usb_device_write(const uint8_t packet[4])
+{
+    int64_t frame = config.usb_frame_us ? config.usb_frame_us : 1;
+    capture_output(BOARD_HAL_EV_USB_TX, 0, packet, 4, (now_us / frame + 1) * frame);
+    return true;
+}
+
+bool board_hal_usb_device_read(uint8_t itf, uint8_t packet[4])
+{
+    (void)itf;
+    if (usb_rx.head - usb_rx.tail < 4) {
+        return false;
+    }
+    fifo_pop(&usb_rx, packet, 4);
+    return true;
+}
+
+int board_hal_i2c_transmit(void *dev, const uint8_t *data, size_t length, int timeout_ms)
+{
+    (void)dev;
+    (void)timeout_ms;
+    // Address byte + payload, each followed by an ACK bit
+    int64_t done = link_done(&i2c_free_us, length + 1, 9, config.i2c_hz);
+    capture_output(BOARD_HAL_EV_I2C_TX, 0, data, length, done);
+    if (i2c_sink != NULL) {
+        i2c_sink(data, length, done, i2c_sink_ctx);
+    }
+    return 0;
+}
+
+// Inputs come from the timeline; nothing to record
+void board_hal_record(board_hal_event_type_t type, uint8_t arg, const uint8_t *data, size_t length)
+{
+    (void)type;
+    (void)arg;
+    (void)data;
+    (void)length;
+}
+
+void board_hal_record_start(void)
+{
+}
+
+void board_hal_record_stop(void)
+{
+}
+
+void board_hal_record_dump(void)
+{
+}
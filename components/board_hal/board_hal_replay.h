@@ -0,0 +1,56 @@
+//board_hal_replay.h
+#pragma once
+
+#include "board_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Linux only (board_hal_linux.c): the board_hal calls run against a virtual
+// clock. Input events of a timeline become visible to the readers
+// (gpio/uart/usb) when the clock reaches their time; outputs are captured
+// with the time at which they would have left the board on the real links.
+
+typedef struct {
+    uint32_t uart_baud;         // DIN: 10 bits per byte, bytes queue behind each other
+    uint32_t usb_frame_us;      // USB device IN: a packet leaves on the next frame
+    uint32_t i2c_hz;            // display bus: 9 bits per byte
+} board_hal_replay_config_t;
+
+#define BOARD_HAL_REPLAY_CONFIG_DEFAULT() { .uart_baud = 31250, .usb_frame_us = 1000, .i2c_hz = 400000 }
+
+// Clear the timeline and the capture, clock back to 0, all pins high (pull-ups)
+void board_hal_replay_init(const board_hal_replay_config_t *config);
+
+// Append an input event. Times must not go backwards. Output events are
+// ignored (returns true), so a recorded dump can be replayed as is.
+bool board_hal_replay_add(const board_hal_event_t *ev);
+
+// Load a text timeline (board_hal_event_parse format). Returns the number of
+// inputs added, or -1 with the offending line reported on stderr.
+int board_hal_replay_load(const char *path);
+
+// Time of the next input not yet delivered; false when the timeline is done
+bool board_hal_replay_next(int64_t *time_us);
+
+// Move the clock forward to time_us and deliver the inputs due by then
+void board_hal_replay_advance(int64_t time_us);
+
+// Bytes/packets lost because a reader fell behind (input FIFOs full)
+uint32_t board_hal_replay_dropped(void);
+
+// Optional: every I2C write in full (the capture keeps only the first
+// BOARD_HAL_EVENT_DATA bytes), with the time it finishes on the bus.
+// Used by the host SSD1306 emulator. Survives board_hal_replay_init.
+typedef void (*board_hal_i2c_sink_t)(const uint8_t *data, size_t length, int64_t done_us, void *ctx);
+void board_hal_replay_set_i2c_sink(board_hal_i2c_sink_t sink, void *ctx);
+
+// Captured outputs, in the order they were written (times are when they
+// finish on the link, so they are not necessarily sorted)
+size_t board_hal_capture_count(void);
+const board_hal_event_t *board_hal_capture_get(size_t index);
+
+#ifdef __cplusplus
+}
+#endif
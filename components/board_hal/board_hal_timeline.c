@@ -0,0 +1,93 @@
+//board_hal_timeline.c
+#include "board_hal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+
+static const char *const event_names[BOARD_HAL_EV_COUNT] = {
+    [BOARD_HAL_EV_GPIO] = "gpio",
+    [BOARD_HAL_EV_UART_RX] = "uart_rx",
+    [BOARD_HAL_EV_USB_RX] = "usb_rx",
+    [BOARD_HAL_EV_UART_TX] = "uart_tx",
+    [BOARD_HAL_EV_USB_TX] = "usb_tx",
+    [BOARD_HAL_EV_I2C_TX] = "i2c_tx",
+};
+
+size_t board_hal_event_format(const board_hal_event_t *ev, char *line, size_t size)
+{
+    const char *name = ev->type < BOARD_HAL_EV_COUNT ? event_names[ev->type] : "?";
+    int n = snprintf(line, size, "%" PRId64 " %s %u", ev->time_us, name, ev->arg);
+
+    size_t shown = ev->length < BOARD_HAL_EVENT_DATA ? ev->length : BOARD_HAL_EVENT_DATA;
+    for (size_t i = 0; i < shown && n > 0 && (size_t)n < size; i++) {
+        n += snprintf(&line[n], size - n, " %02X", ev->data[i]);
+    }
+    if (ev->length > shown && n > 0 && (size_t)n < size) {
+        n += snprintf(&line[n], size - n, " +%u", (unsigned)(ev->length - shown));
+    }
+    if (n < 0) {
+        return 0;
+    }
+    return (size_t)n < size ? (size_t)n : size - 1;
+}
+
+bool board_hal_event_parse(const char *line, board_hal_event_t *ev, bool *empty)
+{
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    *empty = (*line == '\0' || *line == '#');
+    if (*empty) {
+        return true;
+    }
+
+    memset(ev, 0, sizeof(*ev));
+    char name[16];
+    unsigned arg;
+    int used;
+    if (sscanf(line, "%" SCNd64 " %15s %u%n", &ev->time_us, name, &arg, &used) != 3 || arg > 0xFF) {
+        return false;
+    }
+    ev->arg = (uint8_t)arg;
+
+    ev->type = BOARD_HAL_EV_COUNT;
+    for (int i = 0; i < BOARD_HAL_EV_COUNT; i++) {
+        if (strcmp(name, event_names[i]) == 0) {
+            ev->type = (uint8_t)i;
+        }
+    }
+    if (ev->type == BOARD_HAL_EV_COUNT) {
+        return false;
+    }
+
+    line += used;
+    while (*line != '\0' && *line != '#') {
+        if (isspace((unsigned char)*line)) {
+            line++;
+            continue;
+        }
+        bool skipped = (*line == '+');
+        const char *digits = skipped ? line + 1 : line;
+        char *end;
+        unsigned long value = strtoul(digits, &end, skipped ? 10 : 16);
+        if (end == digits || (*end != '\0' && *end != '#' && !isspace((unsigned char)*end))) {
+            return false;
+        }
+        if (skipped) {
+            // Bytes not shown (truncated capture)
+            if (value > (unsigned long)(UINT16_MAX - ev->length)) {
+                return false;
+            }
+            ev->length += (uint16_t)value;
+        } else {
+            if (value > 0xFF || ev->length >= BOARD_HAL_EVENT_DATA) {
+                return false;
+            }
+            ev->data[ev->length++] = (uint8_t)value;
+        }
+        line = end;
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+//board_hal_usb_host.h
+#pragma once
+
+#include "esp_err.h"
+#include "usb/usb_host.h"
+#include "board_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// usb_host_transfer_submit. OUT transfers are recorded as USB_TX events;
+// IN data is recorded by the RX callback through board_hal_record().
+// Board only: the USB Host class driver has no Linux counterpart.
+esp_err_t board_hal_usb_host_submit(usb_transfer_t *transfer);
+
+#ifdef __cplusplus
+}
+#endif
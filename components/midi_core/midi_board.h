@@ -0,0 +1,45 @@
+//midi_board.h
+#pragma once
+
+#include "midi_route_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Board wiring and boot configuration shared by the firmware (main/) and the
+// host tools (host/midi_sim.c), so the simulator cannot drift from the board.
+
+#define MIDI_BUTTON_COUNT           10
+
+// Footswitch GPIOs, button 1 first. Initializer for the pin tables.
+#define MIDI_BUTTON_GPIOS           { 6, 7, 14, 15, 16, 17, 18, 21, 47, 48 }
+
+// Window in which further edges of a footswitch are ignored, counted from
+// the first accepted edge (the first edge is never delayed)
+#define MIDI_BUTTON_DEBOUNCE_US     (50 * 1000)
+
+// Routing at boot: buttons -> USB + DIN, DIN -> USB, USB -> DIN
+static const midi_route_rule_t midi_default_rules[] = {
+    { .inputs = MIDI_IN_MASK(MIDI_IN_BUTTONS),
+      .outputs = MIDI_ROUTE_OUT_USB | MIDI_OUT_MASK(MIDI_OUT_DIN),
+      .channels = MIDI_ROUTE_ALL_CHANNELS, .types = MIDI_ROUTE_ALL_TYPES,
+      .channel_out = -1, .cc_in = -1, .cc_out = -1,
+      .curve = MIDI_CURVE_LINEAR, .value_min = 0, .value_max = 127 },
+    { .inputs = MIDI_IN_MASK(MIDI_IN_DIN),
+      .outputs = MIDI_ROUTE_OUT_USB,
+      .channels = MIDI_ROUTE_ALL_CHANNELS, .types = MIDI_ROUTE_ALL_TYPES,
+      .channel_out = -1, .cc_in = -1, .cc_out = -1,
+      .curve = MIDI_CURVE_LINEAR, .value_min = 0, .value_max = 127 },
+    { .inputs = MIDI_IN_MASK(MIDI_IN_USB),
+      .outputs = MIDI_OUT_MASK(MIDI_OUT_DIN),
+      .channels = MIDI_ROUTE_ALL_CHANNELS, .types = MIDI_ROUTE_ALL_TYPES,
+      .channel_out = -1, .cc_in = -1, .cc_out = -1,
+      .curve = MIDI_CURVE_LINEAR, .value_min = 0, .value_max = 127 },
+};
+
+#define MIDI_DEFAULT_RULE_COUNT     (sizeof(midi_default_rules) / sizeof(midi_default_rules[0]))
+
+#ifdef __cplusplus
+}
+#endif
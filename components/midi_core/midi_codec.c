@@ -0,0 +1,240 @@
+//midi_codec.c
+// Conversion between USB-MIDI 4-byte event packets and the MIDI 1.0 byte stream.
+#include "midi_codec.h"
+#include <assert.h>
+
+#include <string.h>
+
+#define MIDI_PACKET_SIZE 4
+
+// Status byte lookup for the stream parser, indexed by (status - 0x80):
+//   bits 0-3  CIN of the resulting USB-MIDI packet
+//   bits 4-5  number of data bytes that follow the status
+//   bit  6    system real-time (emit at once, leave parser state alone)
+//   bit  7    handled specially (SysEx start/end, undefined statuses)
+#define ST_CIN(x)       ((x) & 0x0F)
+#define ST_LEN(x)       (((x) >> 4) & 0x03)
+#define ST_REALTIME     0x40
+#define ST_SPECIAL      0x80
+#define ST(cin, len)    ((uint8_t)((cin) | ((len) << 4)))
+
+static const uint8_t midi_status_table[128] = {
+    [0x00 ... 0x0F] = ST(0x8, 2),   // Note Off
+    [0x10 ... 0x1F] = ST(0x9, 2),   // Note On
+    [0x20 ... 0x2F] = ST(0xA, 2),   // Poly Key Pressure
+    [0x30 ... 0x3F] = ST(0xB, 2),   // Control Change
+    [0x40 ... 0x4F] = ST(0xC, 1),   // Program Change
+    [0x50 ... 0x5F] = ST(0xD, 1),   // Channel Pressure
+    [0x60 ... 0x6F] = ST(0xE, 2),   // Pitch Bend
+    [0x70] = ST_SPECIAL,            // F0 SysEx start
+    [0x71] = ST(0x2, 1),            // F1 MTC quarter frame
+    [0x72] = ST(0x3, 2),            // F2 Song Position
+    [0x73] = ST(0x2, 1),            // F3 Song Select
+    [0x74] = ST_SPECIAL,            // F4 undefined
+    [0x75] = ST_SPECIAL,            // F5 undefined
+    [0x76] = ST(0x5, 0),            // F6 Tune Request
+    [0x77] = ST_SPECIAL,            // F7 SysEx end
+    [0x78 ... 0x7F] = ST_REALTIME | ST(0xF, 0),
+};
+
+const uint8_t midi_cin_length[16] = {
+    0, // 0x0 reserved (misc function codes)
+    0, // 0x1 reserved (cable events)
+    2, // 0x2 two-byte System Common (MTC, Song Select)
+    3, // 0x3 three-byte System Common (Song Position)
+    3, // 0x4 SysEx start / continue
+    1, // 0x5 single-byte System Common or SysEx end with 1 byte
+    2, // 0x6 SysEx end with 2 bytes
+    3, // 0x7 SysEx end with 3 bytes
+    3, // 0x8 Note Off
+    3, // 0x9 Note On
+    3, // 0xA Poly Key Pressure
+    3, // 0xB Control Change
+    2, // 0xC Program Change
+    2, // 0xD Channel Pressure
+    3, // 0xE Pitch Bend
+    1, // 0xF single byte
+};
+
+static bool is_realtime_packet(const uint8_t packet[4])
+{
+    return (packet[0] & 0x0F) == 0x0F && packet[1] >= 0xF8;
+}
+
+void midi_din_encoder_reset(midi_din_encoder_t *enc)
+{
+    enc->running_status = 0;
+}
+
+size_t midi_din_encode_packet(midi_din_encoder_t *enc, const uint8_t packet[4], uint8_t out[3])
+{
+    uint8_t cin = packet[0] & 0x0F;
+    uint8_t len = midi_cin_length[cin];
+    uint8_t status = packet[1];
+
+    if (len == 0) {
+        return 0;
+    }
+
+    // Channel voice messages: status must match the CIN, and can be omitted
+    // when it equals the running status
+    if (cin >= 0x8 && cin <= 0xE) {
+        if ((status >> 4) != cin) {
+            return 0;
+        }
+        size_t n = 0;
+        if (status != enc->running_status) {
+            out[n++] = status;
+            enc->running_status = status;
+        }
+        for (int i = 2; i <= len && i < MIDI_PACKET_SIZE; i++) {
+            out[n++] = packet[i];
+        }
+        return n;
+    }
+
+    // System Real-Time does not affect running status
+    if (status >= 0xF8 && len == 1) {
+        out[0] = status;
+        return 1;
+    }
+
+    // System Common and SysEx bytes cancel running status
+    for (int i = 0; i < len; i++) {
+        out[i] = packet[1 + i];
+        if (out[i] >= 0xF0 && out[i] <= 0xF7) {
+            enc->running_status = 0;
+        }
+    }
+    return len;
+}
+
+size_t midi_din_encode_packets(midi_din_encoder_t *enc, const uint8_t *packets, size_t length, uint8_t *out, size_t out_size)
+{
+    size_t count = length / MIDI_PACKET_SIZE;
+    size_t n = 0;
+
+    // Contract: room for every packet. There is no partial result, since
+    // real-time bytes are hoisted out of order.
+    assert(out_size >= count * 3);
+
+    // Real-time first
+    for (size_t i = 0; i < count && n < out_size; i++) {
+        const uint8_t *packet = &packets[i * MIDI_PACKET_SIZE];
+        if (is_realtime_packet(packet)) {
+            out[n++] = packet[1];
+        }
+    }
+
+    // Then everything else, in order
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *packet = &packets[i * MIDI_PACKET_SIZE];
+        if (is_realtime_packet(packet)) {
+            continue;
+        }
+        if (n + 3 > out_size) {
+            break;      // contract violated with NDEBUG: never write past out
+        }
+        n += midi_din_encode_packet(enc, packet, &out[n]);
+    }
+
+    return n;
+}
+
+void midi_stream_parser_init(midi_stream_parser_t *parser, uint8_t cable)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->cable = cable & 0x0F;
+}
+
+static inline void emit_packet(midi_stream_parser_t *parser, uint8_t cin, uint8_t b1, uint8_t b2, uint8_t b3,
+                               midi_packet_cb_t emit, void *ctx)
+{
+    const uint8_t packet[MIDI_PACKET_SIZE] = { (uint8_t)((parser->cable << 4) | cin), b1, b2, b3 };
+    emit(packet, ctx);
+}
+
+// SysEx end: CIN 5/6/7 for 1/2/3 bytes in the last packet
+static void emit_sysex_end(midi_stream_parser_t *parser, midi_packet_cb_t emit, void *ctx)
+{
+    parser->data[parser->count++] = 0xF7;
+    uint8_t b[3] = {0, 0, 0};
+    memcpy(b, parser->data, parser->count);
+    emit_packet(parser, (uint8_t)(0x4 + parser->count), b[0], b[1], b[2], emit, ctx);
+    parser->count = 0;
+    parser->in_sysex = false;
+}
+
+void midi_stream_parser_feed(midi_stream_parser_t *parser, const uint8_t *data, size_t length,
+                             midi_packet_cb_t emit, void *ctx)
+{
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+
+        if (byte < 0x80) {
+            // Data byte
+            if (parser->in_sysex) {
+                parser->data[parser->count++] = byte;
+                if (parser->count == 3) {
+                    emit_packet(parser, 0x4, parser->data[0], parser->data[1], parser->data[2], emit, ctx);
+                    parser->count = 0;
+                }
+                continue;
+            }
+            if (parser->status == 0) {
+                continue;   // no status (and no running status): discard
+            }
+            parser->data[parser->count++] = byte;
+            if (parser->count == parser->expected) {
+                uint8_t info = midi_status_table[parser->status - 0x80];
+                emit_packet(parser, ST_CIN(info), parser->status, parser->data[0],
+                            parser->expected > 1 ? parser->data[1] : 0, emit, ctx);
+                parser->count = 0;
+                // Channel statuses stay as running status; System Common does not
+                if (parser->status >= 0xF0) {
+                    parser->status = 0;
+                }
+            }
+            continue;
+        }
+
+        uint8_t info = midi_status_table[byte - 0x80];
+
+        if (info & ST_REALTIME) {
+            // Real-time may appear anywhere, even inside another message
+            emit_packet(parser, 0xF, byte, 0, 0, emit, ctx);
+            continue;
+        }
+
+        if (info & ST_SPECIAL) {
+            if (byte == 0xF7) {
+                if (parser->in_sysex) {
+                    emit_sysex_end(parser, emit, ctx);
+                }
+            } else if (byte == 0xF0) {
+                parser->in_sysex = true;
+                parser->data[0] = 0xF0;
+                parser->count = 1;
+            } else {
+                parser->in_sysex = false;   // undefined status: drop whatever was pending
+                parser->count = 0;
+            }
+            parser->status = 0;
+            continue;
+        }
+
+        // Any other status ends an unterminated SysEx
+        parser->in_sysex = false;
+        parser->count = 0;
+
+        if (ST_LEN(info) == 0) {
+            // Single-byte System Common (Tune Request)
+            emit_packet(parser, ST_CIN(info), byte, 0, 0, emit, ctx);
+            parser->status = 0;
+            continue;
+        }
+
+        parser->status = byte;
+        parser->expected = ST_LEN(info);
+    }
+}
@@ -0,0 +1,61 @@
+//midi_codec.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of MIDI 1.0 bytes carried by a USB-MIDI event packet, indexed by
+// its CIN (Code Index Number, low nibble of the packet header byte).
+extern const uint8_t midi_cin_length[16];
+
+// USB-MIDI -> MIDI 1.0 serial (DIN) encoder state.
+// Keeps the last channel status sent on the line so repeated statuses can be
+// omitted (running status). One encoder per serial output.
+typedef struct {
+    uint8_t running_status;   // 0 = no running status in effect
+} midi_din_encoder_t;
+
+// Forget the running status (next channel message is sent with its status byte)
+void midi_din_encoder_reset(midi_din_encoder_t *enc);
+
+// Decode one 4-byte USB-MIDI event packet into MIDI 1.0 bytes, applying
+// running status. Returns the number of bytes written to out (0..3).
+size_t midi_din_encode_packet(midi_din_encoder_t *enc, const uint8_t packet[4], uint8_t out[3]);
+
+// Decode a buffer of USB-MIDI event packets (length is truncated to a multiple
+// of 4). Real-time bytes (0xF8..0xFF) found in the buffer are emitted first so
+// clock/transport never wait behind channel data. out_size must be at least
+// 3 bytes per packet (length / 4 * 3): every packet is always consumed, and a
+// smaller buffer is a caller bug (asserted). Returns the number of bytes
+// written to out.
+size_t midi_din_encode_packets(midi_din_encoder_t *enc, const uint8_t *packets, size_t length, uint8_t *out, size_t out_size);
+
+// MIDI 1.0 byte stream -> USB-MIDI parser state.
+// Persistent across calls, so messages split between reads, running status,
+// SysEx and real-time bytes interleaved anywhere are all handled.
+typedef struct {
+    uint8_t cable;            // cable number placed in the packet header
+    uint8_t status;           // status the next data bytes belong to (0 = none)
+    uint8_t expected;         // data bytes expected for status
+    uint8_t count;            // data bytes collected so far
+    uint8_t data[3];          // collected data bytes / pending SysEx bytes
+    bool in_sysex;
+} midi_stream_parser_t;
+
+// Called for every complete USB-MIDI event packet produced by the parser
+typedef void (*midi_packet_cb_t)(const uint8_t packet[4], void *ctx);
+
+void midi_stream_parser_init(midi_stream_parser_t *parser, uint8_t cable);
+
+// Feed raw MIDI 1.0 bytes; emit is called once per complete packet.
+void midi_stream_parser_feed(midi_stream_parser_t *parser, const uint8_t *data, size_t length,
+                             midi_packet_cb_t emit, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+//midi_command.c
+#include "midi_command.h"
+#include <stdio.h>
+#include <string.h>
+
+void midi_command_set_default(midi_command_t *cmd, int button)
+{
+    cmd->data[0] = 0x0B;
+    cmd->data[1] = 0xB0;
+    cmd->data[2] = 0x00;
+    cmd->data[3] = 0x00;
+    snprintf(cmd->description, sizeof(cmd->description), "Button %d", button + 1);
+}
+
+void midi_command_publish(midi_command_slot_t *slot, const uint8_t data[4])
+{
+    uint32_t packet;
+    memcpy(&packet, data, sizeof(packet));
+    atomic_store_explicit(slot, packet, memory_order_release);
+}
+
+void midi_command_read(const midi_command_slot_t *slot, uint8_t data[4])
+{
+    uint32_t packet = atomic_load_explicit(slot, memory_order_acquire);
+    memcpy(data, &packet, sizeof(packet));
+}
+
+void midi_command_key(char key[MIDI_COMMAND_KEY_SIZE], int button, int byte)
+{
+    snprintf(key, MIDI_COMMAND_KEY_SIZE, "btn%d_byte%d", button, byte);
+}
+
+void increment_nibble(uint8_t *byte, int nibble) {
+    if (nibble == 0) {
+        uint8_t high_nibble = (*byte >> 4) & 0x0F;
+        high_nibble = (high_nibble + 1) & 0x0F;
+        *byte = (high_nibble << 4) | (*byte & 0x0F);
+    } else {
+        uint8_t low_nibble = (*byte & 0x0F);
+        low_nibble = (low_nibble + 1) & 0x0F;
+        *byte = (*byte & 0xF0) | low_nibble;
+    }
+}
+
+void decrement_nibble(uint8_t *byte, int nibble) {
+    if (nibble == 0) {
+        uint8_t high_nibble = (*byte >> 4) & 0x0F;
+        high_nibble = (high_nibble - 1) & 0x0F;
+        *byte = (high_nibble << 4) | (*byte & 0x0F);
+    } else {
+        uint8_t low_nibble = (*byte & 0x0F);
+        low_nibble = (low_nibble - 1) & 0x0F;
+        *byte = (*byte & 0xF0) | low_nibble;
+    }
+}
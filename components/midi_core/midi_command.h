@@ -0,0 +1,41 @@
+//midi_command.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Footswitch command: one USB-MIDI packet, stored in NVS one byte per key
+typedef struct {
+    uint8_t data[4];
+    char description[20];
+} midi_command_t;
+
+// Live copy of a command shared between tasks: the 4 packet bytes in one
+// atomic word. An edit is published with a single store and a send reads it
+// with a single load, so it never goes out half old, half new, and neither
+// side waits for the other.
+typedef atomic_uint_least32_t midi_command_slot_t;
+
+void midi_command_publish(midi_command_slot_t *slot, const uint8_t data[4]);
+void midi_command_read(const midi_command_slot_t *slot, uint8_t data[4]);
+
+#define MIDI_COMMAND_KEY_SIZE   15      // "btn%d_byte%d" + NUL, NVS keys are max 15 chars
+
+// Factory command for a button: CC 0 = 0 on channel 1, "Button n"
+void midi_command_set_default(midi_command_t *cmd, int button);
+
+// NVS key of one byte of a button command
+void midi_command_key(char key[MIDI_COMMAND_KEY_SIZE], int button, int byte);
+
+// Edit screen: step the high (nibble 0) or low (nibble 1) hex digit, wrapping
+void increment_nibble(uint8_t *byte, int nibble);
+void decrement_nibble(uint8_t *byte, int nibble);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,65 @@
+//midi_mpmc.c
+#include "midi_mpmc.h"
+
+void midi_mpmc_init(midi_mpmc_queue_t *q, midi_mpmc_cell_t *cells, unsigned size)
+{
+    q->cells = cells;
+    q->mask = size - 1;
+    for (unsigned i = 0; i < size; i++) {
+        atomic_store_explicit(&cells[i].seq, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&q->enqueue_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&q->dequeue_pos, 0, memory_order_relaxed);
+}
+
+bool midi_mpmc_enqueue(midi_mpmc_queue_t *q, uint16_t value)
+{
+    midi_mpmc_cell_t *cell;
+    unsigned pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+
+    while (1) {
+        cell = &q->cells[pos & q->mask];
+        unsigned seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // full
+        } else {
+            pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->value = value;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+bool midi_mpmc_dequeue(midi_mpmc_queue_t *q, uint16_t *value)
+{
+    midi_mpmc_cell_t *cell;
+    unsigned pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+
+    while (1) {
+        cell = &q->cells[pos & q->mask];
+        unsigned seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int diff = (int)(seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // empty
+        } else {
+            pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *value = cell->value;
+    atomic_store_explicit(&cell->seq, pos + q->mask + 1, memory_order_release);
+    return true;
+}
@@ -0,0 +1,46 @@
+//midi_mpmc.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bounded lock-free MPMC queue of 16-bit values (Vyukov). Each cell carries a
+// sequence number telling whether it is free for the producer position or
+// ready for the consumer position. The caller owns the cell storage; the size
+// must be a power of two.
+
+typedef struct {
+    atomic_uint seq;
+    uint16_t value;
+} midi_mpmc_cell_t;
+
+typedef struct {
+    midi_mpmc_cell_t *cells;
+    unsigned mask;
+    atomic_uint enqueue_pos;
+    atomic_uint dequeue_pos;
+} midi_mpmc_queue_t;
+
+void midi_mpmc_init(midi_mpmc_queue_t *q, midi_mpmc_cell_t *cells, unsigned size);
+
+// false when full
+bool midi_mpmc_enqueue(midi_mpmc_queue_t *q, uint16_t value);
+
+// false when empty
+bool midi_mpmc_dequeue(midi_mpmc_queue_t *q, uint16_t *value);
+
+// Approximate number of queued values (exact when no operation is in flight)
+static inline unsigned midi_mpmc_size(midi_mpmc_queue_t *q)
+{
+    return atomic_load_explicit(&q->enqueue_pos, memory_order_acquire) -
+           atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+}
+
+#ifdef __cplusplus
+}
+#endif
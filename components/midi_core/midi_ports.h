@@ -0,0 +1,35 @@
+//midi_ports.h
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Router outputs. Each one has its own lock-free queue and a single
+// consumer (the task that drains it):
+//   HOST   -> class_driver_task (USB Host)
+//   DEVICE -> midi_device_tx_task (TinyUSB)
+//   DIN    -> usb_to_uart task (UART MIDI OUT)
+typedef enum {
+    MIDI_OUT_HOST = 0,
+    MIDI_OUT_DEVICE,
+    MIDI_OUT_DIN,
+    MIDI_OUT_COUNT
+} midi_output_t;
+
+#define MIDI_OUT_MASK(out)      (1u << (out))
+#define MIDI_OUT_MASK_ALL       ((1u << MIDI_OUT_COUNT) - 1)
+
+// Inputs of the routing stage
+typedef enum {
+    MIDI_IN_BUTTONS = 0,    // footswitches
+    MIDI_IN_USB,            // USB RX (host or device mode)
+    MIDI_IN_DIN,            // UART MIDI IN
+    MIDI_IN_COUNT
+} midi_input_t;
+
+#define MIDI_IN_MASK(in)        (1u << (in))
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,168 @@
+//midi_route_table.c
+#include "midi_route_table.h"
+#include <string.h>
+
+#define ROUTE_CC_DROP           0xFF
+
+static uint8_t curve_point(midi_curve_t curve, uint8_t v, uint8_t lo, uint8_t hi)
+{
+    uint32_t shaped;
+    switch (curve) {
+    case MIDI_CURVE_EXP:
+        shaped = ((uint32_t)v * v + 63) / 127;
+        break;
+    case MIDI_CURVE_LOG: {
+        // integer sqrt(v * 127)
+        uint32_t x = (uint32_t)v * 127, r = 0;
+        while ((r + 1) * (r + 1) <= x) {
+            r++;
+        }
+        shaped = r;
+        break;
+    }
+    case MIDI_CURVE_INVERT:
+        shaped = 127 - v;
+        break;
+    case MIDI_CURVE_LINEAR:
+    default:
+        shaped = v;
+        break;
+    }
+    int32_t span = (int32_t)hi - (int32_t)lo;
+    return (uint8_t)((int32_t)lo + (span * (int32_t)shaped + (span >= 0 ? 63 : -63)) / 127);
+}
+
+// Curve slot for (curve, min, max), shared between rules. Returns -1 when full.
+static int table_curve(midi_route_table_t *t, const midi_route_rule_t *rule)
+{
+    uint8_t lo = rule->value_min > 127 ? 127 : rule->value_min;
+    uint8_t hi = rule->value_max > 127 ? 127 : rule->value_max;
+
+    for (int i = 0; i < t->curve_count; i++) {
+        if (t->curve_key[i][0] == rule->curve && t->curve_key[i][1] == lo && t->curve_key[i][2] == hi) {
+            return i;
+        }
+    }
+    if (t->curve_count >= MIDI_ROUTE_MAX_CURVES) {
+        return -1;
+    }
+    int i = t->curve_count++;
+    t->curve_key[i][0] = rule->curve;
+    t->curve_key[i][1] = lo;
+    t->curve_key[i][2] = hi;
+    for (int v = 0; v < 128; v++) {
+        t->curves[i][v] = curve_point((midi_curve_t)rule->curve, (uint8_t)v, lo, hi);
+    }
+    return i;
+}
+
+static void lut_apply_rule(midi_route_lut_t *lut, const midi_route_rule_t *rule, int curve)
+{
+    // Channel messages
+    for (int type = 0x8; type <= 0xE; type++) {
+        if (!(rule->types & (1u << type))) {
+            continue;
+        }
+        for (int ch = 0; ch < 16; ch++) {
+            if (!(rule->channels & (1u << ch))) {
+                continue;
+            }
+            int out_ch = (rule->channel_out >= 0 && rule->channel_out < 16) ? rule->channel_out : ch;
+            lut->status_out[(type << 4) | ch] = (uint8_t)((type << 4) | out_ch);
+        }
+    }
+
+    // System messages (SysEx, common, real-time) are passed untouched
+    if (rule->types & (1u << 0xF)) {
+        for (int s = 0xF0; s <= 0xFF; s++) {
+            lut->status_out[s] = (uint8_t)s;
+        }
+    }
+
+    if (rule->types & MIDI_ROUTE_TYPE(0xB0)) {
+        if (rule->cc_in >= 0) {
+            lut->cc_number[rule->cc_in] = (uint8_t)(rule->cc_out >= 0 ? rule->cc_out : rule->cc_in);
+            lut->cc_curve[rule->cc_in] = (uint8_t)curve;
+        } else {
+            for (int cc = 0; cc < 128; cc++) {
+                lut->cc_number[cc] = (uint8_t)cc;
+                lut->cc_curve[cc] = (uint8_t)curve;
+            }
+        }
+    }
+}
+
+bool midi_route_table_compile(midi_route_table_t *t, const midi_route_rule_t *rules, size_t count,
+                              uint32_t usb_mask)
+{
+    memset(t, 0, sizeof(*t));
+    for (int in = 0; in < MIDI_IN_COUNT; in++) {
+        for (int out = 0; out < MIDI_OUT_COUNT; out++) {
+            memset(t->lut[in][out].cc_number, ROUTE_CC_DROP, sizeof(t->lut[in][out].cc_number));
+        }
+    }
+
+    for (size_t r = 0; r < count; r++) {
+        const midi_route_rule_t *rule = &rules[r];
+        int curve = table_curve(t, rule);
+        if (curve < 0) {
+            return false;
+        }
+
+        uint32_t outputs = rule->outputs & MIDI_OUT_MASK_ALL;
+        if (rule->outputs & MIDI_ROUTE_OUT_USB) {
+            outputs |= usb_mask;
+        }
+
+        for (int in = 0; in < MIDI_IN_COUNT; in++) {
+            if (!(rule->inputs & MIDI_IN_MASK(in))) {
+                continue;
+            }
+            for (int out = 0; out < MIDI_OUT_COUNT; out++) {
+                if (outputs & MIDI_OUT_MASK(out)) {
+                    lut_apply_rule(&t->lut[in][out], rule, curve);
+                    t->out_mask[in] |= (uint8_t)MIDI_OUT_MASK(out);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+uint32_t midi_route_table_apply(const midi_route_table_t *t, midi_input_t in, const uint8_t packet[4],
+                                uint8_t out[MIDI_OUT_COUNT][4])
+{
+    // CIN 0/1 are reserved (also zero padding from some devices)
+    if (t == NULL || in >= MIDI_IN_COUNT || (packet[0] & 0x0F) < 0x2) {
+        return 0;
+    }
+
+    uint8_t key = (packet[1] & 0x80) ? packet[1] : 0xF0;
+    uint32_t mask = 0;
+
+    for (int o = 0; o < MIDI_OUT_COUNT; o++) {
+        if (!(t->out_mask[in] & MIDI_OUT_MASK(o))) {
+            continue;
+        }
+        const midi_route_lut_t *lut = &t->lut[in][o];
+        uint8_t status = lut->status_out[key];
+        if (status == 0) {
+            continue;
+        }
+
+        memcpy(out[o], packet, 4);
+        if (status < 0xF0) {
+            out[o][1] = status;
+            if ((status & 0xF0) == 0xB0) {
+                uint8_t cc = packet[2] & 0x7F;
+                if (lut->cc_number[cc] == ROUTE_CC_DROP) {
+                    continue;
+                }
+                out[o][2] = lut->cc_number[cc];
+                out[o][3] = t->curves[lut->cc_curve[cc]][packet[3] & 0x7F];
+            }
+        }
+        mask |= MIDI_OUT_MASK(o);
+    }
+    return mask;
+}
@@ -0,0 +1,80 @@
+//midi_route_table.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "midi_ports.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Rules of the routing/transform stage, compiled into flat lookup tables per
+// (input, output), so each message costs a fixed number of table lookups no
+// matter how many rules are configured. Publication of a table to the MIDI
+// tasks is up to the caller (see main/midi_route.c).
+
+// Pseudo-output for rules: the USB output of the current mode (HOST/DEVICE)
+#define MIDI_ROUTE_OUT_USB          0x80
+
+#define MIDI_ROUTE_ALL_CHANNELS     0xFFFF
+// Message type bit from a status high nibble (0x80..0xF0), e.g. MIDI_ROUTE_TYPE(0xB0)
+#define MIDI_ROUTE_TYPE(status)     (1u << (((status) >> 4) & 0x0F))
+#define MIDI_ROUTE_ALL_TYPES        0xFF00   // channel messages + system
+
+#define MIDI_ROUTE_MAX_CURVES       8        // distinct (curve, min, max) per table
+
+typedef enum {
+    MIDI_CURVE_LINEAR = 0,
+    MIDI_CURVE_EXP,         // slow start (v^2)
+    MIDI_CURVE_LOG,         // fast start (sqrt)
+    MIDI_CURVE_INVERT,
+} midi_curve_t;
+
+typedef struct {
+    uint8_t inputs;         // MIDI_IN_MASK bits
+    uint8_t outputs;        // MIDI_OUT_MASK bits and/or MIDI_ROUTE_OUT_USB
+    uint16_t channels;      // input channels matched, bit n = channel n+1
+    uint16_t types;         // MIDI_ROUTE_TYPE bits
+    int8_t channel_out;     // 0..15 forces the output channel, -1 keeps it
+    int8_t cc_in;           // CC number this rule applies to, -1 = all
+    int8_t cc_out;          // new CC number for cc_in, -1 keeps it
+    uint8_t curve;          // midi_curve_t, applied to CC values
+    uint8_t value_min;      // CC value range after the curve
+    uint8_t value_max;
+} midi_route_rule_t;
+
+// Compiled form of the rules for one (input, output) pair.
+// status_out[s] is the status to emit for incoming status s, 0 = drop.
+// System statuses (0xF0..0xFF) map to themselves or 0. SysEx continuation
+// packets, whose first byte is data, are looked up as 0xF0.
+typedef struct {
+    uint8_t status_out[256];
+    uint8_t cc_number[128];     // new CC number, 0xFF = drop
+    uint8_t cc_curve[128];      // index into midi_route_table_t.curves
+} midi_route_lut_t;
+
+typedef struct {
+    midi_route_lut_t lut[MIDI_IN_COUNT][MIDI_OUT_COUNT];
+    uint8_t out_mask[MIDI_IN_COUNT];   // outputs with at least one status routed
+    uint8_t curves[MIDI_ROUTE_MAX_CURVES][128];
+    uint8_t curve_key[MIDI_ROUTE_MAX_CURVES][3];
+    uint8_t curve_count;
+} midi_route_table_t;
+
+// Compile rules into t. Later rules override the transform of earlier ones
+// for the same input/output/status; outputs add up. usb_mask is what
+// MIDI_ROUTE_OUT_USB stands for. Returns false when the rules need more than
+// MIDI_ROUTE_MAX_CURVES value curves.
+bool midi_route_table_compile(midi_route_table_t *t, const midi_route_rule_t *rules, size_t count,
+                              uint32_t usb_mask);
+
+// Apply the table to one USB-MIDI packet. Returns the output mask and writes
+// the transformed packet for each set bit into out[output].
+uint32_t midi_route_table_apply(const midi_route_table_t *t, midi_input_t in, const uint8_t packet[4],
+                                uint8_t out[MIDI_OUT_COUNT][4]);
+
+#ifdef __cplusplus
+}
+#endif
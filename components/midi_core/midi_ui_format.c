@@ -0,0 +1,86 @@
+//midi_ui_format.c
+#include "midi_ui_format.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+void midi_format_latency_ms(char out[5], uint32_t us)
+{
+    uint32_t tenths = (us + 50) / 100;
+    if (tenths > 999) {
+        memcpy(out, ">99 ", 5);
+        return;
+    }
+    out[0] = tenths >= 100 ? '0' + tenths / 100 : ' ';
+    out[1] = '0' + (tenths / 10) % 10;
+    out[2] = '.';
+    out[3] = '0' + tenths % 10;
+    out[4] = '\0';
+}
+
+size_t midi_format_button_line(char out[18], int button, const uint8_t data[4], bool selected)
+{
+    char *p = out;
+    *p++ = selected ? '>' : ' ';
+    *p++ = 'B';
+    int number = button + 1;
+    if (number >= 10) {
+        *p++ = '1';
+        *p++ = '0' + (number - 10);
+    } else {
+        *p++ = '0' + number;
+    }
+    *p++ = ':';
+    for (int i = 0; i < 4; i++) {
+        *p++ = hex_digits[data[i] >> 4];
+        *p++ = hex_digits[data[i] & 0x0F];
+    }
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+size_t midi_format_edit_line(char out[20], const uint8_t data[4], int byte_index, int nibble_index)
+{
+    char *p = out;
+    for (int i = 0; i < 4; i++) {
+        char high = hex_digits[data[i] >> 4];
+        char low = hex_digits[data[i] & 0x0F];
+
+        if (i == byte_index && nibble_index == 0) {
+            *p++ = '[';
+            *p++ = high;
+            *p++ = ']';
+            *p++ = low;
+        } else if (i == byte_index) {
+            *p++ = high;
+            *p++ = '[';
+            *p++ = low;
+            *p++ = ']';
+        } else {
+            *p++ = high;
+            *p++ = low;
+        }
+    }
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+void midi_format_rate(char out[6], uint32_t rate)
+{
+    snprintf(out, 6, "%5lu", (unsigned long)(rate > 99999 ? 99999 : rate));
+}
+
+void midi_format_event_line(char line[17], const char *label, const uint8_t (*events)[4], int count)
+{
+    memset(line, ' ', 16);
+    line[16] = '\0';
+    memcpy(line, label, 2);
+    for (int i = 0; i < 2 && i < count; i++) {
+        char *p = &line[3 + i * 7];
+        for (int b = 1; b < 4; b++) {
+            *p++ = hex_digits[events[i][b] >> 4];
+            *p++ = hex_digits[events[i][b] & 0x0F];
+        }
+    }
+}
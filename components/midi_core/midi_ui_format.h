@@ -0,0 +1,34 @@
+//midi_ui_format.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Text of the OLED lines (16 characters of font8x8), without any display access
+
+// Milliseconds with one decimal, always 4 characters (" 1.2", "12.3", ">99 ")
+void midi_format_latency_ms(char out[5], uint32_t us);
+
+// ">B3:0BB00000": cursor, button number (1-based) and the command bytes.
+// Returns the length.
+size_t midi_format_button_line(char out[18], int button, const uint8_t data[4], bool selected);
+
+// "0B[B]00000": command bytes with the nibble being edited in brackets.
+// Returns the length.
+size_t midi_format_edit_line(char out[20], const uint8_t data[4], int byte_index, int nibble_index);
+
+// Messages/s, right aligned in 5 characters, capped at 99999
+void midi_format_rate(char out[6], uint32_t rate);
+
+// "UR 907F40 B0077F": 2-character port label and up to two events
+// (status + data bytes), newest first. Always 16 characters.
+void midi_format_event_line(char line[17], const char *label, const uint8_t (*events)[4], int count);
+
+#ifdef __cplusplus
+}
+#endif
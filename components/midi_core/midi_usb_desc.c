@@ -0,0 +1,68 @@
+//midi_usb_desc.c
+#include "midi_usb_desc.h"
+#include <string.h>
+
+#define DESC_CONFIGURATION      0x02
+#define DESC_INTERFACE          0x04
+#define DESC_ENDPOINT           0x05
+
+#define CLASS_AUDIO             0x01
+#define SUBCLASS_MIDISTREAMING  0x03
+
+#define EP_TYPE_BULK            0x02
+#define EP_TYPE_INTERRUPT       0x03
+
+bool midi_usb_find_interface(const uint8_t *config, size_t length, midi_usb_interface_t *found)
+{
+    memset(found, 0, sizeof(*found));
+    if (config == NULL || length < 9 || config[0] < 9 || config[1] != DESC_CONFIGURATION) {
+        return false;
+    }
+
+    size_t total = (size_t)(config[2] | (config[3] << 8));
+    if (total > length) {
+        total = length;
+    }
+
+    midi_usb_interface_t candidate = { 0 };
+    bool in_midi = false;
+
+    for (size_t offset = 0; offset + 2 <= total; ) {
+        const uint8_t *desc = &config[offset];
+        uint8_t len = desc[0];
+        if (len < 2 || offset + len > total) {
+            break;
+        }
+
+        if (desc[1] == DESC_INTERFACE && len >= 9) {
+            if (in_midi && candidate.endpoint_in) {
+                break;
+            }
+            in_midi = (desc[5] == CLASS_AUDIO && desc[6] == SUBCLASS_MIDISTREAMING);
+            memset(&candidate, 0, sizeof(candidate));
+            candidate.interface_number = desc[2];
+            candidate.alternate_setting = desc[3];
+        } else if (desc[1] == DESC_ENDPOINT && len >= 7 && in_midi) {
+            uint8_t address = desc[2];
+            uint8_t type = desc[3] & 0x03;
+            uint16_t max_packet = (uint16_t)((desc[4] | (desc[5] << 8)) & 0x7FF);
+            if ((type == EP_TYPE_BULK || type == EP_TYPE_INTERRUPT) &&
+                (address & 0x0F) != 0 && max_packet > 0 && max_packet <= 1024) {
+                if ((address & 0x80) && !candidate.endpoint_in) {
+                    candidate.endpoint_in = address;
+                    candidate.max_packet_in = max_packet;
+                } else if (!(address & 0x80) && !candidate.endpoint_out) {
+                    candidate.endpoint_out = address;
+                    candidate.max_packet_out = max_packet;
+                }
+            }
+        }
+        offset += len;
+    }
+
+    if (!in_midi || !candidate.endpoint_in) {
+        return false;
+    }
+    *found = candidate;
+    return true;
+}
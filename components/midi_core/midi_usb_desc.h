@@ -0,0 +1,32 @@
+//midi_usb_desc.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// USB MIDI Streaming interface of a device, as needed by the USB Host driver
+typedef struct {
+    uint8_t interface_number;
+    uint8_t alternate_setting;
+    uint8_t endpoint_in;        // bEndpointAddress (bit 7 set)
+    uint8_t endpoint_out;       // bEndpointAddress (bit 7 clear)
+    uint16_t max_packet_in;     // 1..1024
+    uint16_t max_packet_out;
+} midi_usb_interface_t;
+
+// Walk a configuration descriptor (length bytes as read from the device)
+// and return the first Audio / MIDI Streaming interface that has a bulk or
+// interrupt IN endpoint. The OUT endpoint is optional: endpoint_out = 0 for
+// read-only devices. Only endpoints that belong to that interface are
+// considered. Walking stops at the first malformed descriptor
+// (bLength < 2 or past the end), so any byte sequence is safe to pass in.
+bool midi_usb_find_interface(const uint8_t *config, size_t length, midi_usb_interface_t *found);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+#
+# Generate font8x8_atlas.h from font8x8_basic.h at build time.
+#
+# The atlas holds every glyph of font8x8_basic_tr in the four forms the
+# driver needs (normal, inverted, flipped, flipped + inverted), so text is
+# drawn by copying two 32-bit words per character with no per-byte work.
+#
+# usage: gen_font8x8_atlas.py font8x8_basic.h font8x8_atlas.h
+
+import re
+import sys
+
+
+def rotate_byte(b):
+	# Same as ssd1306_rotate_byte(): bit 0 <-> bit 7 ...
+	r = 0
+	for _ in range(8):
+		r = (r << 1) | (b & 1)
+		b >>= 1
+	return r
+
+
+def read_font(path):
+	with open(path) as f:
+		text = f.read()
+	body = text[text.index('font8x8_basic_tr[128][8]'):]
+	glyphs = []
+	for row in re.finditer(r'\{\s*((?:0x[0-9A-Fa-f]{2}\s*,\s*){7}0x[0-9A-Fa-f]{2})\s*\}', body):
+		glyphs.append([int(v, 16) for v in row.group(1).split(',')])
+		if len(glyphs) == 128:
+			break
+	if len(glyphs) != 128:
+		sys.exit('%s: expected 128 glyphs, found %d' % (path, len(glyphs)))
+	return glyphs
+
+
+def words(glyph):
+	# Little-endian: byte 0 is the leftmost column
+	lo = glyph[0] | glyph[1] << 8 | glyph[2] << 16 | glyph[3] << 24
+	hi = glyph[4] | glyph[5] << 8 | glyph[6] << 16 | glyph[7] << 24
+	return lo, hi
+
+
+def main():
+	if len(sys.argv) != 3:
+		sys.exit('usage: %s font8x8_basic.h font8x8_atlas.h' % sys.argv[0])
+	glyphs = read_font(sys.argv[1])
+
+	variants = (
+		('FONT8X8_NORMAL', lambda b: b),
+		('FONT8X8_INVERT', lambda b: ~b & 0xFF),
+		('FONT8X8_FLIP', rotate_byte),
+		('FONT8X8_FLIP | FONT8X8_INVERT', lambda b: ~rotate_byte(b) & 0xFF),
+	)
+
+	out = []
+	out.append('// font8x8_atlas.h')
+	out.append('// Generated by gen_font8x8_atlas.py from font8x8_basic.h. Do not edit.')
+	out.append('#pragma once')
+	out.append('')
+	out.append('#include <stdint.h>')
+	out.append('')
+	out.append('#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__')
+	out.append('#error "font8x8_atlas words are little-endian"')
+	out.append('#endif')
+	out.append('')
+	out.append('// Variant index: OR of the flags')
+	out.append('#define FONT8X8_NORMAL 0')
+	out.append('#define FONT8X8_INVERT 1')
+	out.append('#define FONT8X8_FLIP 2')
+	out.append('#define FONT8X8_VARIANTS 4')
+	out.append('')
+	out.append('// [variant][code][word]: columns 0-3 in word 0, 4-7 in word 1')
+	out.append('static const uint32_t font8x8_atlas[FONT8X8_VARIANTS][128][2] = {')
+	for name, transform in variants:
+		out.append('\t[%s] = {' % name)
+		for code, glyph in enumerate(glyphs):
+			lo, hi = words([transform(b) for b in glyph])
+			out.append('\t\t{ 0x%08X, 0x%08X },   // U+00%02X' % (lo, hi, code))
+		out.append('\t},')
+	out.append('};')
+	out.append('')
+
+	with open(sys.argv[2], 'w') as f:
+		f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+	main()
@@ -6,7 +6,7 @@
 #include "esp_log.h"
 
 #include "ssd1306.h"
-#include "font8x8_basic.h"
+#include "font8x8_atlas.h"
 
 #define PACK8 __attribute__((aligned( __alignof__( uint8_t ) ), packed ))
 
@@ -15,6 +15,19 @@ typedef union out_column_t {
 	uint8_t  u8[4];
 } PACK8 out_column_t;
 
+// Glyph from the generated atlas, already inverted/flipped as needed.
+// Two words: columns 0-3 and 4-7.
+static inline const uint32_t * glyph_words(SSD1306_t * dev, char ch, bool invert)
+{
+	int variant = (invert ? FONT8X8_INVERT : FONT8X8_NORMAL) | (dev->_flip ? FONT8X8_FLIP : 0);
+	return font8x8_atlas[variant][(uint8_t)ch & 0x7F];
+}
+
+static inline const uint8_t * glyph_bytes(SSD1306_t * dev, char ch, bool invert)
+{
+	return (const uint8_t *)glyph_words(dev, ch, invert);
+}
+
 void ssd1306_init(SSD1306_t * dev, int width, int height)
 {
 	if (dev->_address == SPI_ADDRESS) {
@@ -22,9 +35,12 @@ void ssd1306_init(SSD1306_t * dev, int width, int height)
 	} else {
 		i2c_init(dev, width, height);
 	}
-	// Initialize internal buffer
+	// Initialize internal buffer. The panel RAM is undefined after reset,
+	// so the whole buffer starts dirty.
 	for (int i=0;i<dev->_pages;i++) {
 		memset(dev->_page[i]._segs, 0, 128);
+		dev->_page[i]._valid = true;
+		ssd1306_mark_dirty(dev, i, 0, dev->_width);
 	}
 }
 
@@ -43,17 +59,42 @@ int ssd1306_get_pages(SSD1306_t * dev)
 	return dev->_pages;
 }
 
+// Block until queued window transfers have finished (CONFIG_ASYNC_TRANSPORT)
+void ssd1306_wait_done(SSD1306_t * dev)
+{
+	if (dev->_address == SPI_ADDRESS) {
+		spi_wait_done(dev);
+	} else {
+		i2c_wait_done(dev);
+	}
+}
+
+// Whole frame in a single transaction
 void ssd1306_show_buffer(SSD1306_t * dev)
 {
+	ssd1306_show_window(dev, 0, dev->_pages - 1, 0, dev->_width - 1);
+}
+
+// Send a rectangle of the internal buffer in a single transaction
+// (horizontal addressing). Pages whose dirty range it covers become clean
+// once the window is sent (or queued); if the transport fails they stay
+// dirty for the next flush. Returns false on transport failure.
+bool ssd1306_show_window(SSD1306_t * dev, int page_start, int page_end, int seg_start, int seg_end)
+{
+	bool sent;
 	if (dev->_address == SPI_ADDRESS) {
-		for (int page=0; page<dev->_pages;page++) {
-			spi_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
-		}
+		sent = spi_display_window(dev, page_start, page_end, seg_start, seg_end);
 	} else {
-		for (int page=0; page<dev->_pages;page++) {
-			i2c_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
+		sent = i2c_display_window(dev, page_start, page_end, seg_start, seg_end);
+	}
+	if (!sent) return false;
+	for (int page = page_start; page <= page_end && page < dev->_pages; page++) {
+		PAGE_t * _page = &dev->_page[page];
+		if (!_page->_valid && _page->_dirtyStart >= seg_start && _page->_dirtyEnd <= seg_end + 1) {
+			_page->_valid = true;
 		}
 	}
+	return true;
 }
 
 void ssd1306_set_buffer(SSD1306_t * dev, const uint8_t * buffer)
@@ -61,6 +102,7 @@ void ssd1306_set_buffer(SSD1306_t * dev, const uint8_t * buffer)
 	int index = 0;
 	for (int page=0; page<dev->_pages;page++) {
 		memcpy(&dev->_page[page]._segs, &buffer[index], 128);
+		ssd1306_mark_dirty(dev, page, 0, dev->_width);
 		index = index + 128;
 	}
 }
@@ -77,6 +119,7 @@ void ssd1306_get_buffer(SSD1306_t * dev, uint8_t * buffer)
 void ssd1306_set_page(SSD1306_t * dev, int page, const uint8_t * buffer)
 {
 	memcpy(&dev->_page[page]._segs, buffer, 128);
+	ssd1306_mark_dirty(dev, page, 0, dev->_width);
 }
 
 void ssd1306_get_page(SSD1306_t * dev, int page, uint8_t * buffer)
@@ -95,21 +138,133 @@ void ssd1306_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * i
 	memcpy(&dev->_page[page]._segs[seg], images, width);
 }
 
+// Render up to 16 characters of font8x8 into a page-sized image
+static int render_text(SSD1306_t * dev, uint32_t * image, const char * text, int text_len, bool invert)
+{
+	int _text_len = text_len;
+	if (_text_len > 16) _text_len = 16;
+
+	for (int i = 0; i < _text_len; i++) {
+		const uint32_t * glyph = glyph_words(dev, text[i], invert);
+		image[i * 2] = glyph[0];
+		image[i * 2 + 1] = glyph[1];
+	}
+	return _text_len * 8;
+}
+
 void ssd1306_display_text(SSD1306_t * dev, int page, const char * text, int text_len, bool invert)
+{
+	if (page >= dev->_pages) return;
+
+	// Whole line in one image write instead of one per character
+	uint32_t image[32];
+	int width = render_text(dev, image, text, text_len, invert);
+	if (width > 0) ssd1306_display_image(dev, page, 0, (const uint8_t *)image, width);
+}
+
+// Extend the range of a page that differs from the panel
+void ssd1306_mark_dirty(SSD1306_t * dev, int page, int seg, int width)
+{
+	if (page < 0 || page >= dev->_pages) return;
+	if (seg < 0) {
+		width += seg;
+		seg = 0;
+	}
+	if (seg + width > dev->_width) width = dev->_width - seg;
+	if (width <= 0) return;
+
+	PAGE_t * _page = &dev->_page[page];
+	if (_page->_valid) {
+		_page->_valid = false;
+		_page->_dirtyStart = seg;
+		_page->_dirtyEnd = seg + width;
+	} else {
+		if (seg < _page->_dirtyStart) _page->_dirtyStart = seg;
+		if (seg + width > _page->_dirtyEnd) _page->_dirtyEnd = seg + width;
+	}
+}
+
+// Copy an image into the internal buffer without showing it.
+// Only the columns that actually change are marked dirty.
+void ssd1306_draw_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
+{
+	if (page >= dev->_pages) return;
+	if (seg >= dev->_width) return;
+	if (width > dev->_width - seg) width = dev->_width - seg;
+
+	uint8_t * dst = &dev->_page[page]._segs[seg];
+	int first = 0;
+	while (first < width && dst[first] == images[first]) first++;
+	if (first == width) return;
+	int last = width;
+	while (last > first && dst[last - 1] == images[last - 1]) last--;
+
+	memcpy(&dst[first], &images[first], last - first);
+	ssd1306_mark_dirty(dev, page, seg + first, last - first);
+}
+
+// Same as ssd1306_display_text, but into the internal buffer. Show it with ssd1306_flush.
+// Glyphs are stored a word at a time straight into the page; only the
+// words that actually change are marked dirty.
+void ssd1306_draw_text(SSD1306_t * dev, int page, const char * text, int text_len, bool invert)
 {
 	if (page >= dev->_pages) return;
 	int _text_len = text_len;
 	if (_text_len > 16) _text_len = 16;
 
-	int seg = 0;
-	uint8_t image[8];
+	uint32_t * dst = (uint32_t *)dev->_page[page]._segs;
+	int first = -1, last = -1;
 	for (int i = 0; i < _text_len; i++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[i]], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
-		ssd1306_display_image(dev, page, seg, image, 8);
-		seg = seg + 8;
+		const uint32_t * glyph = glyph_words(dev, text[i], invert);
+		for (int w = 0; w < 2; w++) {
+			int index = i * 2 + w;
+			if (dst[index] == glyph[w]) continue;
+			dst[index] = glyph[w];
+			if (first < 0) first = index;
+			last = index;
+		}
+	}
+	if (first >= 0) ssd1306_mark_dirty(dev, page, first * 4, (last - first + 1) * 4);
+}
+
+// Bus cost of one extra transaction in bytes (start/address/stop plus
+// the address commands and driver overhead), used to pick the flush strategy
+#define SSD1306_TRANSACTION_COST 16
+
+// Send everything that changed since the last flush. Either one window
+// covering all dirty pages (a single transaction) or one window per dirty
+// page, whichever moves fewer bytes. Returns the number of pages sent;
+// pages whose window failed stay dirty.
+int ssd1306_flush(SSD1306_t * dev)
+{
+	int first = -1, last = -1;
+	int seg_start = dev->_width, seg_end = 0;
+	int dirty = 0, per_page_cost = 0;
+	for (int page = 0; page < dev->_pages; page++) {
+		PAGE_t * _page = &dev->_page[page];
+		if (_page->_valid) continue;
+		if (first < 0) first = page;
+		last = page;
+		if (_page->_dirtyStart < seg_start) seg_start = _page->_dirtyStart;
+		if (_page->_dirtyEnd > seg_end) seg_end = _page->_dirtyEnd;
+		per_page_cost += (_page->_dirtyEnd - _page->_dirtyStart) + SSD1306_TRANSACTION_COST;
+		dirty++;
+	}
+	if (dirty == 0) return 0;
+
+	int window_cost = (last - first + 1) * (seg_end - seg_start) + SSD1306_TRANSACTION_COST;
+	if (dirty > 1 && window_cost <= per_page_cost) {
+		return ssd1306_show_window(dev, first, last, seg_start, seg_end - 1) ? last - first + 1 : 0;
+	}
+
+	// One-page windows, so they are queued too with CONFIG_ASYNC_TRANSPORT
+	int sent = 0;
+	for (int page = first; page <= last; page++) {
+		PAGE_t * _page = &dev->_page[page];
+		if (_page->_valid) continue;
+		if (ssd1306_show_window(dev, page, page, _page->_dirtyStart, _page->_dirtyEnd - 1)) sent++;
 	}
+	return sent;
 }
 
 void ssd1306_display_text_box1(SSD1306_t * dev, int page, int seg, const char * text, int box_width, int text_len, bool invert, int delay)
@@ -119,21 +274,15 @@ void ssd1306_display_text_box1(SSD1306_t * dev, int page, int seg, const char *
 	if (seg + text_box_pixel > dev->_width) return;
 
 	int _seg = seg;
-	uint8_t image[8];
 	for (int i = 0; i < box_width; i++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[i]], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
-		ssd1306_display_image(dev, page, _seg, image, 8);
+		ssd1306_display_image(dev, page, _seg, glyph_bytes(dev, text[i], invert), 8);
 		_seg = _seg + 8;
 	}
 	vTaskDelay(delay);
 
 	// Horizontally scroll inside the box
 	for (int _text=box_width;_text<text_len;_text++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[_text]], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
+		const uint8_t * image = glyph_bytes(dev, text[_text], invert);
 		for (int _bit=0;_bit<8;_bit++) {
 			for (int _pixel=0;_pixel<text_box_pixel;_pixel++) {
 				//ESP_LOGI(__FUNCTION__, "_text=%d _bit=%d _pixel=%d", _text, _bit, _pixel);
@@ -153,24 +302,17 @@ void ssd1306_display_text_box2(SSD1306_t * dev, int page, int seg, const char *
 	if (seg + text_box_pixel > dev->_width) return;
 
 	int _seg = seg;
-	uint8_t image[8];
 
 	// Fill the text box with blanks
 	for (int i = 0; i < box_width; i++) {
-		//memcpy(image, font8x8_basic_tr[(uint8_t)text[i]], 8);
-		memcpy(image, font8x8_basic_tr[0x20], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
-		ssd1306_display_image(dev, page, _seg, image, 8);
+		ssd1306_display_image(dev, page, _seg, glyph_bytes(dev, ' ', invert), 8);
 		_seg = _seg + 8;
 	}
 	vTaskDelay(delay);
 
 	// Horizontally scroll inside the box
 	for (int _text=0;_text<text_len;_text++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[_text]], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
+		const uint8_t * image = glyph_bytes(dev, text[_text], invert);
 		for (int _bit=0;_bit<8;_bit++) {
 			for (int _pixel=0;_pixel<text_box_pixel;_pixel++) {
 				//ESP_LOGI(__FUNCTION__, "_text=%d _bit=%d _pixel=%d", _text, _bit, _pixel);
@@ -184,9 +326,7 @@ void ssd1306_display_text_box2(SSD1306_t * dev, int page, int seg, const char *
 
 	// Horizontally scroll inside the box
 	for (int _text=0;_text<box_width;_text++) {
-		memcpy(image, font8x8_basic_tr[0x20], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
+		const uint8_t * image = glyph_bytes(dev, ' ', invert);
 		for (int _bit=0;_bit<8;_bit++) {
 			for (int _pixel=0;_pixel<text_box_pixel;_pixel++) {
 				//ESP_LOGI(__FUNCTION__, "_text=%d _bit=%d _pixel=%d", _text, _bit, _pixel);
@@ -211,7 +351,7 @@ ssd1306_display_text_x3(SSD1306_t * dev, int page, const char * text, int text_l
 
 	for (int nn = 0; nn < _text_len; nn++) {
 
-		uint8_t const * const in_columns = font8x8_basic_tr[(uint8_t)text[nn]];
+		uint8_t const * const in_columns = (const uint8_t *)font8x8_atlas[FONT8X8_NORMAL][(uint8_t)text[nn] & 0x7F];
 
 		// make the character 3x as high
 		out_column_t out_columns[8];
@@ -518,6 +658,12 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 		}
 	}
 
+	if (delay < 0) {
+		for (int page=0;page<dev->_pages;page++) {
+			ssd1306_mark_dirty(dev, page, 0, dev->_width);
+		}
+	}
+
 	if (delay >= 0) {
 		for (int page=0;page<dev->_pages;page++) {
 			if (dev->_address == SPI_ADDRESS) {
@@ -569,6 +715,7 @@ void _ssd1306_bitmaps(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitma
 					break;
 				}
 				dev->_page[page]._segs[_seg] = wk2;
+				ssd1306_mark_dirty(dev, page, _seg, 1);
 				_seg++;
 			}
 		}
@@ -631,6 +778,7 @@ void _ssd1306_pixel(SSD1306_t * dev, int xpos, int ypos, bool invert)
 	if (dev->_flip) wk0 = ssd1306_rotate_byte(wk0);
 	ESP_LOGD(__FUNCTION__, "wk0=0x%02x wk1=0x%02x", wk0, wk1);
 	dev->_page[_page]._segs[_seg] = wk0;
+	ssd1306_mark_dirty(dev, _page, _seg, 1);
 }
 
 // Set line to internal buffer. Not show it.
@@ -856,7 +1004,7 @@ void ssd1306_display_rotate_text(SSD1306_t * dev, int seg, const char * text, in
 	uint8_t image[8];
 	int _page = dev->_pages-1;
 	for (uint8_t i = 0; i < _text_len; i++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[i]], 8);
+		memcpy(image, font8x8_atlas[FONT8X8_NORMAL][(uint8_t)text[i] & 0x7F], 8);
 		ssd1306_rotate_image(image, dev->_flip);
 		ESP_LOGD(__FUNCTION__, "_page=%d seg=%d", _page, seg);
 		if (invert) ssd1306_invert(image, 8);
@@ -1,6 +1,8 @@
 #ifndef MAIN_SSD1306_H_
 #define MAIN_SSD1306_H_
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "driver/spi_master.h"
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0))
 #include "driver/i2c_master.h"
@@ -93,9 +95,11 @@ typedef enum {
 } ssd1306_scroll_type_t;
 
 typedef struct {
-	bool _valid; // Not using it anymore
+	bool _valid; // false: _segs[_dirtyStart.._dirtyEnd-1] not yet sent to the panel
 	int _segLen; // Not using it anymore
-	uint8_t _segs[128];
+	int _dirtyStart;
+	int _dirtyEnd;
+	uint8_t _segs[128] __attribute__((aligned(4))); // ssd1306_draw_text stores whole words
 } PAGE_t;
 
 typedef struct {
@@ -109,6 +113,11 @@ typedef struct {
 	int _scEnd;
 	int _scDirection;
 	PAGE_t _page[8];
+	int _addrMode; // OLED_CMD_SET_PAGE_ADDR_MODE or OLED_CMD_SET_HORI_ADDR_MODE
+	bool _async; // window writes are queued (CONFIG_ASYNC_TRANSPORT)
+	int _txPending; // queued SPI transactions not yet finalized
+	int _txBuffer; // next window transfer buffer
+	SemaphoreHandle_t _txSlots; // free i2c queue slots, given back on completion
 	bool _flip;
 	i2c_port_t _i2c_num;
 	spi_device_handle_t _spi_device_handle;
@@ -128,12 +137,18 @@ int ssd1306_get_width(SSD1306_t * dev);
 int ssd1306_get_height(SSD1306_t * dev);
 int ssd1306_get_pages(SSD1306_t * dev);
 void ssd1306_show_buffer(SSD1306_t * dev);
+bool ssd1306_show_window(SSD1306_t * dev, int page_start, int page_end, int seg_start, int seg_end);
+void ssd1306_wait_done(SSD1306_t * dev);
 void ssd1306_set_buffer(SSD1306_t * dev, const uint8_t * buffer);
 void ssd1306_get_buffer(SSD1306_t * dev, uint8_t * buffer);
 void ssd1306_set_page(SSD1306_t * dev, int page, const uint8_t * buffer);
 void ssd1306_get_page(SSD1306_t * dev, int page, uint8_t * buffer);
 void ssd1306_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
 void ssd1306_display_text(SSD1306_t * dev, int page, const char * text, int text_len, bool invert);
+void ssd1306_mark_dirty(SSD1306_t * dev, int page, int seg, int width);
+void ssd1306_draw_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
+void ssd1306_draw_text(SSD1306_t * dev, int page, const char * text, int text_len, bool invert);
+int ssd1306_flush(SSD1306_t * dev);
 void ssd1306_display_text_box1(SSD1306_t * dev, int page, int seg, const char * text, int box_width, int text_len, bool invert, int delay);
 void ssd1306_display_text_box2(SSD1306_t * dev, int page, int seg, const char * text, int box_width, int text_len, bool invert, int delay);
 void ssd1306_display_text_x3(SSD1306_t * dev, int page, const char * text, int text_len, bool invert);
@@ -166,6 +181,8 @@ void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset);
 void i2c_device_add(SSD1306_t * dev, i2c_port_t i2c_num, int16_t reset, uint16_t i2c_address);
 void i2c_init(SSD1306_t * dev, int width, int height);
 void i2c_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
+bool i2c_display_window(SSD1306_t * dev, int page_start, int page_end, int seg_start, int seg_end);
+void i2c_wait_done(SSD1306_t * dev);
 void i2c_contrast(SSD1306_t * dev, int contrast);
 void i2c_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll);
 
@@ -178,6 +195,8 @@ bool spi_master_write_command(SSD1306_t * dev, uint8_t Command );
 bool spi_master_write_data(SSD1306_t * dev, const uint8_t* Data, size_t DataLength );
 void spi_init(SSD1306_t * dev, int width, int height);
 void spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
+bool spi_display_window(SSD1306_t * dev, int page_start, int page_end, int seg_start, int seg_end);
+void spi_wait_done(SSD1306_t * dev);
 void spi_contrast(SSD1306_t * dev, int contrast);
 void spi_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll);
 
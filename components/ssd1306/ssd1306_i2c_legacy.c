@@ -46,6 +46,7 @@ void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset)
 
 	dev->_address = I2C_ADDRESS;
 	dev->_flip = false;
+	dev->_async = false; // the legacy driver has no queued transfers
 	dev->_i2c_num = I2C_NUM;
 }
 
@@ -77,6 +78,7 @@ void i2c_device_add(SSD1306_t * dev, i2c_port_t i2c_num, int16_t reset, uint16_t
 
 	dev->_address = i2c_address;
 	dev->_flip = false;
+	dev->_async = false; // the legacy driver has no queued transfers
 	dev->_i2c_num = i2c_num;
 }
 
@@ -138,6 +140,7 @@ void i2c_init(SSD1306_t * dev, int width, int height) {
 		ESP_LOGE(TAG, "OLED configuration failed. code: 0x%.2X", res);
 	}
 	i2c_cmd_link_delete(cmd);
+	dev->_addrMode = OLED_CMD_SET_PAGE_ADDR_MODE;
 }
 
 
@@ -154,37 +157,111 @@ void i2c_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * image
 		_page = (dev->_pages - page) - 1;
 	}
 
+	if (width > dev->_width - seg) width = dev->_width - seg;
+
+	// Address commands (each with its own control byte) followed by the data
+	// stream, all in a single transaction
 	i2c_cmd_handle_t cmd = i2c_cmd_link_create();
 	i2c_master_start(cmd);
 	i2c_master_write_byte(cmd, (dev->_address << 1) | I2C_MASTER_WRITE, true);
 
-	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_STREAM, true);
+	if (dev->_addrMode != OLED_CMD_SET_PAGE_ADDR_MODE) {
+		// Back from a window write
+		i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+		i2c_master_write_byte(cmd, OLED_CMD_SET_MEMORY_ADDR_MODE, true);	// 20
+		i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+		i2c_master_write_byte(cmd, OLED_CMD_SET_PAGE_ADDR_MODE, true);		// 02
+		dev->_addrMode = OLED_CMD_SET_PAGE_ADDR_MODE;
+	}
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
 	// Set Lower Column Start Address for Page Addressing Mode
 	i2c_master_write_byte(cmd, (0x00 + columLow), true);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
 	// Set Higher Column Start Address for Page Addressing Mode
 	i2c_master_write_byte(cmd, (0x10 + columHigh), true);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
 	// Set Page Start Address for Page Addressing Mode
 	i2c_master_write_byte(cmd, 0xB0 | _page, true);
 
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_DATA_STREAM, true);
+	i2c_master_write(cmd, images, width, true);
 	i2c_master_stop(cmd);
+
 	esp_err_t res = i2c_master_cmd_begin(dev->_i2c_num, cmd, I2C_TICKS_TO_WAIT);
 	if (res != ESP_OK) {
 		ESP_LOGE(TAG, "Image command failed. code: 0x%.2X", res);
 	}
 	i2c_cmd_link_delete(cmd);
+}
+
+// Stream a window of the internal buffer (pages page_start..page_end,
+// columns seg_start..seg_end) in one transaction using horizontal addressing.
+// The data buffer is static: call from the task that owns the display.
+// Returns false if the transaction failed.
+bool i2c_display_window(SSD1306_t * dev, int page_start, int page_end, int seg_start, int seg_end) {
+	static uint8_t data_buf[8 * 128];
+
+	if (page_start < 0) page_start = 0;
+	if (page_end >= dev->_pages) page_end = dev->_pages - 1;
+	if (seg_start < 0) seg_start = 0;
+	if (seg_end >= dev->_width) seg_end = dev->_width - 1;
+	if (page_start > page_end || seg_start > seg_end) return true;
+
+	// The panel's page order is reversed when flipped
+	int _page_start = page_start;
+	int _page_end = page_end;
+	if (dev->_flip) {
+		_page_start = (dev->_pages - page_end) - 1;
+		_page_end = (dev->_pages - page_start) - 1;
+	}
+
+	int width = seg_end - seg_start + 1;
+	int data_len = 0;
+	for (int _page = _page_start; _page <= _page_end; _page++) {
+		int page = dev->_flip ? (dev->_pages - _page) - 1 : _page;
+		memcpy(&data_buf[data_len], &dev->_page[page]._segs[seg_start], width);
+		data_len += width;
+	}
 
-	cmd = i2c_cmd_link_create();
+	i2c_cmd_handle_t cmd = i2c_cmd_link_create();
 	i2c_master_start(cmd);
 	i2c_master_write_byte(cmd, (dev->_address << 1) | I2C_MASTER_WRITE, true);
+
+	if (dev->_addrMode != OLED_CMD_SET_HORI_ADDR_MODE) {
+		i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+		i2c_master_write_byte(cmd, OLED_CMD_SET_MEMORY_ADDR_MODE, true);	// 20
+		i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+		i2c_master_write_byte(cmd, OLED_CMD_SET_HORI_ADDR_MODE, true);		// 00
+	}
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+	i2c_master_write_byte(cmd, OLED_CMD_SET_COLUMN_RANGE, true);			// 21
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+	i2c_master_write_byte(cmd, seg_start + CONFIG_OFFSETX, true);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+	i2c_master_write_byte(cmd, seg_end + CONFIG_OFFSETX, true);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+	i2c_master_write_byte(cmd, OLED_CMD_SET_PAGE_RANGE, true);				// 22
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+	i2c_master_write_byte(cmd, _page_start, true);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);
+	i2c_master_write_byte(cmd, _page_end, true);
+
 	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_DATA_STREAM, true);
-	i2c_master_write(cmd, images, width, true);
+	i2c_master_write(cmd, data_buf, data_len, true);
 	i2c_master_stop(cmd);
 
-	res = i2c_master_cmd_begin(dev->_i2c_num, cmd, I2C_TICKS_TO_WAIT);
+	esp_err_t res = i2c_master_cmd_begin(dev->_i2c_num, cmd, I2C_TICKS_TO_WAIT);
+	i2c_cmd_link_delete(cmd);
 	if (res != ESP_OK) {
-		ESP_LOGE(TAG, "Image command failed. code: 0x%.2X", res);
+		ESP_LOGE(TAG, "Window command failed. code: 0x%.2X", res);
+		return false;
 	}
-	i2c_cmd_link_delete(cmd);
+	dev->_addrMode = OLED_CMD_SET_HORI_ADDR_MODE;
+	return true;
+}
+
+// Transfers are blocking with the legacy driver
+void i2c_wait_done(SSD1306_t * dev) {
 }
 
 void i2c_contrast(SSD1306_t * dev, int contrast) {
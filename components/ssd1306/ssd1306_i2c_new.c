@@ -7,6 +7,7 @@
 #include "esp_log.h"
 
 #include "ssd1306.h"
+#include "board_hal.h"
 
 #define TAG "SSD1306"
 
@@ -21,6 +22,54 @@
 #define I2C_MASTER_FREQ_HZ 400000 // I2C clock of SSD1306 can run at 400 kHz max.
 #define I2C_TICKS_TO_WAIT 100	  // Maximum ticks to wait before issuing a timeout.
 
+#if CONFIG_ASYNC_TRANSPORT
+#define I2C_TRANS_QUEUE_DEPTH 2	  // Queued transactions, one per window buffer.
+#else
+#define I2C_TRANS_QUEUE_DEPTH 0	  // Blocking transactions.
+#endif
+
+// Window transfers are double buffered: a frame can be packed while the
+// previous one is still on the bus.
+static uint8_t window_buf[2][16 + 8 * 128];
+
+#if CONFIG_ASYNC_TRANSPORT
+// Called from the i2c ISR when a queued transaction finishes
+static bool i2c_trans_done(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_data_t *evt_data, void *arg)
+{
+	SSD1306_t * dev = (SSD1306_t *)arg;
+	BaseType_t woken = pdFALSE;
+	xSemaphoreGiveFromISR(dev->_txSlots, &woken);
+	return woken == pdTRUE;
+}
+#endif
+
+// Take a queue slot; it comes back from i2c_trans_done
+static esp_err_t i2c_take_slot(SSD1306_t * dev)
+{
+	if (xSemaphoreTake(dev->_txSlots, pdMS_TO_TICKS(I2C_TICKS_TO_WAIT)) != pdTRUE) {
+		ESP_LOGE(TAG, "Display transfer still pending after %d ms", I2C_TICKS_TO_WAIT);
+		return ESP_ERR_TIMEOUT;
+	}
+	return ESP_OK;
+}
+
+// Blocking write. In async mode it is queued behind any window transfer
+// still in flight and then waited for, so stack buffers are safe.
+static esp_err_t i2c_write(SSD1306_t * dev, const uint8_t * buf, size_t len)
+{
+	if (!dev->_async) {
+		return board_hal_i2c_transmit(dev->_i2c_dev_handle, buf, len, I2C_TICKS_TO_WAIT);
+	}
+	esp_err_t res = i2c_take_slot(dev);
+	if (res != ESP_OK) return res;
+	res = board_hal_i2c_transmit(dev->_i2c_dev_handle, buf, len, I2C_TICKS_TO_WAIT);
+	if (res != ESP_OK) {
+		xSemaphoreGive(dev->_txSlots);
+		return res;
+	}
+	return i2c_master_bus_wait_all_done(dev->_i2c_bus_handle, I2C_TICKS_TO_WAIT);
+}
+
 void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset)
 {
 	ESP_LOGI(TAG, "New i2c driver is used");
@@ -30,6 +79,7 @@ void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset)
 		.i2c_port = I2C_NUM,
 		.scl_io_num = scl,
 		.sda_io_num = sda,
+		.trans_queue_depth = I2C_TRANS_QUEUE_DEPTH,
 		.flags.enable_internal_pullup = true,
 	};
 	i2c_master_bus_handle_t i2c_bus_handle;
@@ -57,6 +107,16 @@ void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset)
 	dev->_i2c_num = I2C_NUM;
 	dev->_i2c_bus_handle = i2c_bus_handle;
 	dev->_i2c_dev_handle = i2c_dev_handle;
+	dev->_txBuffer = 0;
+	dev->_async = false;
+#if CONFIG_ASYNC_TRANSPORT
+	dev->_txSlots = xSemaphoreCreateCounting(I2C_TRANS_QUEUE_DEPTH, I2C_TRANS_QUEUE_DEPTH);
+	i2c_master_event_callbacks_t cbs = {
+		.on_trans_done = i2c_trans_done,
+	};
+	ESP_ERROR_CHECK(i2c_master_register_event_callbacks(i2c_dev_handle, &cbs, dev));
+	dev->_async = true;
+#endif
 }
 
 void i2c_device_add(SSD1306_t * dev, i2c_port_t i2c_num, int16_t reset, uint16_t i2c_address)
@@ -97,6 +157,9 @@ void i2c_device_add(SSD1306_t * dev, i2c_port_t i2c_num, int16_t reset, uint16_t
 	dev->_flip = false;
 	dev->_i2c_num = i2c_num;
 	dev->_i2c_dev_handle = i2c_dev_handle;
+	// The bus belongs to someone else: keep blocking transfers
+	dev->_txBuffer = 0;
+	dev->_async = false;
 }
 
 void i2c_init(SSD1306_t * dev, int width, int height) {
@@ -147,12 +210,13 @@ void i2c_init(SSD1306_t * dev, int width, int height) {
 	out_buf[out_index++] = OLED_CMD_DISPLAY_ON;				// AF
 
 	esp_err_t res;
-	res = i2c_master_transmit(dev->_i2c_dev_handle, out_buf, out_index, I2C_TICKS_TO_WAIT);
+	res = i2c_write(dev, out_buf, out_index);
 	if (res == ESP_OK) {
 		ESP_LOGI(TAG, "OLED configured successfully");
 	} else {
 		ESP_LOGE(TAG, "Could not write to device [0x%02x at %d]: %d (%s)", dev->_address, dev->_i2c_num, res, esp_err_to_name(res));
 	}
+	dev->_addrMode = OLED_CMD_SET_PAGE_ADDR_MODE;
 }
 
 
@@ -169,33 +233,111 @@ void i2c_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * image
 		_page = (dev->_pages - page) - 1;
 	}
 
-	uint8_t *out_buf;
-	out_buf = malloc(width < 4 ? 4 : width + 1);
-	if (out_buf == NULL) {
-		ESP_LOGE(TAG, "malloc fail");
-		return;
-	}
+	if (width > dev->_width - seg) width = dev->_width - seg;
+
+	// Address commands (each with its own control byte) followed by the data
+	// stream, all in a single transaction
+	uint8_t out_buf[12 + 128];
 	int out_index = 0;
-	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_STREAM;
+	if (dev->_addrMode != OLED_CMD_SET_PAGE_ADDR_MODE) {
+		// Back from a window write
+		out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+		out_buf[out_index++] = OLED_CMD_SET_MEMORY_ADDR_MODE;	// 20
+		out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+		out_buf[out_index++] = OLED_CMD_SET_PAGE_ADDR_MODE;		// 02
+		dev->_addrMode = OLED_CMD_SET_PAGE_ADDR_MODE;
+	}
+	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
 	// Set Lower Column Start Address for Page Addressing Mode
 	out_buf[out_index++] = (0x00 + columLow);
+	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
 	// Set Higher Column Start Address for Page Addressing Mode
 	out_buf[out_index++] = (0x10 + columHigh);
+	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
 	// Set Page Start Address for Page Addressing Mode
 	out_buf[out_index++] = 0xB0 | _page;
+	out_buf[out_index++] = OLED_CONTROL_BYTE_DATA_STREAM;
+	memcpy(&out_buf[out_index], images, width);
+	out_index += width;
 
 	esp_err_t res;
-	res = i2c_master_transmit(dev->_i2c_dev_handle, out_buf, out_index, I2C_TICKS_TO_WAIT);
+	res = i2c_write(dev, out_buf, out_index);
 	if (res != ESP_OK)
 		ESP_LOGE(TAG, "Could not write to device [0x%02x at %d]: %d (%s)", dev->_address, dev->_i2c_num, res, esp_err_to_name(res));
+}
 
-	out_buf[0] = OLED_CONTROL_BYTE_DATA_STREAM;
-	memcpy(&out_buf[1], images, width);
+// Stream a window of the internal buffer (pages page_start..page_end,
+// columns seg_start..seg_end) in one transaction using horizontal addressing.
+// With CONFIG_ASYNC_TRANSPORT it returns as soon as the transfer is queued;
+// the frame is copied first, so the buffer can be drawn into right away.
+// Call from the task that owns the display. Returns false if the window
+// could not be sent (or queued).
+bool i2c_display_window(SSD1306_t * dev, int page_start, int page_end, int seg_start, int seg_end) {
+	if (page_start < 0) page_start = 0;
+	if (page_end >= dev->_pages) page_end = dev->_pages - 1;
+	if (seg_start < 0) seg_start = 0;
+	if (seg_end >= dev->_width) seg_end = dev->_width - 1;
+	if (page_start > page_end || seg_start > seg_end) return true;
+
+	// A buffer is reused only after its transfer finished: with two slots,
+	// holding one means at most the previous window is still in flight.
+	if (dev->_async && i2c_take_slot(dev) != ESP_OK) return false;
+	uint8_t * out_buf = window_buf[dev->_txBuffer];
+	dev->_txBuffer ^= 1;
+
+	// The panel's page order is reversed when flipped
+	int _page_start = page_start;
+	int _page_end = page_end;
+	if (dev->_flip) {
+		_page_start = (dev->_pages - page_end) - 1;
+		_page_end = (dev->_pages - page_start) - 1;
+	}
 
-	res = i2c_master_transmit(dev->_i2c_dev_handle, out_buf, width + 1, I2C_TICKS_TO_WAIT);
-	if (res != ESP_OK)
+	int out_index = 0;
+	if (dev->_addrMode != OLED_CMD_SET_HORI_ADDR_MODE) {
+		out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+		out_buf[out_index++] = OLED_CMD_SET_MEMORY_ADDR_MODE;	// 20
+		out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+		out_buf[out_index++] = OLED_CMD_SET_HORI_ADDR_MODE;		// 00
+	}
+	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+	out_buf[out_index++] = OLED_CMD_SET_COLUMN_RANGE;			// 21
+	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+	out_buf[out_index++] = seg_start + CONFIG_OFFSETX;
+	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+	out_buf[out_index++] = seg_end + CONFIG_OFFSETX;
+	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+	out_buf[out_index++] = OLED_CMD_SET_PAGE_RANGE;				// 22
+	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+	out_buf[out_index++] = _page_start;
+	out_buf[out_index++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+	out_buf[out_index++] = _page_end;
+	out_buf[out_index++] = OLED_CONTROL_BYTE_DATA_STREAM;
+
+	int width = seg_end - seg_start + 1;
+	for (int _page = _page_start; _page <= _page_end; _page++) {
+		int page = dev->_flip ? (dev->_pages - _page) - 1 : _page;
+		memcpy(&out_buf[out_index], &dev->_page[page]._segs[seg_start], width);
+		out_index += width;
+	}
+
+	// Async: returns once queued, the slot comes back from i2c_trans_done
+	esp_err_t res = board_hal_i2c_transmit(dev->_i2c_dev_handle, out_buf, out_index, I2C_TICKS_TO_WAIT);
+	if (res != ESP_OK) {
+		if (dev->_async) xSemaphoreGive(dev->_txSlots);
 		ESP_LOGE(TAG, "Could not write to device [0x%02x at %d]: %d (%s)", dev->_address, dev->_i2c_num, res, esp_err_to_name(res));
-	free(out_buf);
+		return false;
+	}
+	dev->_addrMode = OLED_CMD_SET_HORI_ADDR_MODE;
+	return true;
+}
+
+// Block until every queued transfer has finished
+void i2c_wait_done(SSD1306_t * dev) {
+	if (!dev->_async) return;
+	esp_err_t res = i2c_master_bus_wait_all_done(dev->_i2c_bus_handle, I2C_TICKS_TO_WAIT);
+	if (res != ESP_OK)
+		ESP_LOGE(TAG, "Display transfers did not finish: %s", esp_err_to_name(res));
 }
 
 void i2c_contrast(SSD1306_t * dev, int contrast) {
@@ -209,7 +351,7 @@ void i2c_contrast(SSD1306_t * dev, int contrast) {
 	out_buf[out_index++] = OLED_CMD_SET_CONTRAST; // 81
 	out_buf[out_index++] = _contrast;
 
-	esp_err_t res = i2c_master_transmit(dev->_i2c_dev_handle, out_buf, 3, I2C_TICKS_TO_WAIT);
+	esp_err_t res = i2c_write(dev, out_buf, 3);
 	if (res != ESP_OK)
 		ESP_LOGE(TAG, "Could not write to device [0x%02x at %d]: %d (%s)", dev->_address, dev->_i2c_num, res, esp_err_to_name(res));
 }
@@ -284,7 +426,7 @@ void i2c_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll) {
 		out_buf[out_index++] = OLED_CMD_DEACTIVE_SCROLL; // 2E
 	}
 
-	esp_err_t res = i2c_master_transmit(dev->_i2c_dev_handle, out_buf, out_index, I2C_TICKS_TO_WAIT);
+	esp_err_t res = i2c_write(dev, out_buf, out_index);
 	if (res != ESP_OK)
 		ESP_LOGE(TAG, "Could not write to device [0x%02x at %d]: %d (%s)", dev->_address, dev->_i2c_num, res, esp_err_to_name(res));
 }
@@ -5,6 +5,7 @@
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_attr.h"
 
 #include "ssd1306.h"
 
@@ -22,6 +23,12 @@
 #define SPI_DATA_MODE 1
 #define SPI_DEFAULT_FREQUENCY 1000000; // 1MHz
 
+#if CONFIG_ASYNC_TRANSPORT
+#define SPI_QUEUE_SIZE 2
+#else
+#define SPI_QUEUE_SIZE 1
+#endif
+
 int clock_speed_hz = SPI_DEFAULT_FREQUENCY;
 
 void spi_clock_speed(int speed) {
@@ -69,7 +76,7 @@ void spi_master_init(SSD1306_t * dev, int16_t mosi, int16_t sclk, int16_t cs, in
 	//devcfg.clock_speed_hz = SPI_DEFAULT_FREQUENCY;
 	devcfg.clock_speed_hz = clock_speed_hz;
 	devcfg.spics_io_num = cs;
-	devcfg.queue_size = 1;
+	devcfg.queue_size = SPI_QUEUE_SIZE;
 
 	spi_device_handle_t spi_device_handle;
 	ret = spi_bus_add_device( HOST_ID, &devcfg, &spi_device_handle);
@@ -80,6 +87,12 @@ void spi_master_init(SSD1306_t * dev, int16_t mosi, int16_t sclk, int16_t cs, in
 	dev->_address = SPI_ADDRESS;
 	dev->_flip = false;
 	dev->_spi_device_handle = spi_device_handle;
+	dev->_txPending = 0;
+#if CONFIG_ASYNC_TRANSPORT
+	dev->_async = true;
+#else
+	dev->_async = false;
+#endif
 }
 
 void spi_device_add(SSD1306_t * dev, int16_t cs, int16_t dc, int16_t reset)
@@ -125,7 +138,7 @@ void spi_device_add(SSD1306_t * dev, int16_t cs, int16_t dc, int16_t reset)
 	//devcfg.clock_speed_hz = SPI_DEFAULT_FREQUENCY;
 	devcfg.clock_speed_hz = clock_speed_hz;
 	devcfg.spics_io_num = cs;
-	devcfg.queue_size = 1;
+	devcfg.queue_size = SPI_QUEUE_SIZE;
 
 	spi_device_handle_t spi_device_handle;
 	ret = spi_bus_add_device( HOST_ID, &devcfg, &spi_device_handle);
@@ -136,9 +149,26 @@ void spi_device_add(SSD1306_t * dev, int16_t cs, int16_t dc, int16_t reset)
 	dev->_address = SPI_ADDRESS;
 	dev->_flip = false;
 	dev->_spi_device_handle = spi_device_handle;
+	dev->_txPending = 0;
+#if CONFIG_ASYNC_TRANSPORT
+	dev->_async = true;
+#else
+	dev->_async = false;
+#endif
 }
 
 
+// Finalize queued window transfers. Blocking writes must not be mixed with
+// transactions still queued on the device.
+void spi_wait_done(SSD1306_t * dev)
+{
+	spi_transaction_t * done;
+	while ( dev->_txPending > 0 ) {
+		spi_device_get_trans_result( dev->_spi_device_handle, &done, portMAX_DELAY );
+		dev->_txPending--;
+	}
+}
+
 bool spi_master_write_byte(const spi_device_handle_t SPIHandle, const uint8_t* Data, size_t DataLength )
 {
 	spi_transaction_t SPITransaction;
@@ -147,7 +177,7 @@ bool spi_master_write_byte(const spi_device_handle_t SPIHandle, const uint8_t* D
 		memset( &SPITransaction, 0, sizeof( spi_transaction_t ) );
 		SPITransaction.length = DataLength * 8;
 		SPITransaction.tx_buffer = Data;
-		spi_device_transmit( SPIHandle, &SPITransaction );
+		return spi_device_transmit( SPIHandle, &SPITransaction ) == ESP_OK;
 	}
 
 	return true;
@@ -155,6 +185,7 @@ bool spi_master_write_byte(const spi_device_handle_t SPIHandle, const uint8_t* D
 
 bool spi_master_write_commands(SSD1306_t * dev, const uint8_t * Commands, size_t DataLength )
 {
+	spi_wait_done( dev );
 	gpio_set_level( dev->_dc, SPI_COMMAND_MODE );
 	return spi_master_write_byte( dev->_spi_device_handle, Commands, DataLength );
 }
@@ -168,6 +199,7 @@ bool spi_master_write_command(SSD1306_t * dev, uint8_t Command )
 
 bool spi_master_write_data(SSD1306_t * dev, const uint8_t* Data, size_t DataLength )
 {
+	spi_wait_done( dev );
 	gpio_set_level( dev->_dc, SPI_DATA_MODE );
 	return spi_master_write_byte( dev->_spi_device_handle, Data, DataLength );
 }
@@ -216,6 +248,7 @@ void spi_init(SSD1306_t * dev, int width, int height)
 	spi_master_write_command(dev, OLED_CMD_DEACTIVE_SCROLL);		// 2E
 	spi_master_write_command(dev, OLED_CMD_DISPLAY_NORMAL);			// A6
 	spi_master_write_command(dev, OLED_CMD_DISPLAY_ON);				// AF
+	dev->_addrMode = OLED_CMD_SET_PAGE_ADDR_MODE;
 }
 
 
@@ -233,6 +266,13 @@ void spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * image
 		_page = (dev->_pages - page) - 1;
 	}
 
+	if (dev->_addrMode != OLED_CMD_SET_PAGE_ADDR_MODE) {
+		// Back from a window write
+		uint8_t mode[2] = { OLED_CMD_SET_MEMORY_ADDR_MODE, OLED_CMD_SET_PAGE_ADDR_MODE };
+		spi_master_write_commands(dev, mode, 2);
+		dev->_addrMode = OLED_CMD_SET_PAGE_ADDR_MODE;
+	}
+
 	// Set Lower Column Start Address for Page Addressing Mode, Higher Column Start Address for Page Addressing Mode and Page Start Address for Page Addressing Mode
 	uint8_t commands[3] = { 0x00 + columLow, 0x10 + columHigh, 0xB0 | _page };
 	spi_master_write_commands(dev, commands, 3);
@@ -241,6 +281,69 @@ void spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * image
 
 }
 
+// Stream a window of the internal buffer (pages page_start..page_end,
+// columns seg_start..seg_end) using horizontal addressing: one command
+// write and one data transaction. With CONFIG_ASYNC_TRANSPORT the data goes
+// out by DMA and this returns once it is queued. Call from the task that
+// owns the display. Returns false if the window could not be sent (or queued).
+bool spi_display_window(SSD1306_t * dev, int page_start, int page_end, int seg_start, int seg_end)
+{
+	static DMA_ATTR uint8_t data_buf[8 * 128];
+	static spi_transaction_t data_trans;
+
+	if (page_start < 0) page_start = 0;
+	if (page_end >= dev->_pages) page_end = dev->_pages - 1;
+	if (seg_start < 0) seg_start = 0;
+	if (seg_end >= dev->_width) seg_end = dev->_width - 1;
+	if (page_start > page_end || seg_start > seg_end) return true;
+
+	// The panel's page order is reversed when flipped
+	int _page_start = page_start;
+	int _page_end = page_end;
+	if (dev->_flip) {
+		_page_start = (dev->_pages - page_end) - 1;
+		_page_end = (dev->_pages - page_start) - 1;
+	}
+
+	uint8_t commands[8];
+	int command_len = 0;
+	if (dev->_addrMode != OLED_CMD_SET_HORI_ADDR_MODE) {
+		commands[command_len++] = OLED_CMD_SET_MEMORY_ADDR_MODE;	// 20
+		commands[command_len++] = OLED_CMD_SET_HORI_ADDR_MODE;		// 00
+	}
+	commands[command_len++] = OLED_CMD_SET_COLUMN_RANGE;			// 21
+	commands[command_len++] = seg_start + CONFIG_OFFSETX;
+	commands[command_len++] = seg_end + CONFIG_OFFSETX;
+	commands[command_len++] = OLED_CMD_SET_PAGE_RANGE;				// 22
+	commands[command_len++] = _page_start;
+	commands[command_len++] = _page_end;
+	if (!spi_master_write_commands(dev, commands, command_len)) return false;
+	dev->_addrMode = OLED_CMD_SET_HORI_ADDR_MODE;
+
+	int width = seg_end - seg_start + 1;
+	int data_len = 0;
+	for (int _page = _page_start; _page <= _page_end; _page++) {
+		int page = dev->_flip ? (dev->_pages - _page) - 1 : _page;
+		memcpy(&data_buf[data_len], &dev->_page[page]._segs[seg_start], width);
+		data_len += width;
+	}
+	// The command write above finalized the previous window, so data_buf
+	// and data_trans are free again
+	if (!dev->_async) {
+		return spi_master_write_data(dev, data_buf, data_len);
+	}
+	memset(&data_trans, 0, sizeof(data_trans));
+	data_trans.length = data_len * 8;
+	data_trans.tx_buffer = data_buf;
+	gpio_set_level( dev->_dc, SPI_DATA_MODE );
+	if (spi_device_queue_trans( dev->_spi_device_handle, &data_trans, portMAX_DELAY ) != ESP_OK) {
+		ESP_LOGE(TAG, "Could not queue display window");
+		return false;
+	}
+	dev->_txPending++;
+	return true;
+}
+
 void spi_contrast(SSD1306_t * dev, int contrast) {
 	int _contrast = contrast;
 	if (contrast < 0x0) _contrast = 0;
@@ -0,0 +1,105 @@
+//fuzz_din_parser.c
+// DIN IN path of midi_uart_parse_and_send_to_usb: MIDI 1.0 bytes through the
+// stream parser, every packet through the routing table (uart_packet_to_router).
+//
+// Input: byte 0 picks the read size (1..64, as UART reads come in chunks),
+// the rest is the DIN byte stream. Checks that every packet is well formed
+// and that the packets do not depend on how the stream was split.
+#include "midi_codec.h"
+#include "midi_route_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PACKETS     4096
+
+typedef struct {
+    uint8_t packets[MAX_PACKETS][4];
+    size_t count;
+} packet_log_t;
+
+static midi_route_table_t table;
+static bool table_ready = false;
+
+static void check_packet(const uint8_t p[4])
+{
+    uint8_t cin = p[0] & 0x0F;
+    uint8_t len = midi_cin_length[cin];
+
+    if ((p[0] >> 4) != 0 || len == 0) {
+        abort();        // wrong cable or reserved CIN
+    }
+    for (int i = 1 + len; i < 4; i++) {
+        if (p[i] != 0) {
+            abort();    // padding must be zero
+        }
+    }
+    if (cin >= 0x8 && cin <= 0xE) {
+        if ((p[1] >> 4) != cin || p[2] >= 0x80 || p[3] >= 0x80) {
+            abort();
+        }
+    } else if (cin == 0xF) {
+        if (p[1] < 0xF8) {
+            abort();    // single bytes out of the parser are real-time
+        }
+    } else if (cin == 0x4) {
+        // SysEx start/continue: data bytes, F0 only in front
+        if ((p[1] >= 0x80 && p[1] != 0xF0) || p[2] >= 0x80 || p[3] >= 0x80) {
+            abort();
+        }
+    }
+}
+
+static void log_packet(const uint8_t packet[4], void *ctx)
+{
+    packet_log_t *log = ctx;
+    check_packet(packet);
+    if (log->count < MAX_PACKETS) {
+        memcpy(log->packets[log->count++], packet, 4);
+    }
+
+    uint8_t out[MIDI_OUT_COUNT][4];
+    uint32_t mask = midi_route_table_apply(&table, MIDI_IN_DIN, packet, out);
+    if (mask & ~MIDI_OUT_MASK_ALL) {
+        abort();
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static packet_log_t whole, chunked;
+
+    if (!table_ready) {
+        const midi_route_rule_t rule = {
+            .inputs = MIDI_IN_MASK(MIDI_IN_DIN), .outputs = MIDI_ROUTE_OUT_USB,
+            .channels = MIDI_ROUTE_ALL_CHANNELS, .types = MIDI_ROUTE_ALL_TYPES,
+            .channel_out = -1, .cc_in = -1, .cc_out = -1,
+            .curve = MIDI_CURVE_LINEAR, .value_min = 0, .value_max = 127,
+        };
+        midi_route_table_compile(&table, &rule, 1, MIDI_OUT_MASK(MIDI_OUT_HOST));
+        table_ready = true;
+    }
+    if (size < 1) {
+        return 0;
+    }
+    size_t chunk = (data[0] & 0x3F) + 1;
+    data++;
+    size--;
+
+    midi_stream_parser_t parser;
+    whole.count = 0;
+    midi_stream_parser_init(&parser, 0);
+    midi_stream_parser_feed(&parser, data, size, log_packet, &whole);
+
+    chunked.count = 0;
+    midi_stream_parser_init(&parser, 0);
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t n = size - offset < chunk ? size - offset : chunk;
+        midi_stream_parser_feed(&parser, &data[offset], n, log_packet, &chunked);
+    }
+
+    if (whole.count != chunked.count ||
+        memcmp(whole.packets, chunked.packets, whole.count * 4) != 0) {
+        abort();
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+//fuzz_replay.c
+// Stand-in for the libFuzzer driver when the targets are built without
+// clang (MIDI_FUZZ=OFF): runs every file of the given corpus directories (or
+// single files) through LLVMFuzzerTestOneInput, rounds times, and reports
+// the throughput. A crash or abort still fails the run, so the corpus doubles
+// as a regression test and a throughput baseline for parser changes.
+//
+// usage: fuzz_<target> [-r rounds] corpus_dir|file...
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} input_t;
+
+static input_t *inputs = NULL;
+static size_t input_count = 0;
+
+static int add_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    input_t in = { .data = malloc(size > 0 ? (size_t)size : 1), .size = size > 0 ? (size_t)size : 0 };
+    input_t *grown = realloc(inputs, (input_count + 1) * sizeof(*inputs));
+    if (in.data == NULL || grown == NULL || fread(in.data, 1, in.size, f) != in.size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        free(in.data);
+        return -1;
+    }
+    fclose(f);
+    inputs = grown;
+    inputs[input_count++] = in;
+    return 0;
+}
+
+static int add_path(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "%s: not found\n", path);
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return add_file(path);
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return -1;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char file[4096];
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        if (add_file(file) != 0) {
+            closedir(dir);
+            return -1;
+        }
+    }
+    closedir(dir);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = 1;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        rounds = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || rounds < 1) {
+        fprintf(stderr, "usage: %s [-r rounds] corpus_dir|file...\n", argv[0]);
+        return 2;
+    }
+    for (int i = first; i < argc; i++) {
+        if (add_path(argv[i]) != 0) {
+            return 1;
+        }
+    }
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < input_count; i++) {
+        bytes += inputs[i].size;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < input_count; i++) {
+            LLVMFuzzerTestOneInput(inputs[i].data, inputs[i].size);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    double total = (double)bytes * rounds;
+    printf("%s: %zu inputs, %zu bytes, %d rounds: %.2f ns/byte, %.1f MB/s\n", argv[0], input_count, bytes,
+           rounds, total ? ns / total : 0.0, ns ? total * 1000.0 / ns : 0.0);
+    return 0;
+}
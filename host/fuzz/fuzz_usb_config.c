@@ -0,0 +1,25 @@
+//fuzz_usb_config.c
+// Configuration descriptor walk of get_midi_interface_settings
+// (midi_usb_find_interface) on arbitrary bytes. Checks that a returned
+// interface has endpoints of the right direction and a usable packet size.
+// The OUT endpoint is optional (read-only devices): 0 with no packet size.
+#include "midi_usb_desc.h"
+#include <stdlib.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    midi_usb_interface_t found;
+    if (!midi_usb_find_interface(data, size, &found)) {
+        return 0;
+    }
+    if (!(found.endpoint_in & 0x80) || (found.endpoint_in & 0x0F) == 0 ||
+        found.max_packet_in == 0 || found.max_packet_in > 1024) {
+        abort();
+    }
+    if (found.endpoint_out == 0 ? found.max_packet_out != 0
+                                : ((found.endpoint_out & 0x80) || (found.endpoint_out & 0x0F) == 0 ||
+                                   found.max_packet_out == 0 || found.max_packet_out > 1024)) {
+        abort();
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+//fuzz_usb_rx.c
+// USB RX path of the host/device RX callbacks: each USB-MIDI packet through
+// the routing table, the packets routed to DIN batched and encoded to
+// MIDI 1.0 as the usb_to_uart task does.
+//
+// Input: 12 bytes of routing rule (the transform applied to USB input), then
+// USB-MIDI packets. Checks that routing keeps the packet type, that the
+// encoder never writes more than 3 bytes per packet and that a batch
+// encodes every packet (same byte count as encoding them one by one).
+#include "midi_codec.h"
+#include "midi_route_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RULE_BYTES      12
+
+static void rule_from_bytes(midi_route_rule_t *rule, const uint8_t *b)
+{
+    rule->inputs = MIDI_IN_MASK(MIDI_IN_USB);
+    rule->outputs = b[0];
+    rule->channels = (uint16_t)(b[1] | (b[2] << 8));
+    rule->types = (uint16_t)(b[3] | (b[4] << 8));
+    rule->channel_out = (int8_t)b[5];
+    rule->cc_in = (int8_t)b[6];
+    rule->cc_out = (int8_t)b[7];
+    rule->curve = b[8];
+    rule->value_min = b[9];
+    rule->value_max = b[10];
+    (void)b[11];    // reserved: keeps packets 4-byte aligned in the input
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static midi_route_table_t table;
+
+    if (size < RULE_BYTES) {
+        return 0;
+    }
+    midi_route_rule_t rules[2];
+    rule_from_bytes(&rules[0], data);
+    // Plain USB -> DIN underneath, as in the default rules
+    rules[1] = (midi_route_rule_t){
+        .inputs = MIDI_IN_MASK(MIDI_IN_USB), .outputs = MIDI_OUT_MASK(MIDI_OUT_DIN),
+        .channels = MIDI_ROUTE_ALL_CHANNELS, .types = MIDI_ROUTE_ALL_TYPES,
+        .channel_out = -1, .cc_in = -1, .cc_out = -1,
+        .curve = MIDI_CURVE_LINEAR, .value_min = 0, .value_max = 127,
+    };
+    if (!midi_route_table_compile(&table, rules, 2, MIDI_OUT_MASK(MIDI_OUT_HOST))) {
+        return 0;
+    }
+    data += RULE_BYTES;
+    size -= RULE_BYTES;
+
+    midi_din_encoder_t enc, single;
+    midi_din_encoder_reset(&enc);
+    midi_din_encoder_reset(&single);
+    uint8_t din_batch[64];
+    size_t din_len = 0;
+    size_t single_len = 0;
+    // The midi_din_encode_packets contract, as midi_uart.c sizes its batch
+    uint8_t din[sizeof(din_batch) / 4 * 3];
+
+    for (size_t offset = 0; offset + 4 <= size; offset += 4) {
+        const uint8_t *packet = &data[offset];
+        uint8_t out[MIDI_OUT_COUNT][4];
+        uint32_t mask = midi_route_table_apply(&table, MIDI_IN_USB, packet, out);
+        if (mask & ~MIDI_OUT_MASK_ALL) {
+            abort();
+        }
+
+        for (int o = 0; o < MIDI_OUT_COUNT; o++) {
+            if (!(mask & MIDI_OUT_MASK(o))) {
+                continue;
+            }
+            // Routing changes channel, CC number and value, never the type
+            if (out[o][0] != packet[0]) {
+                abort();
+            }
+            if (packet[1] >= 0x80 && packet[1] < 0xF0) {
+                if ((out[o][1] & 0xF0) != (packet[1] & 0xF0)) {
+                    abort();
+                }
+                if ((out[o][1] & 0xF0) == 0xB0 && (out[o][2] > 0x7F || out[o][3] > 0x7F)) {
+                    abort();
+                }
+            }
+        }
+
+        if (mask & MIDI_OUT_MASK(MIDI_OUT_DIN)) {
+            memcpy(&din_batch[din_len], out[MIDI_OUT_DIN], 4);
+            din_len += 4;
+            uint8_t one[3];
+            single_len += midi_din_encode_packet(&single, out[MIDI_OUT_DIN], one);
+        }
+        if (din_len == sizeof(din_batch) || (offset + 8 > size && din_len > 0)) {
+            size_t n = midi_din_encode_packets(&enc, din_batch, din_len, din, sizeof(din));
+            // Real-time bytes are hoisted, but running status only follows
+            // channel messages, whose order is kept: nothing may be dropped
+            if (n > din_len / 4 * 3 || n != single_len) {
+                abort();
+            }
+            din_len = 0;
+            single_len = 0;
+        }
+    }
+    return 0;
+}
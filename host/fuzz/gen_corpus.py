@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+#
+# Generate the seed / throughput corpus of the fuzz targets (host/CMakeLists
+# runs it into the build directory):
+#
+#   gen_corpus.py <output_dir>
+#
+# din_parser  - the cases of host/corpus/din_parser.txt, plus large streams
+#               that are the throughput baseline (fuzz_din_parser -r N ...)
+# usb_rx      - routing rule + the cases of host/corpus/din_encoder.txt,
+#               plus a large packet stream
+# usb_config  - configuration descriptors of real device layouts and a few
+#               malformed ones
+#
+# The output is deterministic, so throughput numbers stay comparable.
+
+import os
+import random
+import re
+import struct
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+CASES = os.path.join(HERE, '..', 'corpus')
+CORPUS = None
+
+
+def write(target, name, data):
+    path = os.path.join(CORPUS, target)
+    os.makedirs(path, exist_ok=True)
+    with open(os.path.join(path, name), 'wb') as f:
+        f.write(bytes(data))
+
+
+def read_cases(name, first):
+    # Inputs of the cases whose first line is 'first:' in a text corpus
+    cases = []
+    expect_input = True
+    with open(os.path.join(CASES, name)) as f:
+        for line in f:
+            line = line.split('#')[0].strip()
+            if not line:
+                continue
+            kind, _, hexbytes = line.partition(':')
+            if expect_input and kind == first:
+                cases.append([int(b, 16) for b in re.findall(r'[0-9A-Fa-f]{2}', hexbytes)])
+            expect_input = not expect_input
+    return cases
+
+
+def din_stream(rng, size):
+    # Pedalboard-like DIN traffic, same mix as midi_bench
+    out = []
+    while len(out) + 16 <= size:
+        ch = rng.randrange(16)
+        v = rng.randrange(128)
+        kind = rng.randrange(8)
+        if kind < 3:
+            out += [0xB0 | ch] + sum([[7, (v + i) & 0x7F] for i in range(4)], [])
+        elif kind == 3:
+            out += [0x90 | ch, v, 0xF8, 100, v, 0]
+        elif kind == 4:
+            out += [0xC0 | ch, v]
+        elif kind == 5:
+            out += [0xE0 | ch, 0, v]
+        elif kind == 6:
+            out += [0xF8]
+        else:
+            out += [0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7]
+    return out
+
+
+def usb_packets(rng, count):
+    out = []
+    for _ in range(count):
+        ch = rng.randrange(16)
+        v = rng.randrange(128)
+        kind = rng.randrange(6)
+        if kind < 3:
+            out += [0x0B, 0xB0 | ch, rng.randrange(128), v]
+        elif kind == 3:
+            out += [0x09, 0x90 | ch, v, 100]
+        elif kind == 4:
+            out += [0x0F, 0xF8, 0, 0]
+        else:
+            out += [0x04, 0xF0 if rng.randrange(4) == 0 else v, v, v]
+    return out
+
+
+# Routing rule header of fuzz_usb_rx (see rule_from_bytes)
+def rule(outputs, channels=0xFFFF, types=0xFF00, channel_out=-1, cc_in=-1, cc_out=-1,
+         curve=0, value_min=0, value_max=127):
+    return list(struct.pack('<BHHbbbBBBx', outputs, channels, types, channel_out, cc_in, cc_out,
+                            curve, value_min, value_max))
+
+
+PASSTHROUGH = rule(0x80)
+REMAP = rule(0x84, types=1 << 0xB, channel_out=0, cc_in=7, cc_out=11, curve=1, value_min=10, value_max=120)
+
+
+def config(interfaces, total=None):
+    body = sum(interfaces, [])
+    length = 9 + len(body)
+    head = [9, 0x02, 0, 0, 1, 1, 0, 0x80, 50]
+    head[2:4] = list(struct.pack('<H', total if total is not None else length))
+    head[4] = sum(1 for d in interfaces if d[1] == 0x04 and d[3] == 0)
+    return head + body
+
+
+def interface(number, cls, subclass, endpoints, alt=0):
+    return [9, 0x04, number, alt, endpoints, cls, subclass, 0, 0]
+
+
+def endpoint(address, attributes=0x02, max_packet=64):
+    return [9, 0x05, address, attributes] + list(struct.pack('<H', max_packet)) + [0, 0, 0]
+
+
+def cs_midi_header():
+    # Class-specific MS interface header + one embedded/external jack pair
+    return ([7, 0x24, 0x01, 0x00, 0x01, 0x41, 0x00] +
+            [6, 0x24, 0x02, 0x01, 0x01, 0x00] + [6, 0x24, 0x02, 0x02, 0x02, 0x00] +
+            [9, 0x24, 0x03, 0x01, 0x03, 0x01, 0x02, 0x01, 0x00] +
+            [9, 0x24, 0x03, 0x02, 0x04, 0x01, 0x01, 0x01, 0x00])
+
+
+def cs_endpoint(jack):
+    return [5, 0x25, 0x01, 0x01, jack]
+
+
+def main():
+    global CORPUS
+    if len(sys.argv) != 2:
+        sys.exit('usage: %s <output_dir>' % sys.argv[0])
+    CORPUS = sys.argv[1]
+    rng = random.Random(1)
+
+    # din_parser: first byte is the read size - 1
+    for i, case in enumerate(read_cases('din_parser.txt', 'din')):
+        write('din_parser', 'case_%02d' % i, [0x03] + case)
+    write('din_parser', 'stream_mixed_64k', [0x3F] + din_stream(rng, 65536))
+    write('din_parser', 'stream_running_status_16k',
+          [0x3F, 0xB0] + sum([[7, v & 0x7F] for v in range(8192)], []))
+    write('din_parser', 'stream_sysex_16k', [0x3F, 0xF0] + [v & 0x7F for v in range(16382)] + [0xF7])
+    write('din_parser', 'stream_clock_split_4k', [0x00] + [0x90, 0x40, 0xF8, 0x7F] * 1024)
+
+    # usb_rx: rule header + packets
+    for i, case in enumerate(read_cases('din_encoder.txt', 'usb')):
+        write('usb_rx', 'case_%02d' % i, PASSTHROUGH + case)
+    write('usb_rx', 'remap_cc', REMAP + sum([[0x0B, 0xB3, 7, v] for v in range(128)], []))
+    write('usb_rx', 'stream_mixed_64k', PASSTHROUGH + usb_packets(rng, 16384))
+    write('usb_rx', 'stream_remap_64k', REMAP + usb_packets(rng, 16384))
+
+    # usb_config
+    ac = interface(0, 0x01, 0x01, 0) + [9, 0x24, 0x01, 0x00, 0x01, 0x09, 0x00, 0x01, 0x01]
+    ms = (interface(1, 0x01, 0x03, 2) + cs_midi_header() +
+          endpoint(0x01) + cs_endpoint(1) + endpoint(0x81) + cs_endpoint(3))
+    write('usb_config', 'midi_adapter', config([ac, ms]))
+    hid = interface(2, 0x03, 0x00, 1) + [9, 0x21, 0x11, 0x01, 0, 1, 0x22, 0x20, 0] + endpoint(0x83, 0x03, 8)
+    write('usb_config', 'composite_hid_after', config([ac, ms, hid]))
+    write('usb_config', 'composite_hid_before', config([hid, ac, ms]))
+    ms_int = (interface(1, 0x01, 0x03, 2) + cs_midi_header() +
+              endpoint(0x02, 0x03, 16) + cs_endpoint(1) + endpoint(0x82, 0x03, 16) + cs_endpoint(3))
+    write('usb_config', 'interrupt_endpoints', config([ac, ms_int]))
+    ms_hs = (interface(1, 0x01, 0x03, 2) + cs_midi_header() +
+             endpoint(0x01, 0x02, 512) + cs_endpoint(1) + endpoint(0x81, 0x02, 512) + cs_endpoint(3))
+    write('usb_config', 'high_speed_512', config([ac, ms_hs]))
+    ms_alt = (interface(1, 0x01, 0x03, 0) + interface(1, 0x01, 0x03, 2, alt=1) + cs_midi_header() +
+              endpoint(0x01) + cs_endpoint(1) + endpoint(0x81) + cs_endpoint(3))
+    write('usb_config', 'alternate_setting', config([ac, ms_alt]))
+    ms_in_only = interface(1, 0x01, 0x03, 1) + cs_midi_header() + endpoint(0x81) + cs_endpoint(3)
+    write('usb_config', 'in_only', config([ac, ms_in_only]))
+    # Read-only device followed by an interface with an OUT endpoint, which
+    # must not be taken as the MIDI OUT
+    vendor_out = interface(2, 0xFF, 0x00, 1) + endpoint(0x02)
+    write('usb_config', 'read_only_then_vendor_out', config([ac, ms_in_only, vendor_out]))
+    good = config([ac, ms])
+    write('usb_config', 'truncated', good[:len(good) - 5])
+    write('usb_config', 'total_too_long', config([ac, ms], total=0xFFFF))
+    zero = list(good)
+    zero[9] = 0
+    write('usb_config', 'zero_length_descriptor', zero)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,15 @@
+//gpio.h
+#pragma once
+
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef enum {
+    GPIO_MODE_INPUT,
+    GPIO_MODE_OUTPUT,
+} gpio_mode_t;
+
+static inline esp_err_t gpio_reset_pin(gpio_num_t gpio) { (void)gpio; return ESP_OK; }
+static inline esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode) { (void)gpio; (void)mode; return ESP_OK; }
+static inline esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level) { (void)gpio; (void)level; return ESP_OK; }
@@ -0,0 +1,70 @@
+//i2c_master.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// The i2c_master calls of ssd1306_i2c_new.c. Bus and device creation just
+// succeed; the bytes go out through board_hal_i2c_transmit (board_hal_linux.c).
+
+typedef int i2c_port_t;
+#define I2C_NUM_0 0
+#define I2C_NUM_1 1
+
+typedef enum { I2C_CLK_SRC_DEFAULT } i2c_clock_source_t;
+typedef enum { I2C_ADDR_BIT_LEN_7 } i2c_addr_bit_len_t;
+
+typedef struct i2c_master_bus_t *i2c_master_bus_handle_t;
+typedef struct i2c_master_dev_t *i2c_master_dev_handle_t;
+
+typedef struct {
+    i2c_clock_source_t clk_source;
+    uint32_t glitch_ignore_cnt;
+    i2c_port_t i2c_port;
+    int scl_io_num;
+    int sda_io_num;
+    int trans_queue_depth;
+    struct {
+        uint32_t enable_internal_pullup : 1;
+    } flags;
+} i2c_master_bus_config_t;
+
+typedef struct {
+    i2c_addr_bit_len_t dev_addr_length;
+    uint16_t device_address;
+    uint32_t scl_speed_hz;
+} i2c_device_config_t;
+
+typedef struct {
+    int event;
+} i2c_master_event_data_t;
+
+typedef bool (*i2c_master_callback_t)(i2c_master_dev_handle_t dev, const i2c_master_event_data_t *evt_data, void *arg);
+
+typedef struct {
+    i2c_master_callback_t on_trans_done;
+} i2c_master_event_callbacks_t;
+
+static inline esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *config, i2c_master_bus_handle_t *bus)
+{
+    (void)config;
+    *bus = (i2c_master_bus_handle_t)1;
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *config,
+                                                  i2c_master_dev_handle_t *dev)
+{
+    (void)bus;
+    (void)config;
+    *dev = (i2c_master_dev_handle_t)1;
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus, int timeout_ms)
+{
+    (void)bus;
+    (void)timeout_ms;
+    return ESP_OK;
+}
@@ -0,0 +1,5 @@
+//spi_master.h
+#pragma once
+
+// Handle type only: the SPI transport is not emulated (host/oled/ssd1306_spi_host.c)
+typedef struct spi_device_t *spi_device_handle_t;
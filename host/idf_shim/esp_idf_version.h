@@ -0,0 +1,6 @@
+//esp_idf_version.h
+#pragma once
+
+// The version the firmware is built with (IDF 5.5)
+#define ESP_IDF_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(5, 5, 1)
@@ -0,0 +1,17 @@
+//FreeRTOS.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_idf_version.h"
+#include "esp_err.h"
+
+typedef int32_t BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define portTICK_PERIOD_MS  1
+#define portMAX_DELAY       UINT32_MAX
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
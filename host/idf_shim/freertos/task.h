@@ -0,0 +1,10 @@
+//task.h
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+// Single threaded: delays (scroll/fade animations) return at once
+static inline void vTaskDelay(TickType_t ticks)
+{
+    (void)ticks;
+}
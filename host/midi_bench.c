@@ -0,0 +1,431 @@
+//midi_bench.c
+// Host benchmark of the MIDI core: checks the DIN parser/encoder against the
+// conformance corpus, then reports parser throughput and ns/message for
+// parse, route and encode.
+//
+// usage: midi_bench [corpus_dir]     (exit status 1 on any corpus mismatch)
+#include "midi_codec.h"
+#include "midi_route_table.h"
+#include "midi_mpmc.h"
+#include "midi_ui_format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#ifndef MIDI_CORPUS_DIR
+#define MIDI_CORPUS_DIR "corpus"
+#endif
+
+#define MAX_BYTES       512
+#define STREAM_BYTES    (1 << 20)
+#define ROUNDS          20
+
+static volatile uint32_t sink;  // keeps results alive
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// ---------------------------------------------------------------------------
+// Conformance corpus
+//
+// Each case is two lines, "din:" MIDI 1.0 bytes and "usb:" USB-MIDI packets,
+// in hex. The first line is the input: din -> usb checks the parser, usb ->
+// din the encoder. '|' is ignored (packet separator for readability),
+// '#' starts a comment. Every case starts from a fresh parser/encoder.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint8_t bytes[MAX_BYTES];
+    size_t length;
+} byte_buf_t;
+
+static void collect(const uint8_t packet[4], void *ctx)
+{
+    byte_buf_t *buf = ctx;
+    if (buf->length + 4 <= MAX_BYTES) {
+        memcpy(&buf->bytes[buf->length], packet, 4);
+        buf->length += 4;
+    }
+}
+
+static bool parse_hex(const char *text, byte_buf_t *buf)
+{
+    buf->length = 0;
+    while (*text) {
+        if (isspace((unsigned char)*text) || *text == '|') {
+            text++;
+            continue;
+        }
+        unsigned value;
+        int used;
+        if (sscanf(text, "%2x%n", &value, &used) != 1 || used != 2 || buf->length >= MAX_BYTES) {
+            return false;
+        }
+        buf->bytes[buf->length++] = (uint8_t)value;
+        text += used;
+    }
+    return true;
+}
+
+static void print_hex(const char *label, const byte_buf_t *buf)
+{
+    printf("    %s", label);
+    for (size_t i = 0; i < buf->length; i++) {
+        printf(" %02X", buf->bytes[i]);
+    }
+    printf("\n");
+}
+
+// Parser output must not depend on how the stream is split between reads
+static bool check_parse(const byte_buf_t *din, const byte_buf_t *usb)
+{
+    for (int split = 0; split < 2; split++) {
+        midi_stream_parser_t parser;
+        byte_buf_t got = { .length = 0 };
+        midi_stream_parser_init(&parser, 0);
+        if (split) {
+            for (size_t i = 0; i < din->length; i++) {
+                midi_stream_parser_feed(&parser, &din->bytes[i], 1, collect, &got);
+            }
+        } else {
+            midi_stream_parser_feed(&parser, din->bytes, din->length, collect, &got);
+        }
+        if (got.length != usb->length || memcmp(got.bytes, usb->bytes, got.length) != 0) {
+            printf("  %s feed\n", split ? "byte-by-byte" : "single");
+            print_hex("got:     ", &got);
+            print_hex("expected:", usb);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_encode(const byte_buf_t *usb, const byte_buf_t *din)
+{
+    midi_din_encoder_t enc;
+    byte_buf_t got;
+    midi_din_encoder_reset(&enc);
+    got.length = midi_din_encode_packets(&enc, usb->bytes, usb->length, got.bytes, sizeof(got.bytes));
+    if (got.length != din->length || memcmp(got.bytes, din->bytes, got.length) != 0) {
+        print_hex("got:     ", &got);
+        print_hex("expected:", din);
+        return false;
+    }
+    return true;
+}
+
+static int run_corpus(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        printf("%s: cannot open\n", path);
+        return -1;
+    }
+
+    char line[1024];
+    char first_kind[4] = "";
+    byte_buf_t first, second;
+    int line_no = 0, first_line = 0, cases = 0, failures = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        char *text = line;
+        while (isspace((unsigned char)*text)) {
+            text++;
+        }
+        if (*text == '\0') {
+            continue;
+        }
+
+        const char *kind = strncmp(text, "din:", 4) == 0 ? "din" :
+                           strncmp(text, "usb:", 4) == 0 ? "usb" : NULL;
+        byte_buf_t *buf = first_kind[0] ? &second : &first;
+        if (kind == NULL || !parse_hex(text + 4, buf)) {
+            printf("%s:%d: syntax error\n", path, line_no);
+            failures++;
+            first_kind[0] = '\0';
+            continue;
+        }
+
+        if (!first_kind[0]) {
+            strcpy(first_kind, kind);
+            first_line = line_no;
+            continue;
+        }
+        if (strcmp(kind, first_kind) == 0) {
+            printf("%s:%d: expected the other direction of the case at line %d\n", path, line_no, first_line);
+            failures++;
+            first_kind[0] = '\0';
+            continue;
+        }
+
+        cases++;
+        bool parse = strcmp(first_kind, "din") == 0;
+        bool ok = parse ? check_parse(&first, &second) : check_encode(&first, &second);
+        if (!ok) {
+            printf("%s:%d: %s mismatch\n", path, first_line, parse ? "parser" : "encoder");
+            failures++;
+        }
+        first_kind[0] = '\0';
+    }
+    fclose(f);
+
+    if (first_kind[0]) {
+        printf("%s:%d: case without expected output\n", path, first_line);
+        failures++;
+    }
+    printf("%-40s %3d cases, %d failed\n", path, cases, failures);
+    return failures;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+// Pedalboard-like DIN traffic: running-status CC sweeps, notes, clock
+// interleaved anywhere, program changes and a short SysEx now and then
+static size_t make_stream(uint8_t *out, size_t size)
+{
+    uint32_t rng = 12345;
+    size_t n = 0;
+
+    while (n + 16 <= size) {
+        rng = rng * 1103515245u + 12345u;
+        uint8_t ch = (rng >> 16) & 0x0F;
+        uint8_t v = (rng >> 8) & 0x7F;
+        switch ((rng >> 24) & 7) {
+        case 0: case 1: case 2:                 // CC burst with running status
+            out[n++] = 0xB0 | ch;
+            for (int i = 0; i < 4; i++) {
+                out[n++] = 7;
+                out[n++] = (uint8_t)((v + i) & 0x7F);
+            }
+            break;
+        case 3:                                 // note on/off, clock in between
+            out[n++] = 0x90 | ch;
+            out[n++] = v;
+            out[n++] = 0xF8;
+            out[n++] = 100;
+            out[n++] = v;
+            out[n++] = 0;
+            break;
+        case 4:
+            out[n++] = 0xC0 | ch;
+            out[n++] = v;
+            break;
+        case 5:
+            out[n++] = 0xE0 | ch;
+            out[n++] = 0;
+            out[n++] = v;
+            break;
+        case 6:
+            out[n++] = 0xF8;
+            break;
+        default:
+            out[n++] = 0xF0;
+            out[n++] = 0x7E;
+            out[n++] = 0x7F;
+            out[n++] = 0x06;
+            out[n++] = 0x01;
+            out[n++] = 0xF7;
+            break;
+        }
+    }
+    return n;
+}
+
+typedef struct {
+    uint8_t *packets;
+    size_t length;
+    size_t size;
+} packet_buf_t;
+
+static void store_packet(const uint8_t packet[4], void *ctx)
+{
+    packet_buf_t *buf = ctx;
+    if (buf->length + 4 <= buf->size) {
+        memcpy(&buf->packets[buf->length], packet, 4);
+        buf->length += 4;
+    }
+}
+
+static void count_packet(const uint8_t packet[4], void *ctx)
+{
+    (void)ctx;
+    sink += packet[1];
+}
+
+static void report(const char *name, uint64_t ns, size_t messages)
+{
+    printf("%-28s %8.1f ns/message  (%zu messages)\n", name, (double)ns / (double)messages, messages);
+}
+
+static void bench_parse(const uint8_t *stream, size_t length, size_t messages)
+{
+    uint64_t best = UINT64_MAX;
+    for (int round = 0; round < ROUNDS; round++) {
+        midi_stream_parser_t parser;
+        midi_stream_parser_init(&parser, 0);
+        uint64_t start = now_ns();
+        // UART reads come in at most 64-byte chunks
+        for (size_t offset = 0; offset < length; offset += 64) {
+            size_t chunk = length - offset < 64 ? length - offset : 64;
+            midi_stream_parser_feed(&parser, &stream[offset], chunk, count_packet, NULL);
+        }
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    report("parse (DIN -> USB-MIDI)", best, messages);
+    printf("%-28s %8.1f MB/s\n", "parse throughput", (double)length * 1000.0 / (double)best);
+}
+
+static void bench_route(const char *name, const midi_route_rule_t *rules, size_t count,
+                        const packet_buf_t *packets)
+{
+    static midi_route_table_t table;
+    if (!midi_route_table_compile(&table, rules, count, MIDI_OUT_MASK(MIDI_OUT_HOST))) {
+        printf("%s: compile failed\n", name);
+        return;
+    }
+
+    size_t messages = packets->length / 4;
+    uint64_t best = UINT64_MAX;
+    for (int round = 0; round < ROUNDS; round++) {
+        uint8_t out[MIDI_OUT_COUNT][4];
+        uint32_t outputs = 0;
+        uint64_t start = now_ns();
+        for (size_t offset = 0; offset < packets->length; offset += 4) {
+            outputs += midi_route_table_apply(&table, MIDI_IN_DIN, &packets->packets[offset], out);
+        }
+        uint64_t elapsed = now_ns() - start;
+        sink += outputs + out[0][1];
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    report(name, best, messages);
+}
+
+static void bench_encode(const packet_buf_t *packets)
+{
+    size_t messages = packets->length / 4;
+    uint64_t best = UINT64_MAX;
+    for (int round = 0; round < ROUNDS; round++) {
+        midi_din_encoder_t enc;
+        uint8_t out[16 * 3];
+        size_t total = 0;
+        midi_din_encoder_reset(&enc);
+        uint64_t start = now_ns();
+        // usb_to_uart encodes one 64-byte USB transfer at a time
+        for (size_t offset = 0; offset < packets->length; offset += 64) {
+            size_t chunk = packets->length - offset < 64 ? packets->length - offset : 64;
+            total += midi_din_encode_packets(&enc, &packets->packets[offset], chunk, out, sizeof(out));
+        }
+        uint64_t elapsed = now_ns() - start;
+        sink += (uint32_t)total;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    report("encode (USB-MIDI -> DIN)", best, messages);
+}
+
+static void bench_mpmc(void)
+{
+    static midi_mpmc_cell_t cells[256];
+    midi_mpmc_queue_t q;
+    const size_t messages = 1000000;
+    midi_mpmc_init(&q, cells, 256);
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < messages; i++) {
+        uint16_t value;
+        midi_mpmc_enqueue(&q, (uint16_t)i);
+        midi_mpmc_dequeue(&q, &value);
+        sink += value;
+    }
+    report("router queue (enq + deq)", now_ns() - start, messages);
+}
+
+static void bench_format(void)
+{
+    const size_t lines = 1000000;
+    char line[18];
+    uint8_t data[4] = { 0x0B, 0xB0, 0x07, 0x7F };
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < lines; i++) {
+        data[3] = (uint8_t)i & 0x7F;
+        sink += (uint32_t)midi_format_button_line(line, (int)(i & 7) + 1, data, i & 1);
+    }
+    report("format button line", now_ns() - start, lines);
+}
+
+int main(int argc, char **argv)
+{
+    const char *corpus_dir = argc > 1 ? argv[1] : MIDI_CORPUS_DIR;
+    char path[512];
+    int failures = 0;
+
+    snprintf(path, sizeof(path), "%s/din_parser.txt", corpus_dir);
+    failures += run_corpus(path) != 0;
+    snprintf(path, sizeof(path), "%s/din_encoder.txt", corpus_dir);
+    failures += run_corpus(path) != 0;
+    printf("\n");
+
+    uint8_t *stream = malloc(STREAM_BYTES);
+    packet_buf_t packets = { .packets = malloc(STREAM_BYTES * 4), .length = 0, .size = STREAM_BYTES * 4 };
+    if (stream == NULL || packets.packets == NULL) {
+        return 1;
+    }
+    size_t length = make_stream(stream, STREAM_BYTES);
+
+    midi_stream_parser_t parser;
+    midi_stream_parser_init(&parser, 0);
+    midi_stream_parser_feed(&parser, stream, length, store_packet, &packets);
+
+    bench_parse(stream, length, packets.length / 4);
+
+    // Firmware defaults for the DIN input: everything to the USB side
+    const midi_route_rule_t passthrough[] = {
+        { .inputs = MIDI_IN_MASK(MIDI_IN_DIN), .outputs = MIDI_ROUTE_OUT_USB,
+          .channels = MIDI_ROUTE_ALL_CHANNELS, .types = MIDI_ROUTE_ALL_TYPES,
+          .channel_out = -1, .cc_in = -1, .cc_out = -1,
+          .curve = MIDI_CURVE_LINEAR, .value_min = 0, .value_max = 127 },
+    };
+    // Plus a CC 7 -> CC 11 remap with an expression curve, channel 1 forced,
+    // and a copy of everything to the DIN output
+    const midi_route_rule_t transform[] = {
+        passthrough[0],
+        { .inputs = MIDI_IN_MASK(MIDI_IN_DIN), .outputs = MIDI_ROUTE_OUT_USB,
+          .channels = MIDI_ROUTE_ALL_CHANNELS, .types = MIDI_ROUTE_TYPE(0xB0),
+          .channel_out = 0, .cc_in = 7, .cc_out = 11,
+          .curve = MIDI_CURVE_EXP, .value_min = 10, .value_max = 120 },
+        { .inputs = MIDI_IN_MASK(MIDI_IN_DIN), .outputs = MIDI_OUT_MASK(MIDI_OUT_DIN),
+          .channels = MIDI_ROUTE_ALL_CHANNELS, .types = MIDI_ROUTE_ALL_TYPES,
+          .channel_out = -1, .cc_in = -1, .cc_out = -1,
+          .curve = MIDI_CURVE_LINEAR, .value_min = 0, .value_max = 127 },
+    };
+    bench_route("route (passthrough)", passthrough, 1, &packets);
+    bench_route("route (remap + curve + fan)", transform, 3, &packets);
+
+    bench_encode(&packets);
+    bench_mpmc();
+    bench_format();
+
+    free(stream);
+    free(packets.packets);
+    return failures ? 1 : 0;
+}
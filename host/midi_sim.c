@@ -0,0 +1,215 @@
+//midi_sim.c
+// Replays a board_hal timeline (recorded with the console 'hal' command or
+// written by hand) through the MIDI data path of the firmware in USB device
+// mode, on the virtual clock of board_hal_linux.c:
+//
+//   footswitch GPIO edges -> command -> routing -> USB device / DIN OUT
+//   DIN IN (UART RX)      -> parser  -> routing -> USB device
+//   USB RX                -> routing -> encoder -> DIN OUT
+//
+// Reports the latency of each path (input time -> output time on the link:
+// DIN line time at 31250 baud, next 1 ms USB frame) and the DIN OUT load.
+//
+// Scope: the midi_core code is the firmware's own (DIN parser, routing
+// tables, DIN encoder, command packing), as are the board tables of
+// midi_board.h (footswitch pins, debounce window, default rules). The
+// per-input handlers of main/ (button ISR ring and task, USB/UART RX tasks,
+// router queues) need FreeRTOS and are not built here; their glue is the
+// few lines below. Task scheduling on the board is not modeled.
+//
+// usage: midi_sim timeline.txt [capture.txt]
+#include "board_hal.h"
+#include "board_hal_replay.h"
+#include "midi_board.h"
+#include "midi_codec.h"
+#include "midi_command.h"
+#include "midi_route_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define UART_PORT           1       // UART_NUM of main/midi_uart.c
+
+static const int button_gpios[MIDI_BUTTON_COUNT] = MIDI_BUTTON_GPIOS;
+
+typedef struct {
+    uint32_t count;
+    int64_t total_us;
+    int64_t min_us;
+    int64_t max_us;
+} path_stats_t;
+
+static midi_route_table_t table;
+static midi_din_encoder_t din_encoder;
+static midi_stream_parser_t din_parser;
+static midi_command_t commands[MIDI_BUTTON_COUNT];
+static path_stats_t paths[MIDI_IN_COUNT][MIDI_OUT_COUNT];
+static uint32_t din_out_bytes = 0;
+
+static void path_record(midi_input_t in, midi_output_t out, int64_t origin_us)
+{
+    const board_hal_event_t *last = board_hal_capture_get(board_hal_capture_count() - 1);
+    if (last == NULL) {
+        return;
+    }
+    path_stats_t *p = &paths[in][out];
+    int64_t latency = last->time_us - origin_us;
+    if (p->count == 0 || latency < p->min_us) {
+        p->min_us = latency;
+    }
+    if (latency > p->max_us) {
+        p->max_us = latency;
+    }
+    p->total_us += latency;
+    p->count++;
+}
+
+static void route(midi_input_t in, const uint8_t packet[4])
+{
+    uint8_t out[MIDI_OUT_COUNT][4];
+    int64_t origin = board_hal_time_us();
+    uint32_t mask = midi_route_table_apply(&table, in, packet, out);
+
+    if (mask & MIDI_OUT_MASK(MIDI_OUT_DEVICE)) {
+        board_hal_usb_device_write(out[MIDI_OUT_DEVICE]);
+        path_record(in, MIDI_OUT_DEVICE, origin);
+    }
+    if (mask & MIDI_OUT_MASK(MIDI_OUT_DIN)) {
+        uint8_t din[3];
+        size_t len = midi_din_encode_packet(&din_encoder, out[MIDI_OUT_DIN], din);
+        if (len > 0) {
+            board_hal_uart_write(UART_PORT, din, len);
+            din_out_bytes += (uint32_t)len;
+            path_record(in, MIDI_OUT_DIN, origin);
+        }
+    }
+}
+
+static void din_packet(const uint8_t packet[4], void *ctx)
+{
+    (void)ctx;
+    route(MIDI_IN_DIN, packet);
+}
+
+// Edge-triggered press with the lockout window of midi_buttons.c
+static void poll_buttons(void)
+{
+    static bool pressed[MIDI_BUTTON_COUNT];
+    static int64_t lockout_until[MIDI_BUTTON_COUNT];
+    int64_t now = board_hal_time_us();
+
+    for (int i = 0; i < MIDI_BUTTON_COUNT; i++) {
+        bool is_pressed = !board_hal_gpio_get_level(button_gpios[i]);
+        if (is_pressed == pressed[i] || now < lockout_until[i]) {
+            continue;
+        }
+        pressed[i] = is_pressed;
+        lockout_until[i] = now + MIDI_BUTTON_DEBOUNCE_US;
+        if (is_pressed) {
+            route(MIDI_IN_BUTTONS, commands[i].data);
+        }
+    }
+}
+
+static void run_step(void)
+{
+    poll_buttons();
+
+    uint8_t buffer[64];
+    int len;
+    while ((len = board_hal_uart_read(UART_PORT, buffer, sizeof(buffer), 0)) > 0) {
+        midi_stream_parser_feed(&din_parser, buffer, (size_t)len, din_packet, NULL);
+    }
+
+    uint8_t packet[4];
+    while (board_hal_usb_device_read(0, packet)) {
+        route(MIDI_IN_USB, packet);
+    }
+}
+
+static void print_path(const char *name, midi_input_t in, midi_output_t out)
+{
+    const path_stats_t *p = &paths[in][out];
+    if (p->count == 0) {
+        printf("%-16s %8s\n", name, "-");
+        return;
+    }
+    printf("%-16s %8lu %10.1f %10lld %10lld\n", name, (unsigned long)p->count,
+           (double)p->total_us / p->count, (long long)p->min_us, (long long)p->max_us);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s timeline.txt [capture.txt]\n", argv[0]);
+        return 2;
+    }
+
+    board_hal_replay_init(NULL);
+    int inputs = board_hal_replay_load(argv[1]);
+    if (inputs < 0) {
+        return 1;
+    }
+
+    for (int i = 0; i < MIDI_BUTTON_COUNT; i++) {
+        midi_command_set_default(&commands[i], i);
+    }
+    midi_route_table_compile(&table, midi_default_rules, MIDI_DEFAULT_RULE_COUNT,
+                             MIDI_OUT_MASK(MIDI_OUT_DEVICE));
+    midi_din_encoder_reset(&din_encoder);
+    midi_stream_parser_init(&din_parser, 0);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int64_t first = 0, t;
+    bool have_first = board_hal_replay_next(&first);
+    while (board_hal_replay_next(&t)) {
+        board_hal_replay_advance(t);
+        run_step();
+    }
+    // Let the last lockout windows expire
+    board_hal_replay_advance(board_hal_time_us() + MIDI_BUTTON_DEBOUNCE_US);
+    run_step();
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double cpu_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+
+    int64_t last_output = 0;
+    for (size_t i = 0; i < board_hal_capture_count(); i++) {
+        const board_hal_event_t *ev = board_hal_capture_get(i);
+        if (ev->time_us > last_output) {
+            last_output = ev->time_us;
+        }
+    }
+    int64_t span = (have_first && last_output > first) ? last_output - first : 0;
+
+    printf("%d inputs, %zu outputs, %.3f s virtual, %.0f ns host CPU per input\n",
+           inputs, board_hal_capture_count(), span / 1e6, inputs ? cpu_ns / inputs : 0.0);
+    printf("\n%-16s %8s %10s %10s %10s\n", "path", "messages", "avg us", "min us", "max us");
+    print_path("buttons -> USB", MIDI_IN_BUTTONS, MIDI_OUT_DEVICE);
+    print_path("buttons -> DIN", MIDI_IN_BUTTONS, MIDI_OUT_DIN);
+    print_path("DIN -> USB", MIDI_IN_DIN, MIDI_OUT_DEVICE);
+    print_path("USB -> DIN", MIDI_IN_USB, MIDI_OUT_DIN);
+    printf("\nDIN OUT: %lu bytes, %.1f%% of the line over the run\n", (unsigned long)din_out_bytes,
+           span ? din_out_bytes * 320.0 * 100.0 / span : 0.0);
+    if (board_hal_replay_dropped()) {
+        printf("input FIFO overflow: %lu bytes dropped\n", (unsigned long)board_hal_replay_dropped());
+    }
+
+    if (argc == 3) {
+        FILE *f = fopen(argv[2], "w");
+        if (f == NULL) {
+            fprintf(stderr, "%s: cannot write\n", argv[2]);
+            return 1;
+        }
+        char line[128];
+        for (size_t i = 0; i < board_hal_capture_count(); i++) {
+            board_hal_event_format(board_hal_capture_get(i), line, sizeof(line));
+            fprintf(f, "%s\n", line);
+        }
+        fclose(f);
+    }
+    return 0;
+}
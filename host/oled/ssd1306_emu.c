@@ -0,0 +1,274 @@
+//ssd1306_emu.c
+#include "ssd1306_emu.h"
+#include "board_hal_replay.h"
+#include <stdio.h>
+#include <string.h>
+
+#define I2C_HZ              400000  // SSD1306 maximum, same as ssd1306_i2c_new.c
+
+// Addressing modes (command 0x20)
+#define MODE_HORIZONTAL     0
+#define MODE_VERTICAL       1
+#define MODE_PAGE           2
+
+static struct {
+    uint8_t ram[SSD1306_EMU_PAGES][SSD1306_EMU_WIDTH];
+
+    // Address pointer and the windows of horizontal/vertical mode
+    int mode;
+    int column, page;
+    int column_start, column_end;
+    int page_start, page_end;
+
+    // Panel settings
+    bool on;
+    bool inverse;
+    bool all_on;
+    bool segment_remap;     // A1
+    bool com_remap;         // C8
+    uint8_t contrast;
+    uint8_t start_line;
+    uint8_t offset;
+    uint8_t mux;
+
+    // Command being collected (multi-byte commands)
+    uint8_t command;
+    uint8_t args[6];
+    int arg_count;
+    int arg_needed;
+
+    ssd1306_emu_stats_t stats;
+} panel;
+
+// Bytes that follow each multi-byte command
+static int command_args(uint8_t command)
+{
+    switch (command) {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        return 1;
+    case 0x21: case 0x22: case 0xA3:
+        return 2;
+    case 0x29: case 0x2A:
+        return 5;
+    case 0x26: case 0x27:
+        return 6;
+    default:
+        return 0;
+    }
+}
+
+static void run_command(uint8_t command, const uint8_t *args)
+{
+    if (command <= 0x0F) {
+        panel.column = (panel.column & 0xF0) | command;
+    } else if (command <= 0x1F) {
+        panel.column = ((command & 0x07) << 4) | (panel.column & 0x0F);
+    } else if (command >= 0x40 && command <= 0x7F) {
+        panel.start_line = command & 0x3F;
+    } else if (command >= 0xB0 && command <= 0xB7) {
+        panel.page = command & 0x07;
+    } else {
+        switch (command) {
+        case 0x20:
+            panel.mode = args[0] & 0x03;
+            break;
+        case 0x21:
+            panel.column_start = args[0] & 0x7F;
+            panel.column_end = args[1] & 0x7F;
+            panel.column = panel.column_start;
+            break;
+        case 0x22:
+            panel.page_start = args[0] & 0x07;
+            panel.page_end = args[1] & 0x07;
+            panel.page = panel.page_start;
+            break;
+        case 0x81: panel.contrast = args[0]; break;
+        case 0xA0: case 0xA1: panel.segment_remap = command & 1; break;
+        case 0xA4: case 0xA5: panel.all_on = command & 1; break;
+        case 0xA6: case 0xA7: panel.inverse = command & 1; break;
+        case 0xA8: panel.mux = (args[0] & 0x3F) + 1; break;
+        case 0xAE: case 0xAF: panel.on = command & 1; break;
+        case 0xC0: panel.com_remap = false; break;
+        case 0xC8: panel.com_remap = true; break;
+        case 0xD3: panel.offset = args[0] & 0x3F; break;
+        // Scrolling is set up but not animated; timing and power settings
+        // do not change the picture
+        case 0x26: case 0x27: case 0x29: case 0x2A: case 0x2E: case 0x2F: case 0xA3:
+        case 0x8D: case 0xD5: case 0xD9: case 0xDA: case 0xDB: case 0xE3:
+            break;
+        default:
+            panel.stats.errors++;
+            break;
+        }
+    }
+}
+
+static void command_byte(uint8_t byte)
+{
+    if (panel.arg_needed > 0) {
+        panel.args[panel.arg_count++] = byte;
+        if (panel.arg_count == panel.arg_needed) {
+            panel.arg_needed = 0;
+            run_command(panel.command, panel.args);
+        }
+        return;
+    }
+    panel.command = byte;
+    panel.arg_count = 0;
+    panel.arg_needed = command_args(byte);
+    if (panel.arg_needed == 0) {
+        run_command(byte, panel.args);
+    }
+}
+
+// GDDRAM write and pointer increment of the current addressing mode
+static void data_byte(uint8_t byte)
+{
+    panel.ram[panel.page][panel.column] = byte;
+    panel.stats.data_bytes++;
+
+    switch (panel.mode) {
+    case MODE_HORIZONTAL:
+        if (panel.column < panel.column_end) {
+            panel.column++;
+        } else {
+            panel.column = panel.column_start;
+            panel.page = panel.page < panel.page_end ? panel.page + 1 : panel.page_start;
+        }
+        break;
+    case MODE_VERTICAL:
+        if (panel.page < panel.page_end) {
+            panel.page++;
+        } else {
+            panel.page = panel.page_start;
+            panel.column = panel.column < panel.column_end ? panel.column + 1 : panel.column_start;
+        }
+        break;
+    default:
+        // Page mode: the column wraps within the page
+        panel.column = (panel.column + 1) & 0x7F;
+        break;
+    }
+}
+
+static void i2c_sink(const uint8_t *data, size_t length, int64_t done_us, void *ctx)
+{
+    (void)ctx;
+    ssd1306_emu_write(data, length, done_us);
+}
+
+void ssd1306_emu_attach(void)
+{
+    memset(&panel, 0, sizeof(panel));
+    panel.mode = MODE_PAGE;
+    panel.column_end = SSD1306_EMU_WIDTH - 1;
+    panel.page_end = SSD1306_EMU_PAGES - 1;
+    panel.contrast = 0x7F;
+    panel.mux = 64;
+    board_hal_replay_set_i2c_sink(i2c_sink, NULL);
+}
+
+// Each control byte says what follows: Co = 1, one byte then another control
+// byte; Co = 0, the rest of the write. D/C# selects command or data.
+void ssd1306_emu_write(const uint8_t *data, size_t length, int64_t done_us)
+{
+    panel.stats.transactions++;
+    panel.stats.bytes += (uint32_t)length;
+    // Address byte + payload, each followed by an ACK bit
+    panel.stats.bus_us += (int64_t)((length + 1) * 9 * 1000000ULL / I2C_HZ);
+    panel.stats.done_us = done_us;
+
+    size_t i = 0;
+    while (i < length) {
+        uint8_t control = data[i++];
+        bool is_data = control & 0x40;
+        if (control & 0x3F) {
+            panel.stats.errors++;
+        }
+        if (i == length) {
+            // Control byte with nothing after it
+            panel.stats.errors++;
+            break;
+        }
+        size_t end = (control & 0x80) ? i + 1 : length;
+        for (; i < end; i++) {
+            if (is_data) {
+                data_byte(data[i]);
+            } else {
+                command_byte(data[i]);
+            }
+        }
+    }
+}
+
+void ssd1306_emu_take_stats(ssd1306_emu_stats_t *stats)
+{
+    *stats = panel.stats;
+    memset(&panel.stats, 0, sizeof(panel.stats));
+}
+
+const uint8_t *ssd1306_emu_ram(void)
+{
+    return &panel.ram[0][0];
+}
+
+bool ssd1306_emu_display_on(void)
+{
+    return panel.on;
+}
+
+uint8_t ssd1306_emu_contrast(void)
+{
+    return panel.contrast;
+}
+
+void ssd1306_emu_render(ssd1306_emu_image_t image)
+{
+    memset(image, 0, sizeof(ssd1306_emu_image_t));
+    if (!panel.on) {
+        return;
+    }
+
+    for (int y = 0; y < SSD1306_EMU_HEIGHT; y++) {
+        // Rows past the multiplex ratio are not driven
+        int com = panel.com_remap ? y : SSD1306_EMU_HEIGHT - 1 - y;
+        if (com >= panel.mux) {
+            continue;
+        }
+        int row = (com + panel.start_line + panel.offset) % SSD1306_EMU_HEIGHT;
+        for (int x = 0; x < SSD1306_EMU_WIDTH; x++) {
+            int column = panel.segment_remap ? x : SSD1306_EMU_WIDTH - 1 - x;
+            bool lit = panel.all_on || ((panel.ram[row / 8][column] >> (row % 8)) & 1);
+            if (lit != panel.inverse) {
+                image[y][x / 8] |= 0x80 >> (x % 8);
+            }
+        }
+    }
+}
+
+bool ssd1306_emu_write_pbm(const char *path, const ssd1306_emu_image_t image)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "P4\n%d %d\n", SSD1306_EMU_WIDTH, SSD1306_EMU_HEIGHT);
+    bool ok = fwrite(image, sizeof(ssd1306_emu_image_t), 1, f) == 1;
+    return fclose(f) == 0 && ok;
+}
+
+bool ssd1306_emu_read_pbm(const char *path, ssd1306_emu_image_t image)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    int width, height;
+    bool ok = fscanf(f, "P4 %d %d", &width, &height) == 2 &&
+              width == SSD1306_EMU_WIDTH && height == SSD1306_EMU_HEIGHT &&
+              fgetc(f) == '\n' &&
+              fread(image, sizeof(ssd1306_emu_image_t), 1, f) == 1;
+    fclose(f);
+    return ok;
+}
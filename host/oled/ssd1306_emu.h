@@ -0,0 +1,62 @@
+//ssd1306_emu.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 128x64 SSD1306 fed with the raw I2C writes of the driver (control bytes,
+// command stream, GDDRAM data), as they leave board_hal_i2c_transmit on
+// Linux. Keeps the display RAM, the addressing state and the panel settings,
+// renders what the panel would show and counts the bus traffic.
+
+#define SSD1306_EMU_WIDTH   128
+#define SSD1306_EMU_HEIGHT  64
+#define SSD1306_EMU_PAGES   (SSD1306_EMU_HEIGHT / 8)
+
+// Rendered frame, 1 bit per pixel, rows top to bottom, MSB = leftmost
+// pixel (the PBM P4 layout). 1 = lit.
+typedef uint8_t ssd1306_emu_image_t[SSD1306_EMU_HEIGHT][SSD1306_EMU_WIDTH / 8];
+
+typedef struct {
+    uint32_t transactions;      // I2C writes
+    uint32_t bytes;             // bytes after the address byte, control bytes included
+    uint32_t data_bytes;        // bytes written to GDDRAM
+    int64_t bus_us;             // time the bus was busy (400 kHz, 9 bits per byte)
+    int64_t done_us;            // board_hal time the last write finished
+    uint32_t errors;            // unknown commands, truncated transactions
+} ssd1306_emu_stats_t;
+
+// Power-on state (RAM cleared, display off) and hook into board_hal_linux
+void ssd1306_emu_attach(void);
+
+// Feed one I2C write (what follows the address byte). board_hal_linux calls
+// this through the sink set by ssd1306_emu_attach.
+void ssd1306_emu_write(const uint8_t *data, size_t length, int64_t done_us);
+
+// Traffic since the previous call (one call per frame gives per-frame costs)
+void ssd1306_emu_take_stats(ssd1306_emu_stats_t *stats);
+
+// Panel state
+const uint8_t *ssd1306_emu_ram(void);  // [page * 128 + column]
+bool ssd1306_emu_display_on(void);
+uint8_t ssd1306_emu_contrast(void);
+
+// What the panel shows, for a module mounted the way the driver expects
+// (segment remap A1 and COM scan C8 are upright). Off = all dark.
+void ssd1306_emu_render(ssd1306_emu_image_t image);
+
+// Binary PBM (P4) of a rendered frame. Returns false if it cannot be written.
+bool ssd1306_emu_write_pbm(const char *path, const ssd1306_emu_image_t image);
+
+// Load a PBM written by ssd1306_emu_write_pbm. Returns false if it is
+// missing or not a 128x64 P4 file.
+bool ssd1306_emu_read_pbm(const char *path, ssd1306_emu_image_t image);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,58 @@
+//ssd1306_spi_host.c
+// ssd1306.c dispatches on dev->_address; the host build only emulates the
+// I2C panel, so the SPI side of the driver reports and does nothing.
+#include "ssd1306.h"
+#include <stdio.h>
+
+static void spi_unsupported(const char *func)
+{
+    fprintf(stderr, "ssd1306 host: %s: SPI transport is not emulated\n", func);
+}
+
+void spi_init(SSD1306_t * dev, int width, int height)
+{
+    (void)dev;
+    (void)width;
+    (void)height;
+    spi_unsupported(__func__);
+}
+
+void spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
+{
+    (void)dev;
+    (void)page;
+    (void)seg;
+    (void)images;
+    (void)width;
+    spi_unsupported(__func__);
+}
+
+bool spi_display_window(SSD1306_t * dev, int page_start, int page_end, int seg_start, int seg_end)
+{
+    (void)dev;
+    (void)page_start;
+    (void)page_end;
+    (void)seg_start;
+    (void)seg_end;
+    spi_unsupported(__func__);
+    return false;
+}
+
+void spi_wait_done(SSD1306_t * dev)
+{
+    (void)dev;
+}
+
+void spi_contrast(SSD1306_t * dev, int contrast)
+{
+    (void)dev;
+    (void)contrast;
+    spi_unsupported(__func__);
+}
+
+void spi_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll)
+{
+    (void)dev;
+    (void)scroll;
+    spi_unsupported(__func__);
+}
@@ -0,0 +1,284 @@
+//oled_emu.c
+// Runs the display code path of the firmware against an emulated panel:
+// the screens of main/oled_screens.c (the code oled_display.c runs) are drawn
+// with the real ssd1306 driver (draw_text/draw_image into the page buffer,
+// ssd1306_flush, the I2C transport of ssd1306_i2c_new.c) and every I2C write
+// is interpreted by host/oled/ssd1306_emu.c.
+//
+// For each frame of a fixed script it reports the pages sent, the I2C
+// transactions and bytes, the bus time at 400 kHz and the host CPU time of
+// compose + flush. Snapshots of what the panel shows can be written as PBM
+// files or compared against a golden set.
+//
+// usage: oled_emu [-r rounds] [-w dir | -c dir]
+//   -r  compose + flush repetitions per frame for the CPU time (default 1000)
+//   -w  write the snapshots (NN_name.pbm) into dir
+//   -c  compare the snapshots with dir, exit status 1 on any difference
+#include "ssd1306.h"
+#include "ssd1306_emu.h"
+#include "board_hal_replay.h"
+#include "oled_screens.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+typedef struct {
+    const char *name;
+    uint32_t requests;                          // pages and/or OLED_REQ_POWER
+    void (*step)(oled_screen_input_t *in);      // state change before the frame
+} frame_t;
+
+// Globals of main/globals.c used by init_oled() and handed to the screens
+const int I2C_SDA_GPIO = 8;
+const int I2C_SCL_GPIO = 9;
+SSD1306_t dev;
+bool edit_initialized;
+
+static oled_screens_t screens = { .dev = &dev };
+
+// ---------------------------------------------------------------------------
+// Script: what navigation.c, midi_latency and midi_monitor would hand to
+// the screens of main/oled_screens.c
+// ---------------------------------------------------------------------------
+
+static void step_none(oled_screen_input_t *in)
+{
+    (void)in;
+}
+
+static void step_cursor(oled_screen_input_t *in)
+{
+    in->ui.button = 1;
+}
+
+static void step_scroll(oled_screen_input_t *in)
+{
+    in->ui.button = 5;
+    in->ui.scroll_offset = 1;
+}
+
+static void step_edit(oled_screen_input_t *in)
+{
+    in->ui.mode = MODE_EDIT;
+    *in->edit_initialized = false;
+    in->edit_byte_index = 0;
+    in->edit_nibble_index = 0;
+    in->edit_command = in->commands[in->ui.button];
+}
+
+static void step_edit_next(oled_screen_input_t *in)
+{
+    in->edit_nibble_index = 1;
+}
+
+static void step_edit_change(oled_screen_input_t *in)
+{
+    increment_nibble(&in->edit_command.data[in->edit_byte_index], in->edit_nibble_index);
+}
+
+static void step_stats(oled_screen_input_t *in)
+{
+    static const midi_latency_summary_t latency[MIDI_LAT_STAGE_COUNT] = {
+        [MIDI_LAT_ROUTER]   = { .count = 42, .p50_us = 20, .p99_us = 48, .max_us = 61 },
+        [MIDI_LAT_DEQUEUE]  = { .count = 42, .p50_us = 128, .p99_us = 512, .max_us = 530 },
+        [MIDI_LAT_SUBMIT]   = { .count = 42, .p50_us = 160, .p99_us = 640, .max_us = 702 },
+        [MIDI_LAT_COMPLETE] = { .count = 42, .p50_us = 1024, .p99_us = 2048, .max_us = 2310 },
+    };
+
+    in->ui.mode = MODE_STATS;
+    memcpy(in->latency, latency, sizeof(latency));
+}
+
+// Entering the page: the first frame only takes the counter base
+static void step_monitor(oled_screen_input_t *in)
+{
+    static const uint8_t events[MIDI_MON_PORT_COUNT][2][4] = {
+        { { 0x90, 0x3C, 0x64 }, { 0x80, 0x3C, 0x00 } },
+        { { 0xB0, 0x07, 0x7F } },
+        { { 0xC0, 0x05 } },
+        { { 0xB0, 0x00, 0x00 }, { 0xB0, 0x01, 0x7F } },
+    };
+    static const uint8_t counts[MIDI_MON_PORT_COUNT] = { 2, 1, 1, 2 };
+
+    in->ui.mode = MODE_MONITOR;
+    in->now_us += 10 * 1000000;
+    for (int port = 0; port < MIDI_MON_PORT_COUNT; port++) {
+        memcpy(in->monitor.last[port], events[port], sizeof(events[port]));
+        in->monitor.last_count[port] = counts[port];
+        in->monitor.messages[port] = 1000;
+    }
+}
+
+// One second later: rates per port, bars from the per-channel deltas
+static void step_monitor_rates(oled_screen_input_t *in)
+{
+    static const uint32_t rates[MIDI_MON_PORT_COUNT] = { 120, 3, 1, 240 };
+
+    in->now_us += 1000000;
+    for (int port = 0; port < MIDI_MON_PORT_COUNT; port++) {
+        in->monitor.messages[port] += rates[port];
+    }
+    for (int ch = 0; ch < 16; ch++) {
+        in->monitor.channel_messages[ch] += (uint32_t)(ch % 5);
+    }
+}
+
+// Bars fall 1 px per frame, nothing else changes
+static void step_monitor_decay(oled_screen_input_t *in)
+{
+    in->now_us += 40 * 1000;
+}
+
+static void step_standby(oled_screen_input_t *in)
+{
+    in->display_on = false;
+}
+
+static void step_wake(oled_screen_input_t *in)
+{
+    in->display_on = true;
+    in->ui.mode = MODE_NORMAL;
+}
+
+static const frame_t script[] = {
+    { "normal",         OLED_PAGES_ALL,     step_none },
+    { "cursor",         OLED_PAGES_LIST,    step_cursor },
+    { "scroll",         OLED_PAGES_LIST,    step_scroll },
+    { "edit",           OLED_PAGES_ALL,     step_edit },
+    { "edit_next",      OLED_PAGES_ALL,     step_edit_next },
+    { "edit_change",    OLED_PAGES_ALL,     step_edit_change },
+    { "stats",          OLED_PAGES_ALL,     step_stats },
+    { "monitor",        OLED_PAGES_ALL,     step_monitor },
+    { "monitor_rates",  OLED_PAGES_ALL,     step_monitor_rates },
+    { "monitor_decay",  OLED_PAGES_ALL,     step_monitor_decay },
+    { "standby",        OLED_REQ_POWER,     step_standby },
+    { "wake",           OLED_REQ_POWER,     step_wake },
+};
+
+// compose_frame() of oled_display.c without the timing
+static int compose_frame(uint32_t requests, const oled_screen_input_t *in)
+{
+    oled_screens_compose(&screens, requests, in);
+    return ssd1306_flush(&dev);
+}
+
+#define FRAME_COUNT (sizeof(script) / sizeof(script[0]))
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = 1000;
+    const char *write_dir = NULL;
+    const char *check_dir = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:w:c:")) != -1) {
+        switch (opt) {
+        case 'r': rounds = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'w': write_dir = optarg; break;
+        case 'c': check_dir = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-r rounds] [-w dir | -c dir]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    board_hal_replay_init(NULL);
+    ssd1306_emu_attach();
+
+    // init_oled()
+    i2c_master_init(&dev, I2C_SDA_GPIO, I2C_SCL_GPIO, -1);
+    ssd1306_init(&dev, SSD1306_EMU_WIDTH, SSD1306_EMU_HEIGHT);
+    ssd1306_clear_screen(&dev, false);
+    ssd1306_contrast(&dev, 0xff);
+    static oled_screen_input_t input = {
+        .ui = { .mode = MODE_NORMAL },
+        .display_on = true,
+        .edit_initialized = &edit_initialized,
+    };
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        midi_command_set_default(&input.commands[i], i);
+    }
+
+    ssd1306_emu_stats_t stats;
+    ssd1306_emu_take_stats(&stats);
+    printf("init: %lu transactions, %lu bytes, %lld us on the bus\n\n", (unsigned long)stats.transactions,
+           (unsigned long)stats.bytes, (long long)stats.bus_us);
+    printf("%-14s %5s %5s %6s %6s %7s %9s\n", "frame", "pages", "trans", "bytes", "data", "bus us", "cpu ns");
+
+    int mismatches = 0;
+    uint32_t errors = stats.errors;
+
+    for (size_t f = 0; f < FRAME_COUNT; f++) {
+        const frame_t *frame = &script[f];
+        frame->step(&input);
+
+        // The frame once for the traffic and the picture...
+        SSD1306_t dev_before = dev;
+        oled_screens_t screens_before = screens;
+        bool edit_before = edit_initialized;
+        int pages = compose_frame(frame->requests, &input);
+        ssd1306_emu_take_stats(&stats);
+        errors += stats.errors;
+        SSD1306_t dev_after = dev;
+        oled_screens_t screens_after = screens;
+        bool edit_after = edit_initialized;
+
+        // ...then again from the same buffer state for the CPU time. The
+        // panel gets the same writes, so its picture does not change.
+        double start = now_ns();
+        for (int r = 0; r < rounds; r++) {
+            dev = dev_before;
+            screens = screens_before;
+            edit_initialized = edit_before;
+            compose_frame(frame->requests, &input);
+        }
+        double cpu_ns = (now_ns() - start) / rounds;
+        ssd1306_emu_stats_t repeat;
+        ssd1306_emu_take_stats(&repeat);
+        errors += repeat.errors;
+        dev = dev_after;
+        screens = screens_after;
+        edit_initialized = edit_after;
+
+        printf("%-14s %5d %5lu %6lu %6lu %7lld %9.0f\n", frame->name, pages, (unsigned long)stats.transactions,
+               (unsigned long)stats.bytes, (unsigned long)stats.data_bytes, (long long)stats.bus_us, cpu_ns);
+
+        ssd1306_emu_image_t image;
+        ssd1306_emu_render(image);
+        char path[512];
+        if (write_dir != NULL) {
+            snprintf(path, sizeof(path), "%s/%02zu_%s.pbm", write_dir, f, frame->name);
+            if (!ssd1306_emu_write_pbm(path, image)) {
+                fprintf(stderr, "%s: cannot write\n", path);
+                return 1;
+            }
+        }
+        if (check_dir != NULL) {
+            ssd1306_emu_image_t golden;
+            snprintf(path, sizeof(path), "%s/%02zu_%s.pbm", check_dir, f, frame->name);
+            if (!ssd1306_emu_read_pbm(path, golden)) {
+                fprintf(stderr, "%s: missing or not a 128x64 PBM\n", path);
+                mismatches++;
+            } else if (memcmp(image, golden, sizeof(image)) != 0) {
+                fprintf(stderr, "%s: snapshot differs\n", path);
+                mismatches++;
+            }
+        }
+    }
+
+    if (errors) {
+        printf("\n%lu malformed I2C writes or unknown commands\n", (unsigned long)errors);
+    }
+    if (check_dir != NULL) {
+        printf("\n%zu snapshots checked, %d differ\n", FRAME_COUNT, mismatches);
+    }
+    return (mismatches || errors) ? 1 : 0;
+}
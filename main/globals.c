@@ -2,10 +2,9 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
-const int button_gpios[BUTTON_COUNT] = {
-    6,7,14,15,16,17,18,21,47,48
-};
+const int button_gpios[BUTTON_COUNT] = MIDI_BUTTON_GPIOS;
 
 const int BTN_UP_GPIO = 10;
 const int BTN_DOWN_GPIO = 11;
@@ -18,16 +17,60 @@ const int I2C_RESET_GPIO = -1;
 const int OLED_WIDTH = 128;
 const int OLED_HEIGHT = 64;
 
-midi_command_t current_commands[BUTTON_COUNT];
-int current_button = 0;
-menu_mode_t current_mode = MODE_NORMAL;
+midi_command_slot_t current_commands[BUTTON_COUNT];
+
+// modo | botão << 8 | rolagem << 16
+static atomic_uint_least32_t ui_state_word = MODE_NORMAL;
+
+static uint32_t ui_state_pack(ui_state_t ui)
+{
+    return (uint32_t)(ui.mode & 0xFF) | ((uint32_t)(ui.button & 0xFF) << 8) |
+           ((uint32_t)(ui.scroll_offset & 0xFF) << 16);
+}
+
+static ui_state_t ui_state_unpack(uint32_t word)
+{
+    ui_state_t ui = {
+        .mode = (menu_mode_t)(word & 0xFF),
+        .button = (int)((word >> 8) & 0xFF),
+        .scroll_offset = (int)((word >> 16) & 0xFF),
+    };
+    return ui;
+}
+
+ui_state_t ui_state_get(void)
+{
+    return ui_state_unpack(atomic_load_explicit(&ui_state_word, memory_order_acquire));
+}
+
+bool ui_state_replace(ui_state_t *expected, ui_state_t desired)
+{
+    uint32_t old = ui_state_pack(*expected);
+    if (atomic_compare_exchange_strong_explicit(&ui_state_word, &old, ui_state_pack(desired),
+                                                memory_order_acq_rel, memory_order_acquire)) {
+        return true;
+    }
+    *expected = ui_state_unpack(old);
+    return false;
+}
+
+ui_state_t ui_state_select(ui_state_t ui, int button)
+{
+    ui.button = button;
+    if (button < ui.scroll_offset) {
+        ui.scroll_offset = button;
+    } else if (button >= ui.scroll_offset + VISIBLE_BUTTONS) {
+        ui.scroll_offset = button - VISIBLE_BUTTONS + 1;
+    }
+    return ui;
+}
+
 int edit_byte_index = 0;
 int edit_nibble_index = 0;
 SSD1306_t dev;
 bool display_initialized = false;
 midi_command_t edit_command;
 
-int scroll_offset = 0;
 bool edit_initialized = false;
 
 bool last_up_state = true;
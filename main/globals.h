@@ -2,8 +2,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "ssd1306.h"
+#include "midi_board.h"   // pinos dos footswitches e regras padrão (compartilhados com host/)
 
-#define BUTTON_COUNT 10
+#define BUTTON_COUNT MIDI_BUTTON_COUNT
 #define VISIBLE_BUTTONS 5
 
 extern const int button_gpios[BUTTON_COUNT];
@@ -19,25 +20,40 @@ extern const int I2C_RESET_GPIO;
 extern const int OLED_WIDTH;
 extern const int OLED_HEIGHT;
 
-typedef struct {
-    uint8_t data[4];
-    char description[20];
-} midi_command_t;
+#include "midi_command.h"
 
 typedef enum {
     MODE_NORMAL,
-    MODE_EDIT
+    MODE_EDIT,
+    MODE_STATS,
+    MODE_MONITOR
 } menu_mode_t;
 
-extern midi_command_t current_commands[BUTTON_COUNT];
-extern int current_button;
-extern menu_mode_t current_mode;
+// Comandos dos botões, compartilhados entre tarefas: a navegação/NVS
+// publica (midi_command_publish), o envio e o display leem (midi_command_read)
+extern midi_command_slot_t current_commands[BUTTON_COUNT];
+
+// Estado da navegação numa única palavra atômica: leitores (botões, energia,
+// display) pegam um snapshot coerente sem travar; quem muda faz
+// compare-and-swap a partir do snapshot que leu.
+typedef struct {
+    menu_mode_t mode;
+    int button;             // botão selecionado
+    int scroll_offset;      // primeira linha visível da lista
+} ui_state_t;
+
+ui_state_t ui_state_get(void);
+// Publica desired se o estado ainda for *expected. Se outra tarefa mudou
+// antes, retorna false e *expected recebe o estado atual.
+bool ui_state_replace(ui_state_t *expected, ui_state_t desired);
+// ui com outro botão selecionado, rolando a lista para mantê-lo visível
+ui_state_t ui_state_select(ui_state_t ui, int button);
+
 extern int edit_byte_index;
 extern int edit_nibble_index;
 extern SSD1306_t dev;
 extern bool display_initialized;
 extern midi_command_t edit_command;
-extern int scroll_offset;
 extern bool edit_initialized;
 extern bool last_up_state;
 extern bool last_down_state;
@@ -48,7 +64,6 @@ extern uint32_t last_display_activity_time;
 extern bool display_on;
 extern bool cpu_power_save_mode;
 
-void update_display_partial(void);
 void save_midi_commands(void);
 bool load_midi_commands(void);
 
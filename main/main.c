@@ -13,6 +13,11 @@
 #include "midi_class_driver_txrx.h"
 #include "midi_device_tx.h"
 #include "midi_tx_router.h"
+#include "midi_route.h"
+#include "midi_uart.h"
+#include "midi_trace.h"
+#include "midi_console.h"
+#include "board_hal.h"
 
 #include <string.h>
 #include "freertos/FreeRTOS.h"
@@ -91,7 +96,7 @@ void app_main(void)
     };
     gpio_config(&io);
 
-    current_usb_mode = (gpio_get_level(MODE_BUTTON) == 0) ? USB_MODE_DEVICE : USB_MODE_HOST;
+    current_usb_mode = (board_hal_gpio_get_level(MODE_BUTTON) == 0) ? USB_MODE_DEVICE : USB_MODE_HOST;
     
     ESP_LOGW(TAG, "USB mode selected at boot: %s",
          (current_usb_mode == USB_MODE_DEVICE) ? "DEVICE (TinyUSB)" : "HOST (USB Host Stack)");
@@ -100,11 +105,26 @@ void app_main(void)
     // Inicializações comuns aos dois modos
     // ------------------------------------
     init_power_management();
+    midi_tx_router_init();
+    midi_route_init();
     init_nvs();
     load_midi_commands();
     init_oled();
     init_navigation_buttons();
 
+    // MIDI DIN (UART): USB -> DIN OUT e DIN IN -> USB, nos dois modos
+    midi_uart_init();
+    midi_uart_start_usb_to_uart_task(5, 4096, 0);
+    midi_uart_start_rx_task(5, 4096, 0);
+
+#if CONFIG_MIDI_TRACE_CONSOLE_DRAIN
+    // Decodifica o trace binário do caminho MIDI no console (prioridade mínima)
+    xTaskCreatePinnedToCore(midi_trace_drain_task, "midi_trace", 3072, NULL, 1, NULL, 0);
+#endif
+
+    // Console serial (UART0): comandos de diagnóstico (latency, trace)
+    midi_console_start();
+
     display_on = true;
 
     // ===================================================
@@ -129,9 +149,13 @@ void app_main(void)
         ESP_LOGI(TAG, "tinyusb_driver_install OK");
 
         // Tasks da aplicação
-        xTaskCreatePinnedToCore(button_check_task, "buttons", 4096, NULL, 3, NULL, 1);
+        // Consumidora da saída DEVICE do router (grava no FIFO do TinyUSB)
+        xTaskCreatePinnedToCore(midi_device_tx_task, "device_tx", 4096, NULL, 5, NULL, 0);
+
+        xTaskCreatePinnedToCore(button_check_task, "buttons", 4096, NULL, 6, NULL, 1);
         xTaskCreatePinnedToCore(navigation_button_task, "navigation", 4096, NULL, 3, NULL, 1);
         xTaskCreatePinnedToCore(power_management_task, "pwr_mgmt", 4096, NULL, 1, NULL, 1);
+        xTaskCreatePinnedToCore(display_task, "display", 4096, NULL, 2, NULL, 1);
 
         // LOG EXTRA PARA DEBUG
         xTaskCreatePinnedToCore(
@@ -159,9 +183,10 @@ void app_main(void)
     xTaskCreatePinnedToCore(host_lib_daemon_task, "daemon", 4096, sem, 2, NULL, 0);
     xTaskCreatePinnedToCore(class_driver_task, "usb_class", 8192, sem, 3, NULL, 0);
 
-    xTaskCreatePinnedToCore(button_check_task, "buttons", 4096, NULL, 3, NULL, 1);
+    xTaskCreatePinnedToCore(button_check_task, "buttons", 4096, NULL, 6, NULL, 1);
     xTaskCreatePinnedToCore(navigation_button_task, "navigation", 4096, NULL, 3, NULL, 1);
     xTaskCreatePinnedToCore(power_management_task, "pwr_mgmt", 4096, NULL, 1, NULL, 1);
+    xTaskCreatePinnedToCore(display_task, "display", 4096, NULL, 2, NULL, 1);
 
     ESP_LOGI(TAG, "USB Host Mode ready.");
 
@@ -1,16 +1,77 @@
 #include "midi_buttons.h"
 #include "globals.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "midi_class_driver_txrx.h"
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
+#include <stdatomic.h>
 #include "power_management.h"
-#include "midi_tx_router.h"
+#include "midi_route.h"
+#include "oled_display.h"
+#include "midi_trace.h"
+#include "board_hal.h"
 
 static const char *TAG = "MIDI_BTN";
 
+// Anel de eventos ISR -> button_check_task (potência de 2)
+#define BUTTON_EVENT_RING_SIZE  64
+
+typedef struct {
+    int64_t timestamp_us;   // esp_timer_get_time() no momento da borda
+    uint8_t button;         // índice em button_gpios[]
+    uint8_t level;          // nível lido na ISR (0 = pressionado)
+} button_event_t;
+
+// Produtor único: a ISR do GPIO. Consumidor único: button_check_task.
+static button_event_t button_events[BUTTON_EVENT_RING_SIZE];
+static atomic_uint button_events_head = 0;
+static atomic_uint button_events_tail = 0;
+static atomic_uint button_events_dropped = 0;
+
+static TaskHandle_t button_task_handle = NULL;
+
+static void button_isr_handler(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t index = (uint32_t)(uintptr_t)arg;
+
+    unsigned head = atomic_load_explicit(&button_events_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&button_events_tail, memory_order_acquire);
+
+    if (head - tail < BUTTON_EVENT_RING_SIZE) {
+        button_event_t *ev = &button_events[head & (BUTTON_EVENT_RING_SIZE - 1)];
+        ev->timestamp_us = now;
+        ev->button = (uint8_t)index;
+        ev->level = (uint8_t)board_hal_gpio_get_level(button_gpios[index]);
+        atomic_store_explicit(&button_events_head, head + 1, memory_order_release);
+    } else {
+        atomic_fetch_add_explicit(&button_events_dropped, 1, memory_order_relaxed);
+    }
+
+    BaseType_t woken = pdFALSE;
+    if (button_task_handle != NULL) {
+        vTaskNotifyGiveFromISR(button_task_handle, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+static bool button_event_pop(button_event_t *ev)
+{
+    unsigned tail = atomic_load_explicit(&button_events_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&button_events_head, memory_order_acquire);
+
+    if (tail == head) {
+        return false;
+    }
+
+    *ev = button_events[tail & (BUTTON_EVENT_RING_SIZE - 1)];
+    atomic_store_explicit(&button_events_tail, tail + 1, memory_order_release);
+    return true;
+}
+
 void init_midi_buttons(void)
 {
     uint64_t button_mask = 0;
@@ -23,67 +84,140 @@ void init_midi_buttons(void)
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_ENABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
     };
     gpio_config(&io_conf);
 
-    ESP_LOGI(TAG, "MIDI buttons initialized");
+    // O serviço pode já ter sido instalado por outro módulo
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "gpio_install_isr_service failed: %s", esp_err_to_name(err));
+        return;
+    }
+
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        ESP_ERROR_CHECK(gpio_isr_handler_add(button_gpios[i], button_isr_handler, (void *)(uintptr_t)i));
+    }
+
+    ESP_LOGI(TAG, "MIDI buttons initialized (edge interrupts)");
+}
+
+static void handle_button_press(int i, int64_t edge_time_us)
+{
+    update_cpu_activity_time();
+    if (cpu_power_save_mode) {
+        set_cpu_full_performance_mode();
+    }
+
+    // MIDI primeiro; o display é redesenhado depois pela display_task.
+    // As regras de roteamento decidem as saídas (padrão: USB do modo atual
+    // e MIDI OUT/DIN, cada uma com sua fila no router). O comando vem de um
+    // único load atômico: nunca sai metade de uma edição em andamento.
+    uint8_t data[4];
+    midi_command_read(&current_commands[i], data);
+    midi_route_send(MIDI_IN_BUTTONS, data, sizeof(data), edge_time_us);
+
+    MIDI_TRACE(MIDI_TRACE_BUTTON_SEND, i, data, sizeof(data));
+    MIDI_HOT_LOGI(TAG, "Button %d SENT: %02X %02X %02X %02X (edge->send %lld us)", i + 1,
+             data[0], data[1], data[2], data[3],
+             esp_timer_get_time() - edge_time_us);
+
+    if (display_on) {
+        // Só move o cursor no modo normal; se a navegação mudar o estado no
+        // meio, tenta de novo sobre o snapshot novo
+        ui_state_t ui = ui_state_get();
+        while (ui.mode == MODE_NORMAL && ui.button != i) {
+            if (ui_state_replace(&ui, ui_state_select(ui, i))) {
+                // Só a lista muda (cursor/rolagem)
+                request_display_pages(OLED_PAGES_LIST);
+                break;
+            }
+        }
+    }
 }
 
 void button_check_task(void *arg)
 {
+    button_task_handle = xTaskGetCurrentTaskHandle();
     init_midi_buttons();
 
     ESP_LOGI(TAG, "Button controller ready");
 
-    bool last_button_states[BUTTON_COUNT];
-    uint32_t last_send_times[BUTTON_COUNT];
+    // Estado lógico (já debounced) e fim da janela de debounce de cada botão
+    bool pressed[BUTTON_COUNT];
+    int64_t lockout_until[BUTTON_COUNT];
+    bool lockout_pending[BUTTON_COUNT];
 
     for (int i = 0; i < BUTTON_COUNT; i++) {
-        last_button_states[i] = true;
-        last_send_times[i] = 0;
+        pressed[i] = !board_hal_gpio_get_level(button_gpios[i]);
+        lockout_until[i] = 0;
+        lockout_pending[i] = false;
     }
 
-    const uint32_t DEBOUNCE_DELAY = pdMS_TO_TICKS(100);
+    unsigned last_dropped = 0;
 
     while (1) {
-
+        // Dorme até a próxima borda ou até a janela de debounce mais próxima expirar
+        TickType_t wait = portMAX_DELAY;
+        int64_t now = esp_timer_get_time();
         for (int i = 0; i < BUTTON_COUNT; i++) {
-            bool current_state = gpio_get_level(button_gpios[i]);
-            uint32_t current_time = xTaskGetTickCount();
-
-            if (last_button_states[i] && !current_state) {
-                if ((current_time - last_send_times[i]) >= DEBOUNCE_DELAY) {
-                    update_cpu_activity_time();
-                    ESP_LOGI(TAG, "MIDI Button %d - only CPU power timer updated", i+1);
-                    if (cpu_power_save_mode) {
-                        set_cpu_full_performance_mode();
-                    }
-                    if(display_on && current_mode == MODE_NORMAL){
-                        if (current_button != i) {
-                            current_button = i;
-                            if (i < scroll_offset) {
-                                scroll_offset = i;
-                            } else if (i >= scroll_offset + VISIBLE_BUTTONS) {
-                                scroll_offset = i - VISIBLE_BUTTONS + 1;
-                            }
-                            update_display_partial();
-                        }
-                    }
-
-                    ESP_LOGI(TAG, "Button %d SENDING: %02X %02X %02X %02X", i + 1,
-                            current_commands[i].data[0], current_commands[i].data[1],
-                            current_commands[i].data[2], current_commands[i].data[3]);
-
-                    midi_tx_router_send(current_commands[i].data, sizeof(current_commands[i].data));
-
-                    last_send_times[i] = current_time;
+            if (lockout_pending[i]) {
+                int64_t remaining_us = lockout_until[i] - now;
+                TickType_t ticks = (remaining_us > 0) ? pdMS_TO_TICKS((remaining_us + 999) / 1000) + 1 : 0;
+                if (ticks < wait) {
+                    wait = ticks;
                 }
             }
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        button_event_t ev;
+        while (button_event_pop(&ev)) {
+            int i = ev.button;
+
+            // Bordas dentro da janela são trepidação; o estado final é
+            // conferido quando a janela expira
+            if (lockout_pending[i] && ev.timestamp_us < lockout_until[i]) {
+                continue;
+            }
 
-            last_button_states[i] = current_state;
+            bool is_pressed = (ev.level == 0);
+            if (is_pressed == pressed[i]) {
+                continue;
+            }
+
+            pressed[i] = is_pressed;
+            lockout_until[i] = ev.timestamp_us + MIDI_BUTTON_DEBOUNCE_US;
+            lockout_pending[i] = true;
+
+            if (is_pressed) {
+                handle_button_press(i, ev.timestamp_us);
+            }
         }
 
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Janelas expiradas: sincroniza com o nível real do pino
+        now = esp_timer_get_time();
+        for (int i = 0; i < BUTTON_COUNT; i++) {
+            if (!lockout_pending[i] || now < lockout_until[i]) {
+                continue;
+            }
+            lockout_pending[i] = false;
+
+            bool is_pressed = !board_hal_gpio_get_level(button_gpios[i]);
+            if (is_pressed != pressed[i]) {
+                pressed[i] = is_pressed;
+                lockout_until[i] = now + MIDI_BUTTON_DEBOUNCE_US;
+                lockout_pending[i] = true;
+                if (is_pressed) {
+                    handle_button_press(i, now);
+                }
+            }
+        }
+
+        unsigned dropped = atomic_load_explicit(&button_events_dropped, memory_order_relaxed);
+        if (dropped != last_dropped) {
+            ESP_LOGW(TAG, "Button event ring overflow (%u events dropped)", dropped);
+            last_dropped = dropped;
+        }
     }
-}
\ No newline at end of file
+}
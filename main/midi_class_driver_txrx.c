@@ -8,23 +8,37 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "usb/usb_host.h"
 #include "esp_mac.h"
 
 #include "midi_class_driver_txrx.h"
-
-// Hook into UART queueing provided by midi_uart
-// Returns true if the packet was queued successfully (non-blocking), false otherwise
-extern bool midi_uart_try_enqueue_usb(const uint8_t *data, size_t length);
-extern void midi_uart_send_to_uart(const uint8_t *data, size_t length);
+#include "midi_uart.h"
+#include "midi_trace.h"
+#include "midi_latency.h"
+#include "midi_tx_router.h"
+#include "midi_route.h"
+#include "midi_monitor.h"
+#include "board_hal_usb_host.h"
+#include "midi_usb_desc.h"
 
 #define USB_CLIENT_NUM_EVENT_MSG    5
 #define MIDI_MESSAGE_LENGTH         4
-#define MIDI_TX_QUEUE_SIZE          20
+#define MIDI_TX_POOL_SIZE           8   // transferências OUT pré-alocadas (máx. 32)
+#define MIDI_TX_MAX_EVENTS          16  // eventos com latência medida por transferência (64 B full-speed)
+#define TX_POOL_EXHAUSTED_LOG_US    1000000  // intervalo mínimo entre avisos de pool esgotado
+
+// Benchmark de TX ao conectar: envia rajadas de Active Sensing (0xFE) e mede
+// mensagens/ms e o tempo de conclusão de cada rajada. Desligado por padrão.
+#define MIDI_TX_BENCH_ON_CONNECT    0
+#define MIDI_TX_BENCH_BURST_LEN     16
+#define MIDI_TX_BENCH_BURSTS        50
 
 // MIDI USB Class and Subclass definitions
 #define USB_CLASS_AUDIO             0x01
@@ -48,14 +62,26 @@ typedef struct {
     uint8_t alternate_setting;
     uint8_t endpoint_in_address;     // Endpoint para receber dados
     uint8_t endpoint_out_address;    // Endpoint para enviar dados
-    uint8_t max_packet_size_in;
-    uint8_t max_packet_size_out;
+    uint16_t max_packet_size_in;     // wMaxPacketSize vai até 1024
+    uint16_t max_packet_size_out;
 } interface_config_t;
 
+// Pool fixo de transferências OUT: alocado em action_prepare_send_data,
+// liberado em action_close_dev. O caminho de TX nunca usa o heap.
 typedef struct {
-    uint8_t data[MIDI_MESSAGE_LENGTH];
-    size_t length;
-} internal_midi_message_t;
+    usb_transfer_t *transfers[MIDI_TX_POOL_SIZE];
+    uint32_t in_flight_mask;         // bit i = transfers[i] submetida ao USB
+    uint32_t in_flight_peak;         // maior número simultâneo em voo
+    uint32_t exhausted_count;        // vezes que o pool estava todo em voo
+    bool closing;                    // dispositivo fechando: callbacks liberam a transferência
+} midi_tx_pool_t;
+
+// Contadores de TX (escritos só na tarefa do driver)
+typedef struct {
+    volatile uint32_t transfers_completed;
+    volatile uint32_t messages_completed;
+    volatile int64_t last_complete_us;   // esp_timer_get_time() da última conclusão
+} midi_tx_stats_t;
 
 typedef struct {
     usb_host_client_handle_t client_hdl;
@@ -63,15 +89,89 @@ typedef struct {
     usb_device_handle_t dev_hdl;
     uint32_t actions;
     interface_config_t interface_conf;
+    bool interface_claimed;          // interface_conf.interface_nmbr foi claimed
     usb_transfer_t *rx_transfer;     // Transferência para recepção
-    QueueHandle_t tx_queue;          // Fila para mensagens a serem enviadas
-    bool ready_for_tx;               // Flag indicando se está pronto para enviar
 } class_driver_t;
 
 static const char *DRIVER_TAG = "MIDI_DRIVER_TXRX";
 
-// Variável global para rastrear a instância do driver
-static class_driver_t *global_driver_instance = NULL;
+// A tarefa do driver é a única dona do TX. As outras tarefas só enxergam a
+// saída HOST do router, a flag de prontidão e o handle do cliente (para
+// acordar o driver).
+static usb_host_client_handle_t tx_client_hdl = NULL;
+static atomic_bool tx_ready = false;
+
+// Pool e contadores de TX: escritos só pela tarefa do driver
+static midi_tx_pool_t tx_pool;
+static midi_tx_stats_t tx_stats;
+static uint8_t tx_endpoint_out = 0;
+
+// Origem de cada evento em voo, por slot do pool (latência até a conclusão)
+static int64_t tx_origin_us[MIDI_TX_POOL_SIZE][MIDI_TX_MAX_EVENTS];
+static uint8_t tx_origin_count[MIDI_TX_POOL_SIZE];
+
+// Protege o pool de TX (midi_driver_print_status lê de outra tarefa)
+static portMUX_TYPE tx_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int tx_pool_popcount(uint32_t mask) {
+    return __builtin_popcount(mask);
+}
+
+// Índice da transferência no pool, -1 se não pertence a ele
+static int tx_pool_slot(const midi_tx_pool_t *pool, const usb_transfer_t *transfer) {
+    for (int i = 0; i < MIDI_TX_POOL_SIZE; i++) {
+        if (pool->transfers[i] == transfer) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Reserva uma transferência livre do pool; NULL se todas estão em voo
+static usb_transfer_t *tx_pool_acquire(midi_tx_pool_t *pool) {
+    usb_transfer_t *transfer = NULL;
+
+    taskENTER_CRITICAL(&tx_pool_lock);
+    for (int i = 0; i < MIDI_TX_POOL_SIZE; i++) {
+        if (pool->transfers[i] != NULL && !(pool->in_flight_mask & (1u << i))) {
+            pool->in_flight_mask |= (1u << i);
+            uint32_t in_flight = tx_pool_popcount(pool->in_flight_mask);
+            if (in_flight > pool->in_flight_peak) {
+                pool->in_flight_peak = in_flight;
+            }
+            transfer = pool->transfers[i];
+            break;
+        }
+    }
+    if (transfer == NULL) {
+        pool->exhausted_count++;
+    }
+    taskEXIT_CRITICAL(&tx_pool_lock);
+
+    return transfer;
+}
+
+// Devolve a transferência ao pool. Retorna false se ela não pertence mais ao
+// pool (dispositivo fechado com a transferência em voo) e deve ser liberada.
+static bool tx_pool_release(midi_tx_pool_t *pool, usb_transfer_t *transfer) {
+    bool owned = false;
+
+    taskENTER_CRITICAL(&tx_pool_lock);
+    for (int i = 0; i < MIDI_TX_POOL_SIZE; i++) {
+        if (pool->transfers[i] == transfer) {
+            pool->in_flight_mask &= ~(1u << i);
+            if (pool->closing) {
+                pool->transfers[i] = NULL;
+            } else {
+                owned = true;
+            }
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&tx_pool_lock);
+
+    return owned;
+}
 
 /*
  * Public hook:
@@ -91,12 +191,16 @@ static void midi_usb_host_rx_callback(usb_transfer_t *transfer) {
     class_driver_t *driver_obj = (class_driver_t *)transfer->context;
     int size = (int)transfer->actual_num_bytes;
     
-    // Uma mensagem contém 4 bytes de dados
-    int num_messages = size / MIDI_MESSAGE_LENGTH;
-    int offset = 0;
-
     // Processar mensagens recebidas
     if(size > 0) {
+        MIDI_TRACE(MIDI_TRACE_HOST_RX, size, transfer->data_buffer, size);
+        board_hal_record(BOARD_HAL_EV_USB_RX, 0, transfer->data_buffer, size);
+
+#if CONFIG_MIDI_HOT_PATH_LOG
+        // Uma mensagem contém 4 bytes de dados
+        int num_messages = size / MIDI_MESSAGE_LENGTH;
+        int offset = 0;
+
         ESP_LOGI(DRIVER_TAG, "Received %d bytes (%d messages)", size, num_messages);
         
         // Print cada mensagem separadamente (debug)
@@ -108,18 +212,40 @@ static void midi_usb_host_rx_callback(usb_transfer_t *transfer) {
                     transfer->data_buffer[offset + 3]);
             offset += MIDI_MESSAGE_LENGTH;
         }
-
-        // Try to enqueue USB data to the UART queue (non-blocking) for low-latency forwarding.
-        // If queue is full or not available, fallback to direct send to UART to avoid loss.
-        if (midi_uart_try_enqueue_usb(transfer->data_buffer, size) == false) {
-            // fallback direct send to UART
-            midi_uart_send_to_uart(transfer->data_buffer, size);
+#endif
+
+        // Cada pacote passa pelas tabelas de roteamento. Os destinados ao DIN
+        // vão em lote para o ring USB->UART (decodificados para MIDI 1.0 pela
+        // tarefa da UART; ring cheio descarta em vez de bloquear), os demais
+        // seguem pelo router.
+        uint8_t din_batch[64];
+        size_t din_len = 0;
+        uint8_t routed[MIDI_OUT_COUNT][4];
+
+        for (int offset = 0; offset + MIDI_MESSAGE_LENGTH <= size; offset += MIDI_MESSAGE_LENGTH) {
+            midi_monitor_record(MIDI_MON_USB_RX, &transfer->data_buffer[offset]);
+            uint32_t mask = midi_route_apply(MIDI_IN_USB, &transfer->data_buffer[offset], routed);
+            midi_route_dispatch(mask, MIDI_OUT_MASK(MIDI_OUT_DIN), routed, MIDI_ORIGIN_NONE);
+            if (!(mask & MIDI_OUT_MASK(MIDI_OUT_DIN))) {
+                continue;
+            }
+            memcpy(&din_batch[din_len], routed[MIDI_OUT_DIN], MIDI_MESSAGE_LENGTH);
+            din_len += MIDI_MESSAGE_LENGTH;
+            if (din_len == sizeof(din_batch)) {
+                if (!midi_uart_try_enqueue_usb(din_batch, din_len)) {
+                    ESP_LOGW(DRIVER_TAG, "USB->UART ring full, dropped %d bytes", (int)din_len);
+                }
+                din_len = 0;
+            }
+        }
+        if (din_len > 0 && !midi_uart_try_enqueue_usb(din_batch, din_len)) {
+            ESP_LOGW(DRIVER_TAG, "USB->UART ring full, dropped %d bytes", (int)din_len);
         }
     }
 
     // Re-submeter a transferência para continuar recebendo dados
     if (driver_obj != NULL && driver_obj->dev_hdl != NULL) {
-        esp_err_t err = usb_host_transfer_submit(transfer);
+        esp_err_t err = board_hal_usb_host_submit(transfer);
         if (err != ESP_OK) {
             if (err == ESP_ERR_INVALID_STATE) {
                 ESP_LOGW(DRIVER_TAG, "USB device disconnected or in invalid state, cannot re-submit RX transfer");
@@ -135,22 +261,32 @@ static void midi_usb_host_rx_callback(usb_transfer_t *transfer) {
 
 // Callback para transmissão de dados MIDI
 static void midi_usb_host_tx_callback(usb_transfer_t *transfer) {
-    ESP_LOGI(DRIVER_TAG, "TX CALLBACK: Status = %d, Actual Bytes = %d", 
-             transfer->status, transfer->actual_num_bytes);
-    
     if (transfer->status == USB_TRANSFER_STATUS_COMPLETED) {
-        ESP_LOGI(DRIVER_TAG, "MIDI data sent successfully!");
+        int slot = tx_pool_slot(&tx_pool, transfer);
+        if (slot >= 0) {
+            for (int i = 0; i < tx_origin_count[slot]; i++) {
+                midi_latency_record(MIDI_LAT_COMPLETE, tx_origin_us[slot][i]);
+            }
+        }
+        MIDI_TRACE(MIDI_TRACE_HOST_TX_DONE, transfer->actual_num_bytes, NULL, 0);
+        MIDI_HOT_LOGI(DRIVER_TAG, "TX CALLBACK: %d bytes sent", transfer->actual_num_bytes);
+        tx_stats.messages_completed += transfer->num_bytes / MIDI_MESSAGE_LENGTH;
+        tx_stats.transfers_completed++;
+        tx_stats.last_complete_us = esp_timer_get_time();
     } else {
+        MIDI_TRACE(MIDI_TRACE_HOST_TX_FAIL, transfer->status, NULL, 0);
         ESP_LOGE(DRIVER_TAG, "MIDI transfer failed with status: %d", transfer->status);
     }
     
-    // Liberar a transferência após o envio
-    usb_host_transfer_free(transfer);
+    // Devolver a transferência ao pool (só libera se o dispositivo já fechou)
+    if (!tx_pool_release(&tx_pool, transfer)) {
+        usb_host_transfer_free(transfer);
+    }
 }
 
 // Função para processar a fila de transmissão
 static void process_tx_queue(class_driver_t *driver_obj) {
-    if (driver_obj == NULL || !driver_obj->ready_for_tx) {
+    if (driver_obj == NULL || !atomic_load(&tx_ready)) {
         return;
     }
 
@@ -160,104 +296,111 @@ static void process_tx_queue(class_driver_t *driver_obj) {
         return;
     }
 
-    internal_midi_message_t message;
-    
-    // Verificar se há mensagens na fila para enviar
-    while (xQueueReceive(driver_obj->tx_queue, &message, 0) == pdTRUE) {
-        ESP_LOGI(DRIVER_TAG, "Processing TX queue: %d bytes", message.length);
-        
-        // Alocar transferência para envio
-        usb_transfer_t *transfer;
-        esp_err_t err = usb_host_transfer_alloc(message.length, 0, &transfer);
-        
-        if (err != ESP_OK) {
-            ESP_LOGE(DRIVER_TAG, "Failed to allocate transfer for TX: %d", err);
-            continue;
+    // Verificar se há mensagens na saída HOST do router
+    while (midi_tx_router_pending(MIDI_OUT_HOST)) {
+        // Reservar transferência do pool antes de retirar da fila: se o pool
+        // estiver esgotado a mensagem espera pelo próximo TX callback
+        usb_transfer_t *transfer = tx_pool_acquire(&tx_pool);
+        if (transfer == NULL) {
+            break;   // contado em exhausted_count, avisado em class_driver_task
+        }
+
+        // Empacotar o máximo de eventos de 4 bytes que cabem em um pacote OUT
+        size_t capacity = driver_obj->interface_conf.max_packet_size_out;
+        if (capacity > transfer->data_buffer_size) {
+            capacity = transfer->data_buffer_size;
+        }
+        capacity -= capacity % MIDI_MESSAGE_LENGTH;
+        if (capacity < MIDI_MESSAGE_LENGTH) {
+            capacity = MIDI_MESSAGE_LENGTH;
         }
 
+        int slot = tx_pool_slot(&tx_pool, transfer);
+        int64_t *origins = tx_origin_us[slot];
+        int events = 0;
+
+        size_t offset = 0;
+        midi_router_msg_t *message;
+        while (offset + MIDI_MESSAGE_LENGTH <= capacity &&
+               (message = midi_tx_router_pop(MIDI_OUT_HOST)) != NULL) {
+            midi_latency_record(MIDI_LAT_DEQUEUE, message->origin_us);
+            if (events < MIDI_TX_MAX_EVENTS) {
+                origins[events++] = message->origin_us;
+            }
+            // Cada evento USB-MIDI ocupa exatamente 4 bytes
+            memcpy(&transfer->data_buffer[offset], message->packet, MIDI_MESSAGE_LENGTH);
+            offset += MIDI_MESSAGE_LENGTH;
+            midi_tx_router_release(message);
+        }
+        tx_origin_count[slot] = (uint8_t)events;
+
+        if (offset == 0) {
+            tx_pool_release(&tx_pool, transfer);
+            break;
+        }
+
+
         // Configurar a transferência
-        memcpy(transfer->data_buffer, message.data, message.length);
-        transfer->num_bytes = message.length;
+        transfer->num_bytes = offset;
         transfer->callback = midi_usb_host_tx_callback;
         transfer->bEndpointAddress = driver_obj->interface_conf.endpoint_out_address;
         transfer->device_handle = driver_obj->dev_hdl;
-
-        ESP_LOGI(DRIVER_TAG, "Submitting USB transfer to endpoint 0x%02X", transfer->bEndpointAddress);
+        transfer->context = (void *)driver_obj;
 
         // Enviar dados com verificação de erro
-        err = usb_host_transfer_submit(transfer);
+        esp_err_t err = board_hal_usb_host_submit(transfer);
         if (err != ESP_OK) {
             if (err == ESP_ERR_INVALID_STATE) {
                 ESP_LOGW(DRIVER_TAG, "Cannot submit TX transfer: device disconnected");
             } else {
                 ESP_LOGE(DRIVER_TAG, "Failed to submit TX transfer: %d", err);
             }
-            usb_host_transfer_free(transfer);
+            if (!tx_pool_release(&tx_pool, transfer)) {
+                usb_host_transfer_free(transfer);
+            }
         } else {
-            ESP_LOGI(DRIVER_TAG, "USB transfer submitted successfully");
+            for (int i = 0; i < events; i++) {
+                midi_latency_record(MIDI_LAT_SUBMIT, origins[i]);
+            }
+            MIDI_TRACE(MIDI_TRACE_HOST_SUBMIT, offset / MIDI_MESSAGE_LENGTH, transfer->data_buffer, offset);
+            midi_monitor_record_packets(MIDI_MON_USB_TX, transfer->data_buffer, offset);
+            MIDI_HOT_LOGI(DRIVER_TAG, "Submitted %d events to endpoint 0x%02X",
+                          (int)(offset / MIDI_MESSAGE_LENGTH), transfer->bEndpointAddress);
         }
     }
 }
 
-// Analisar configurações da interface MIDI
-static void get_midi_interface_settings(const usb_config_desc_t *usb_conf, interface_config_t *interface_conf) {
+// Analisar configurações da interface MIDI.
+// A varredura do descritor fica em midi_usb_desc (midi_core), que também é
+// testada com fuzzing no host. Retorna false se o dispositivo não tem uma
+// interface MIDI Streaming com endpoint IN (interface_conf fica intocada).
+static bool get_midi_interface_settings(const usb_config_desc_t *usb_conf, interface_config_t *interface_conf) {
     assert(usb_conf != NULL);
     assert(interface_conf != NULL);
 
     ESP_LOGI(DRIVER_TAG, "Getting MIDI interface configuration");
 
-    int offset = 0;
-    uint16_t wTotalLength = usb_conf->wTotalLength;
-    const usb_standard_desc_t *next_desc = (const usb_standard_desc_t *)usb_conf;
-
-    // Reset da configuração
-    memset(interface_conf, 0, sizeof(interface_config_t));
-
-    do {
-        if(next_desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_INTERFACE) {
-            usb_intf_desc_t *interface_desc = (usb_intf_desc_t *)next_desc;
-
-            // Verificar se é uma interface MIDI
-            if(interface_desc->bInterfaceClass == USB_CLASS_AUDIO && 
-               interface_desc->bInterfaceSubClass == USB_SUBCLASS_MIDISTREAM) {
-                ESP_LOGI(DRIVER_TAG, "Found MIDI Stream Interface");
-
-                if(interface_desc->bNumEndpoints >= 2) {
-                    interface_conf->interface_nmbr = interface_desc->bInterfaceNumber;
-                    interface_conf->alternate_setting = interface_desc->bAlternateSetting;
-
-                    ESP_LOGI(DRIVER_TAG, "MIDI Interface: Number=%d, Alternate=%d", 
-                            interface_conf->interface_nmbr, interface_conf->alternate_setting);
-                }
-            }
-        }
-
-        if(next_desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_ENDPOINT) {
-            usb_ep_desc_t *ep_desc = (usb_ep_desc_t *)next_desc;
-            uint8_t ep_addr = ep_desc->bEndpointAddress;
-            uint8_t ep_dir = USB_EP_DESC_GET_EP_DIR(ep_desc);
-
-            if(ep_dir) { // IN endpoint (recepção do host)
-                interface_conf->endpoint_in_address = ep_addr;
-                interface_conf->max_packet_size_in = ep_desc->wMaxPacketSize & 0x7FF;
-                ESP_LOGI(DRIVER_TAG, "IN Endpoint: Address=0x%02X, MaxPacketSize=%d", 
-                        interface_conf->endpoint_in_address, interface_conf->max_packet_size_in);
-            } else { // OUT endpoint (transmissão do host)
-                interface_conf->endpoint_out_address = ep_addr;
-                interface_conf->max_packet_size_out = ep_desc->wMaxPacketSize & 0x7FF;
-                ESP_LOGI(DRIVER_TAG, "OUT Endpoint: Address=0x%02X, MaxPacketSize=%d", 
-                        interface_conf->endpoint_out_address, interface_conf->max_packet_size_out);
-            }
-        }
-
-        next_desc = usb_parse_next_descriptor(next_desc, wTotalLength, &offset);
+    midi_usb_interface_t found;
+    if (!midi_usb_find_interface((const uint8_t *)usb_conf, usb_conf->wTotalLength, &found)) {
+        ESP_LOGE(DRIVER_TAG, "No MIDI Streaming interface with an IN endpoint - not a MIDI device");
+        return false;
+    }
 
-    } while (next_desc != NULL);
+    interface_conf->interface_nmbr = found.interface_number;
+    interface_conf->alternate_setting = found.alternate_setting;
+    interface_conf->endpoint_in_address = found.endpoint_in;
+    interface_conf->endpoint_out_address = found.endpoint_out;
+    interface_conf->max_packet_size_in = found.max_packet_in;
+    interface_conf->max_packet_size_out = found.max_packet_out;
 
     ESP_LOGI(DRIVER_TAG, "MIDI Interface Analysis Complete:");
-    ESP_LOGI(DRIVER_TAG, "  - IN Endpoint: 0x%02X", interface_conf->endpoint_in_address);
-    ESP_LOGI(DRIVER_TAG, "  - OUT Endpoint: 0x%02X", interface_conf->endpoint_out_address);
-    ESP_LOGI(DRIVER_TAG, "  - Interface: %d", interface_conf->interface_nmbr);
+    ESP_LOGI(DRIVER_TAG, "  - IN Endpoint: 0x%02X (%d bytes)", interface_conf->endpoint_in_address,
+             interface_conf->max_packet_size_in);
+    ESP_LOGI(DRIVER_TAG, "  - OUT Endpoint: 0x%02X (%d bytes)", interface_conf->endpoint_out_address,
+             interface_conf->max_packet_size_out);
+    ESP_LOGI(DRIVER_TAG, "  - Interface: %d, Alternate: %d", interface_conf->interface_nmbr,
+             interface_conf->alternate_setting);
+    return true;
 }
 
 // Callback de eventos do cliente USB
@@ -323,7 +466,12 @@ static void action_get_config_desc(class_driver_t *driver_obj) {
     usb_print_config_descriptor(config_desc, NULL);
 
     interface_config_t interface_config = {0};
-    get_midi_interface_settings(config_desc, &interface_config);
+    if (!get_midi_interface_settings(config_desc, &interface_config)) {
+        // Nada para claim nem para ler: fecha o dispositivo em vez de seguir
+        // com uma configuração zerada (interface 0, endpoint 0x00)
+        driver_obj->actions = ACTION_CLOSE_DEV;
+        return;
+    }
     driver_obj->interface_conf = interface_config;
 
     driver_obj->actions &= ~ACTION_GET_CONFIG_DESC;
@@ -361,6 +509,7 @@ static void action_claim_interface(class_driver_t *driver_obj) {
             driver_obj->dev_hdl,
             driver_obj->interface_conf.interface_nmbr,
             driver_obj->interface_conf.alternate_setting));
+    driver_obj->interface_claimed = true;
 
     driver_obj->actions &= ~ACTION_CLAIM_INTERFACE;
     driver_obj->actions |= ACTION_START_READING_DATA;
@@ -381,13 +530,21 @@ static void action_start_reading_data(class_driver_t *driver_obj) {
     driver_obj->rx_transfer->context = (void *)driver_obj;
 
     // Iniciar recepção contínua
-    ESP_ERROR_CHECK(usb_host_transfer_submit(driver_obj->rx_transfer));
+    ESP_ERROR_CHECK(board_hal_usb_host_submit(driver_obj->rx_transfer));
     ESP_LOGI(DRIVER_TAG, "MIDI reception started");
 
     driver_obj->actions &= ~ACTION_START_READING_DATA;
     driver_obj->actions |= ACTION_PREPARE_SEND_DATA;
 }
 
+#if MIDI_TX_BENCH_ON_CONNECT
+static void midi_tx_bench_task(void *arg) {
+    vTaskDelay(pdMS_TO_TICKS(500));
+    midi_driver_tx_benchmark(MIDI_TX_BENCH_BURST_LEN, MIDI_TX_BENCH_BURSTS);
+    vTaskDelete(NULL);
+}
+#endif
+
 // Ação: Preparar envio de dados
 static void action_prepare_send_data(class_driver_t *driver_obj) {
     ESP_LOGI(DRIVER_TAG, "Preparing MIDI transmission");
@@ -395,23 +552,50 @@ static void action_prepare_send_data(class_driver_t *driver_obj) {
     // Verificar se temos um endpoint OUT para transmissão
     if (driver_obj->interface_conf.endpoint_out_address == 0) {
         ESP_LOGW(DRIVER_TAG, "No OUT endpoint found - device is read-only");
-        driver_obj->ready_for_tx = false;
+        atomic_store(&tx_ready, false);
         driver_obj->actions &= ~ACTION_PREPARE_SEND_DATA;
         return;
     }
 
-    // Criar fila para mensagens de transmissão
-    driver_obj->tx_queue = xQueueCreate(MIDI_TX_QUEUE_SIZE, sizeof(internal_midi_message_t));
-    if (driver_obj->tx_queue == NULL) {
-        ESP_LOGE(DRIVER_TAG, "Failed to create TX queue");
-        driver_obj->ready_for_tx = false;
+    // Pré-alocar o pool de transferências OUT, cada uma com um pacote máximo
+    size_t transfer_size = driver_obj->interface_conf.max_packet_size_out;
+    if (transfer_size < MIDI_MESSAGE_LENGTH) {
+        transfer_size = MIDI_MESSAGE_LENGTH;
+    }
+
+    taskENTER_CRITICAL(&tx_pool_lock);
+    memset(&tx_pool, 0, sizeof(tx_pool));
+    taskEXIT_CRITICAL(&tx_pool_lock);
+    bool pool_ok = true;
+    for (int i = 0; i < MIDI_TX_POOL_SIZE; i++) {
+        esp_err_t err = usb_host_transfer_alloc(transfer_size, 0, &tx_pool.transfers[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(DRIVER_TAG, "Failed to allocate TX pool transfer %d: %s", i, esp_err_to_name(err));
+            tx_pool.transfers[i] = NULL;
+            pool_ok = false;
+            break;
+        }
+    }
+    ESP_LOGI(DRIVER_TAG, "TX pool: %d transfers of %d bytes", MIDI_TX_POOL_SIZE, (int)transfer_size);
+
+    tx_endpoint_out = driver_obj->interface_conf.endpoint_out_address;
+
+    // Descartar mensagens enfileiradas antes da conexão
+    midi_tx_router_flush(MIDI_OUT_HOST);
+
+    if (!pool_ok) {
+        ESP_LOGE(DRIVER_TAG, "Failed to create TX pool");
+        atomic_store(&tx_ready, false);
     } else {
-        driver_obj->ready_for_tx = true;
+        atomic_store(&tx_ready, true);
         ESP_LOGI(DRIVER_TAG, "MIDI transmission ready - Device can send and receive");
     }
 
-    // Atualizar instância global
-    global_driver_instance = driver_obj;
+#if MIDI_TX_BENCH_ON_CONNECT
+    if (atomic_load(&tx_ready)) {
+        xTaskCreatePinnedToCore(midi_tx_bench_task, "midi_tx_bench", 4096, NULL, 2, NULL, 1);
+    }
+#endif
 
     driver_obj->actions &= ~ACTION_PREPARE_SEND_DATA;
 }
@@ -420,18 +604,28 @@ static void action_prepare_send_data(class_driver_t *driver_obj) {
 static void action_close_dev(class_driver_t *driver_obj) {
     ESP_LOGI(DRIVER_TAG, "Closing MIDI device");
 
-    driver_obj->ready_for_tx = false;
+    atomic_store(&tx_ready, false);
 
-    // Liberar recursos de transmissão
-    if (driver_obj->tx_queue != NULL) {
-        // Limpar a fila antes de deletar
-        internal_midi_message_t dummy;
-        while (xQueueReceive(driver_obj->tx_queue, &dummy, 0) == pdTRUE) {
-            // Simplesmente esvaziar a fila
+    // Esvaziar a saída HOST (mensagens que não serão mais enviadas)
+    midi_tx_router_flush(MIDI_OUT_HOST);
+
+    // Liberar o pool de TX; transferências ainda em voo são liberadas no callback
+    taskENTER_CRITICAL(&tx_pool_lock);
+    tx_pool.closing = true;
+    uint32_t in_flight = tx_pool.in_flight_mask;
+    taskEXIT_CRITICAL(&tx_pool_lock);
+
+    for (int i = 0; i < MIDI_TX_POOL_SIZE; i++) {
+        if (tx_pool.transfers[i] != NULL && !(in_flight & (1u << i))) {
+            usb_host_transfer_free(tx_pool.transfers[i]);
+            tx_pool.transfers[i] = NULL;
         }
-        vQueueDelete(driver_obj->tx_queue);
-        driver_obj->tx_queue = NULL;
     }
+    if (in_flight != 0) {
+        ESP_LOGW(DRIVER_TAG, "%d TX transfers still in flight at close", tx_pool_popcount(in_flight));
+    }
+    ESP_LOGI(DRIVER_TAG, "TX pool stats: peak in flight=%lu, exhausted=%lu",
+             tx_pool.in_flight_peak, tx_pool.exhausted_count);
 
     // Liberar transferência de recepção
     if (driver_obj->rx_transfer != NULL) {
@@ -439,12 +633,15 @@ static void action_close_dev(class_driver_t *driver_obj) {
         driver_obj->rx_transfer = NULL;
     }
 
-    // Liberar interface
+    // Liberar interface (dispositivo sem MIDI fecha sem claim)
     if (driver_obj->dev_hdl != NULL) {
-        ESP_ERROR_CHECK(usb_host_interface_release(
-                driver_obj->client_hdl,
-                driver_obj->dev_hdl,
-                driver_obj->interface_conf.interface_nmbr));
+        if (driver_obj->interface_claimed) {
+            ESP_ERROR_CHECK(usb_host_interface_release(
+                    driver_obj->client_hdl,
+                    driver_obj->dev_hdl,
+                    driver_obj->interface_conf.interface_nmbr));
+            driver_obj->interface_claimed = false;
+        }
 
         // Fechar dispositivo
         ESP_ERROR_CHECK(usb_host_device_close(driver_obj->client_hdl, driver_obj->dev_hdl));
@@ -452,23 +649,26 @@ static void action_close_dev(class_driver_t *driver_obj) {
 
     driver_obj->dev_hdl = NULL;
     driver_obj->dev_addr = 0;
-
-    // Limpar instância global
-    global_driver_instance = NULL;
+    memset(&driver_obj->interface_conf, 0, sizeof(driver_obj->interface_conf));
+    tx_endpoint_out = 0;
 
     driver_obj->actions &= ~ACTION_CLOSE_DEV;
     driver_obj->actions |= ACTION_EXIT;
 }
 
+// Chamado pelo router após enfileirar na saída HOST
+static void host_output_wake(void)
+{
+    usb_host_client_unblock(tx_client_hdl);
+}
+
 // Função principal da tarefa do driver
 void class_driver_task(void *arg)
 {
     SemaphoreHandle_t signaling_sem = (SemaphoreHandle_t)arg;
     class_driver_t driver_obj = {0};
 
-    // Registrar a instância globalmente desde o início
-    global_driver_instance = &driver_obj;
-    ESP_LOGI(DRIVER_TAG, "Driver task started, instance registered");
+    ESP_LOGI(DRIVER_TAG, "Driver task started");
 
     //Wait until daemon task has installed USB Host Library
     xSemaphoreTake(signaling_sem, portMAX_DELAY);
@@ -483,14 +683,23 @@ void class_driver_task(void *arg)
         },
     };
     ESP_ERROR_CHECK(usb_host_client_register(&client_config, &driver_obj.client_hdl));
+    tx_client_hdl = driver_obj.client_hdl;
+
+    // Esta tarefa é a consumidora da saída HOST do router
+    static const midi_output_ops_t host_output_ops = {
+        .ready = midi_driver_ready_for_tx,
+        .wake = host_output_wake,
+    };
+    midi_tx_router_register_output(MIDI_OUT_HOST, &host_output_ops);
 
-    // Variável para controlar o tempo do processamento TX
-    TickType_t last_tx_process_time = xTaskGetTickCount();
-    const TickType_t tx_process_interval = pdMS_TO_TICKS(10);
+    uint32_t last_exhausted = 0;
+    int64_t last_exhausted_log_us = 0;
 
     while (1) {
         if (driver_obj.actions == 0) {
-            usb_host_client_handle_events(driver_obj.client_hdl, tx_process_interval);
+            // Bloqueia até um evento USB, um TX callback ou midi_send_data()
+            // chamar usb_host_client_unblock()
+            usb_host_client_handle_events(driver_obj.client_hdl, portMAX_DELAY);
         } else {
             if (driver_obj.actions & ACTION_OPEN_DEV) {
                 action_open_dev(&driver_obj);
@@ -524,18 +733,20 @@ void class_driver_task(void *arg)
             }
         }
 
-        // Processar fila TX a cada iteração
-        if (driver_obj.ready_for_tx) {
+        // Único ponto que drena a fila de TX
+        if (atomic_load(&tx_ready)) {
             process_tx_queue(&driver_obj);
         }
 
-        // Processamento adicional periódico da fila TX
-        TickType_t current_time = xTaskGetTickCount();
-        if ((current_time - last_tx_process_time) >= tx_process_interval) {
-            if (driver_obj.ready_for_tx) {
-                process_tx_queue(global_driver_instance);
+        // Pool esgotado: um aviso com o total, no máximo um por intervalo
+        uint32_t exhausted = tx_pool.exhausted_count;
+        if (exhausted != last_exhausted) {
+            int64_t now = esp_timer_get_time();
+            if (now - last_exhausted_log_us >= TX_POOL_EXHAUSTED_LOG_US) {
+                ESP_LOGW(DRIVER_TAG, "TX pool exhausted (%d in flight, %lu times)", MIDI_TX_POOL_SIZE, exhausted);
+                last_exhausted = exhausted;
+                last_exhausted_log_us = now;
             }
-            last_tx_process_time = current_time;
         }
     }
 }
@@ -546,78 +757,107 @@ void class_driver_task(void *arg)
 
 // Função para verificar se o driver está pronto para transmissão
 bool midi_driver_ready_for_tx(void) {
-    if (global_driver_instance == NULL) {
-        return false;
-    }
-
-    return global_driver_instance->ready_for_tx;
+    return atomic_load(&tx_ready);
 }
 
 // Função para obter o estado detalhado do driver
 void midi_driver_print_status(void) {
-    if (global_driver_instance == NULL) {
-        ESP_LOGI(DRIVER_TAG, "Driver status: NO INSTANCE");
-        return;
-    }
+    taskENTER_CRITICAL(&tx_pool_lock);
+    midi_tx_pool_t pool = tx_pool;
+    taskEXIT_CRITICAL(&tx_pool_lock);
 
     ESP_LOGI(DRIVER_TAG, "=== MIDI Driver Status ===");
-    ESP_LOGI(DRIVER_TAG, "  - Instance: %p", global_driver_instance);
-    ESP_LOGI(DRIVER_TAG, "  - Device handle: %p", global_driver_instance->dev_hdl);
-    ESP_LOGI(DRIVER_TAG, "  - Ready for TX: %s", 
-             global_driver_instance->ready_for_tx ? "YES" : "NO");
-    ESP_LOGI(DRIVER_TAG, "  - TX queue: %p", global_driver_instance->tx_queue);
-    ESP_LOGI(DRIVER_TAG, "  - OUT Endpoint: 0x%02X", 
-             global_driver_instance->interface_conf.endpoint_out_address);
+    ESP_LOGI(DRIVER_TAG, "  - Ready for TX: %s", atomic_load(&tx_ready) ? "YES" : "NO");
+    midi_output_stats_t out_stats;
+    midi_tx_router_get_stats(MIDI_OUT_HOST, &out_stats);
+    ESP_LOGI(DRIVER_TAG, "  - TX queue: %lu waiting, %lu queued, dropped %lu full / %lu not ready",
+             out_stats.pending, out_stats.enqueued, out_stats.dropped_full, out_stats.dropped_not_ready);
+    ESP_LOGI(DRIVER_TAG, "  - OUT Endpoint: 0x%02X", tx_endpoint_out);
+    ESP_LOGI(DRIVER_TAG, "  - TX pool: %d in flight (peak %lu), exhausted %lu times",
+             tx_pool_popcount(pool.in_flight_mask),
+             pool.in_flight_peak,
+             pool.exhausted_count);
+    ESP_LOGI(DRIVER_TAG, "  - TX completed: %lu messages in %lu transfers",
+             tx_stats.messages_completed,
+             tx_stats.transfers_completed);
+
+    midi_uart_ring_stats_t ring;
+    midi_uart_get_usb_ring_stats(&ring);
+    ESP_LOGI(DRIVER_TAG, "  - USB->DIN ring: %lu/%lu bytes used (high water %lu), dropped %lu",
+             ring.used, ring.size, ring.high_water, ring.dropped);
+    ESP_LOGI(DRIVER_TAG, "  - DIN OUT: %lu bytes written", ring.din_bytes);
     ESP_LOGI(DRIVER_TAG, "===========================");
 }
 
 // Função para enviar dados MIDI brutos
+// Apenas enfileira e acorda a tarefa do driver; o envio USB acontece lá.
 bool midi_send_data(const uint8_t *data, size_t length) {
-    ESP_LOGI(DRIVER_TAG, "midi_send_data called: length=%d", length);
-
-    if (global_driver_instance == NULL) {
-        ESP_LOGE(DRIVER_TAG, "midi_send_data: No driver instance");
-        return false;
-    }
+    return midi_send_data_from(data, length, MIDI_ORIGIN_NONE);
+}
 
-    if (!global_driver_instance->ready_for_tx) {
+// Igual a midi_send_data, com o instante de origem da mensagem (borda do
+// botão) para o histograma de latência
+bool midi_send_data_from(const uint8_t *data, size_t length, int64_t origin_us) {
+    if (!atomic_load(&tx_ready)) {
         ESP_LOGE(DRIVER_TAG, "midi_send_data: Driver not ready for TX");
         return false;
     }
 
-    // Verificação adicional: dispositivo ainda conectado?
-    if (global_driver_instance->dev_hdl == NULL) {
-        ESP_LOGW(DRIVER_TAG, "midi_send_data: Device not connected");
-        return false;
-    }
+    // A fila de TX é a saída HOST do router; ele acorda esta tarefa
+    return midi_tx_router_send_to(MIDI_OUT_MASK(MIDI_OUT_HOST), data, length, origin_us);
+}
 
-    if (data == NULL || length == 0) {
-        ESP_LOGE(DRIVER_TAG, "midi_send_data: Invalid data");
-        return false;
-    }
+// Mede o throughput de TX contra o dispositivo conectado: envia `bursts`
+// rajadas de `burst_len` mensagens Active Sensing e espera cada rajada ser
+// confirmada pelo TX callback antes da próxima.
+void midi_driver_tx_benchmark(int burst_len, int bursts) {
+    static const uint8_t active_sensing[MIDI_MESSAGE_LENGTH] = {0x0F, 0xFE, 0x00, 0x00};
 
-    ESP_LOGI(DRIVER_TAG, "Data: %02X %02X %02X %02X", 
-             data[0], data[1], data[2], data[3]);
+    if (burst_len <= 0 || bursts <= 0 || !midi_driver_ready_for_tx()) {
+        ESP_LOGW(DRIVER_TAG, "TX benchmark: driver not ready");
+        return;
+    }
 
-    internal_midi_message_t message;
-    memset(&message, 0, sizeof(message));
-    size_t copy_len = length;
-    if (copy_len > sizeof(message.data)) copy_len = sizeof(message.data);
-    memcpy(message.data, data, copy_len);
-    message.length = copy_len;
+    midi_tx_stats_t *stats = &tx_stats;
+    int64_t burst_min_us = INT64_MAX;
+    int64_t burst_max_us = 0;
+    int64_t total_us = 0;
+    uint32_t total_messages = 0;
+    uint32_t transfers_start = stats->transfers_completed;
 
-    // Tentar enviar para a fila
-    BaseType_t queue_result = xQueueSend(global_driver_instance->tx_queue, &message, pdMS_TO_TICKS(100));
+    for (int b = 0; b < bursts; b++) {
+        uint32_t target = stats->messages_completed + burst_len;
+        int64_t start_us = esp_timer_get_time();
 
-    if (queue_result != pdTRUE) {
-        ESP_LOGE(DRIVER_TAG, "TX queue full or error");
-        return false;
-    }
+        for (int i = 0; i < burst_len; i++) {
+            if (!midi_send_data(active_sensing, sizeof(active_sensing))) {
+                ESP_LOGE(DRIVER_TAG, "TX benchmark: send failed, aborting");
+                return;
+            }
+        }
 
-    ESP_LOGI(DRIVER_TAG, "MIDI message queued for transmission");
+        // Espera a rajada completar (o instante real vem do TX callback)
+        int64_t deadline_us = start_us + 1000 * 1000;
+        while ((int32_t)(stats->messages_completed - target) < 0) {
+            if (esp_timer_get_time() > deadline_us || !midi_driver_ready_for_tx()) {
+                ESP_LOGE(DRIVER_TAG, "TX benchmark: burst %d timed out", b);
+                return;
+            }
+            vTaskDelay(1);
+        }
 
-    // Processamento imediato
-    process_tx_queue(global_driver_instance);
+        int64_t burst_us = stats->last_complete_us - start_us;
+        if (burst_us < burst_min_us) burst_min_us = burst_us;
+        if (burst_us > burst_max_us) burst_max_us = burst_us;
+        total_us += burst_us;
+        total_messages += burst_len;
+    }
 
-    return true;
+    uint32_t transfers = stats->transfers_completed - transfers_start;
+    ESP_LOGI(DRIVER_TAG, "=== TX Benchmark (%d bursts x %d msgs) ===", bursts, burst_len);
+    ESP_LOGI(DRIVER_TAG, "  - Throughput: %.2f msgs/ms", total_us > 0 ? (double)total_messages * 1000.0 / (double)total_us : 0.0);
+    ESP_LOGI(DRIVER_TAG, "  - Burst completion: min %lld us, avg %lld us, max %lld us",
+             burst_min_us, total_us / bursts, burst_max_us);
+    ESP_LOGI(DRIVER_TAG, "  - Transfers: %lu (%.1f msgs/transfer)",
+             transfers, transfers > 0 ? (double)total_messages / (double)transfers : 0.0);
 }
@@ -18,6 +18,12 @@ void midi_driver_print_status(void);
 // Envia dados MIDI brutos via USB
 bool midi_send_data(const uint8_t *data, size_t length);
 
+// Igual, informando o instante de origem (esp_timer_get_time) para midi_latency
+bool midi_send_data_from(const uint8_t *data, size_t length, int64_t origin_us);
+
+// Benchmark de TX: rajadas de mensagens, reporta msgs/ms e tempo por rajada
+void midi_driver_tx_benchmark(int burst_len, int bursts);
+
 // Função que pode ser usada para processar dados USB e repassar para UART.
 // Implementação disponível na biblioteca midi_uart; se ausente, é uma stub.
 void process_usb_rx_for_uart(const uint8_t *data, size_t length);
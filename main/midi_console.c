@@ -0,0 +1,327 @@
+//midi_console.c
+#include "midi_console.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include "esp_console.h"
+#include "esp_log.h"
+#include "midi_latency.h"
+#include "midi_trace.h"
+#include "oled_display.h"
+#include "board_hal.h"
+#include "midi_route.h"
+
+static const char *TAG = "MIDI_CONSOLE";
+
+static int cmd_latency(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        midi_latency_reset();
+        printf("latency histograms cleared\n");
+        return 0;
+    }
+    if (argc > 1) {
+        printf("usage: latency [reset]\n");
+        return 1;
+    }
+    midi_latency_print();
+    return 0;
+}
+
+static int cmd_trace(int argc, char **argv)
+{
+    midi_trace_dump();
+    return 0;
+}
+
+static int cmd_display(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        oled_text_bench_t bench;
+        oled_text_bench(10000, &bench);
+        printf("draw_text: %lu ns/line changed, %lu ns/line unchanged (%lu lines)\n",
+               (unsigned long)bench.changed_ns, (unsigned long)bench.unchanged_ns,
+               (unsigned long)bench.lines);
+        return 0;
+    }
+    if (argc > 1) {
+        printf("usage: display [bench]\n");
+        return 1;
+    }
+    oled_redraw_stats_t stats;
+    oled_get_redraw_stats(&stats);
+    printf("redraws %lu (%lu requests), last %lu us (%lu pages), max %lu us\n",
+           (unsigned long)stats.redraws, (unsigned long)stats.requests, (unsigned long)stats.last_us,
+           (unsigned long)stats.last_pages, (unsigned long)stats.max_us);
+    return 0;
+}
+
+static int cmd_hal(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "start") == 0) {
+        board_hal_record_start();
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        board_hal_record_stop();
+    } else if (argc == 2 && strcmp(argv[1], "dump") == 0) {
+        board_hal_record_dump();
+    } else {
+        printf("usage: hal start|stop|dump\n");
+        return 1;
+    }
+    return 0;
+}
+
+// ===== route: rules of the routing stage =====
+
+static const char *const input_names[MIDI_IN_COUNT] = { "buttons", "usb", "din" };
+static const char *const curve_names[] = { "lin", "exp", "log", "inv" };
+
+static const struct {
+    const char *name;
+    uint16_t types;
+} type_names[] = {
+    { "note", MIDI_ROUTE_TYPE(0x80) | MIDI_ROUTE_TYPE(0x90) },
+    { "poly", MIDI_ROUTE_TYPE(0xA0) },
+    { "cc",   MIDI_ROUTE_TYPE(0xB0) },
+    { "pc",   MIDI_ROUTE_TYPE(0xC0) },
+    { "at",   MIDI_ROUTE_TYPE(0xD0) },
+    { "bend", MIDI_ROUTE_TYPE(0xE0) },
+    { "sys",  MIDI_ROUTE_TYPE(0xF0) },
+};
+
+// Index of name in a table of names, -1 if missing
+static int find_name(const char *name, const char *const *names, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Integer in [lo, hi]; false if the argument is not one
+static bool parse_int(const char *arg, int lo, int hi, int *value)
+{
+    char *end;
+    long v = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || v < lo || v > hi) {
+        return false;
+    }
+    *value = (int)v;
+    return true;
+}
+
+// Comma-separated outputs: usb (output of the current mode), host, device, din
+static bool parse_outputs(char *arg, uint8_t *outputs)
+{
+    *outputs = 0;
+    for (char *name = strtok(arg, ","); name != NULL; name = strtok(NULL, ",")) {
+        if (strcmp(name, "usb") == 0) {
+            *outputs |= MIDI_ROUTE_OUT_USB;
+        } else if (strcmp(name, "host") == 0) {
+            *outputs |= MIDI_OUT_MASK(MIDI_OUT_HOST);
+        } else if (strcmp(name, "device") == 0) {
+            *outputs |= MIDI_OUT_MASK(MIDI_OUT_DEVICE);
+        } else if (strcmp(name, "din") == 0) {
+            *outputs |= MIDI_OUT_MASK(MIDI_OUT_DIN);
+        } else {
+            return false;
+        }
+    }
+    return *outputs != 0;
+}
+
+// route add <in> <out>[,<out>] [ch N] [type T] [chout N] [cc IN [OUT]]
+//           [curve C] [range MIN MAX]
+static bool parse_rule(int argc, char **argv, midi_route_rule_t *rule)
+{
+    *rule = (midi_route_rule_t){
+        .channels = MIDI_ROUTE_ALL_CHANNELS, .types = MIDI_ROUTE_ALL_TYPES,
+        .channel_out = -1, .cc_in = -1, .cc_out = -1,
+        .curve = MIDI_CURVE_LINEAR, .value_min = 0, .value_max = 127,
+    };
+    if (argc < 2) {
+        return false;
+    }
+    int in = find_name(argv[0], input_names, MIDI_IN_COUNT);
+    if (in < 0 || !parse_outputs(argv[1], &rule->outputs)) {
+        return false;
+    }
+    rule->inputs = MIDI_IN_MASK(in);
+
+    bool types_set = false;
+    for (int i = 2; i < argc; i++) {
+        const char *key = argv[i];
+        int a, b;
+        if (strcmp(key, "ch") == 0 && i + 1 < argc && parse_int(argv[i + 1], 1, 16, &a)) {
+            rule->channels = (rule->channels == MIDI_ROUTE_ALL_CHANNELS) ? 0 : rule->channels;
+            rule->channels |= 1u << (a - 1);
+            i++;
+        } else if (strcmp(key, "chout") == 0 && i + 1 < argc && parse_int(argv[i + 1], 1, 16, &a)) {
+            rule->channel_out = (int8_t)(a - 1);
+            i++;
+        } else if (strcmp(key, "type") == 0 && i + 1 < argc) {
+            int t = 0;
+            while (t < (int)(sizeof(type_names) / sizeof(type_names[0])) && strcmp(argv[i + 1], type_names[t].name) != 0) {
+                t++;
+            }
+            if (t == (int)(sizeof(type_names) / sizeof(type_names[0]))) {
+                return false;
+            }
+            rule->types = (types_set ? rule->types : 0) | type_names[t].types;
+            types_set = true;
+            i++;
+        } else if (strcmp(key, "cc") == 0 && i + 1 < argc && parse_int(argv[i + 1], 0, 127, &a)) {
+            rule->cc_in = (int8_t)a;
+            i++;
+            if (i + 1 < argc && parse_int(argv[i + 1], 0, 127, &b)) {
+                rule->cc_out = (int8_t)b;
+                i++;
+            }
+        } else if (strcmp(key, "curve") == 0 && i + 1 < argc &&
+                   (a = find_name(argv[i + 1], curve_names, sizeof(curve_names) / sizeof(curve_names[0]))) >= 0) {
+            rule->curve = (uint8_t)a;
+            i++;
+        } else if (strcmp(key, "range") == 0 && i + 2 < argc &&
+                   parse_int(argv[i + 1], 0, 127, &a) && parse_int(argv[i + 2], 0, 127, &b)) {
+            rule->value_min = (uint8_t)a;
+            rule->value_max = (uint8_t)b;
+            i += 2;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_rule(int index, const midi_route_rule_t *rule)
+{
+    printf("%2d: ", index);
+    for (int in = 0; in < MIDI_IN_COUNT; in++) {
+        if (rule->inputs & MIDI_IN_MASK(in)) {
+            printf("%s ", input_names[in]);
+        }
+    }
+    printf("->%s%s%s%s",
+           (rule->outputs & MIDI_ROUTE_OUT_USB) ? " usb" : "",
+           (rule->outputs & MIDI_OUT_MASK(MIDI_OUT_HOST)) ? " host" : "",
+           (rule->outputs & MIDI_OUT_MASK(MIDI_OUT_DEVICE)) ? " device" : "",
+           (rule->outputs & MIDI_OUT_MASK(MIDI_OUT_DIN)) ? " din" : "");
+    if (rule->channels != MIDI_ROUTE_ALL_CHANNELS) {
+        printf("  ch mask 0x%04X", rule->channels);
+    }
+    if (rule->types != MIDI_ROUTE_ALL_TYPES) {
+        printf("  types 0x%04X", rule->types);
+    }
+    if (rule->channel_out >= 0) {
+        printf("  chout %d", rule->channel_out + 1);
+    }
+    if (rule->cc_in >= 0) {
+        printf("  cc %d", rule->cc_in);
+        if (rule->cc_out >= 0) {
+            printf(" -> %d", rule->cc_out);
+        }
+    }
+    if (rule->curve != MIDI_CURVE_LINEAR || rule->value_min != 0 || rule->value_max != 127) {
+        printf("  curve %s %u..%u",
+               rule->curve < sizeof(curve_names) / sizeof(curve_names[0]) ? curve_names[rule->curve] : "?",
+               rule->value_min, rule->value_max);
+    }
+    printf("\n");
+}
+
+static int cmd_route(int argc, char **argv)
+{
+    midi_route_rule_t rules[MIDI_ROUTE_MAX_RULES];
+    size_t count = midi_route_get_rules(rules, MIDI_ROUTE_MAX_RULES);
+
+    if (argc == 1) {
+        for (size_t i = 0; i < count; i++) {
+            print_rule((int)i, &rules[i]);
+        }
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        return midi_route_reset_rules() ? 0 : 1;
+    }
+    if (argc == 3 && strcmp(argv[1], "del") == 0) {
+        int index;
+        if (!parse_int(argv[2], 0, (int)count - 1, &index)) {
+            printf("no rule %s\n", argv[2]);
+            return 1;
+        }
+        memmove(&rules[index], &rules[index + 1], (count - index - 1) * sizeof(rules[0]));
+        return midi_route_set_rules(rules, count - 1) ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "add") == 0) {
+        if (count == MIDI_ROUTE_MAX_RULES) {
+            printf("rule table full (%d)\n", MIDI_ROUTE_MAX_RULES);
+            return 1;
+        }
+        if (!parse_rule(argc - 2, &argv[2], &rules[count])) {
+            printf("usage: route add buttons|usb|din <out>[,<out>] [ch 1-16] [type note|poly|cc|pc|at|bend|sys]\n"
+                   "                 [chout 1-16] [cc IN [OUT]] [curve lin|exp|log|inv] [range MIN MAX]\n"
+                   "       <out>: usb (current mode), host, device, din\n");
+            return 1;
+        }
+        return midi_route_set_rules(rules, count + 1) ? 0 : 1;
+    }
+    printf("usage: route [add ...|del N|reset]\n");
+    return 1;
+}
+
+void midi_console_start(void)
+{
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "midi>";
+    repl_config.task_priority = 1;
+
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t err = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Console init failed: %s", esp_err_to_name(err));
+        return;
+    }
+
+    const esp_console_cmd_t latency_cmd = {
+        .command = "latency",
+        .help = "Footswitch edge -> USB latency histograms (p50/p99/max). 'latency reset' clears them",
+        .hint = "[reset]",
+        .func = cmd_latency,
+    };
+    const esp_console_cmd_t trace_cmd = {
+        .command = "trace",
+        .help = "Decode pending MIDI trace events to the console",
+        .hint = NULL,
+        .func = cmd_trace,
+    };
+    const esp_console_cmd_t display_cmd = {
+        .command = "display",
+        .help = "OLED redraw time (draw into the buffer + flush of the changed pages). 'display bench' times text rendering",
+        .hint = "[bench]",
+        .func = cmd_display,
+    };
+    const esp_console_cmd_t hal_cmd = {
+        .command = "hal",
+        .help = "Record GPIO/UART/USB/I2C traffic (CONFIG_BOARD_HAL_RECORD) and dump it as a timeline for host/midi_sim",
+        .hint = "start|stop|dump",
+        .func = cmd_hal,
+    };
+    const esp_console_cmd_t route_cmd = {
+        .command = "route",
+        .help = "List the routing rules; 'route add' appends one (applied live), 'route del N' removes one, 'route reset' restores the defaults",
+        .hint = "[add <in> <out>[,<out>] [options]|del N|reset]",
+        .func = cmd_route,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&latency_cmd));
+    ESP_ERROR_CHECK(esp_console_cmd_register(&trace_cmd));
+    ESP_ERROR_CHECK(esp_console_cmd_register(&display_cmd));
+    ESP_ERROR_CHECK(esp_console_cmd_register(&hal_cmd));
+    ESP_ERROR_CHECK(esp_console_cmd_register(&route_cmd));
+    ESP_ERROR_CHECK(esp_console_register_help_command());
+
+    ESP_ERROR_CHECK(esp_console_start_repl(repl));
+    ESP_LOGI(TAG, "Console started (commands: latency, trace, display, hal, route, help)");
+}
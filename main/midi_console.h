@@ -0,0 +1,15 @@
+//midi_console.h
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Start the serial console REPL (UART0) with the diagnostic commands:
+//   latency [reset]   end-to-end latency histograms
+//   trace             dump pending MIDI trace events
+void midi_console_start(void);
+
+#ifdef __cplusplus
+}
+#endif
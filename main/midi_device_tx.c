@@ -1,35 +1,125 @@
 //midi_device_tx.c
 #include "midi_device_tx.h"
 #include "tinyusb.h"
+#include "tusb.h"
 #include "esp_log.h"
+#include "midi_uart.h"
+#include "midi_trace.h"
+#include "midi_latency.h"
+#include "midi_tx_router.h"
+#include "midi_route.h"
+#include "midi_monitor.h"
+#include "board_hal.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 static const char *TAG = "MIDI_DEVICE_TX";
 
-bool midi_device_send(const uint8_t *data, size_t length)
+static TaskHandle_t device_tx_task_handle = NULL;
+
+static bool device_output_ready(void)
 {
-    if (!data || length == 0) {
-        ESP_LOGW(TAG, "Empty MIDI message ignored");
-        return false;
-    }
+    return board_hal_usb_device_mounted();
+}
 
-    if (!tud_midi_mounted()) {
-        ESP_LOGW(TAG, "tud_midi_mounted() = false");
-        return false;
+static void device_output_wake(void)
+{
+    TaskHandle_t task = device_tx_task_handle;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
     }
+}
+
+// Consumidor da saída DEVICE do router: grava os pacotes no FIFO do TinyUSB.
+// Um PC lento só atrasa esta tarefa, não as outras saídas.
+void midi_device_tx_task(void *arg)
+{
+    device_tx_task_handle = xTaskGetCurrentTaskHandle();
 
-    // Envia pacote MIDI USB
-    uint32_t written = tud_midi_stream_write(0, data, length);
+    static const midi_output_ops_t device_output_ops = {
+        .ready = device_output_ready,
+        .wake = device_output_wake,
+    };
+    midi_tx_router_register_output(MIDI_OUT_DEVICE, &device_output_ops);
+    ESP_LOGI(TAG, "Device TX task started");
 
-    if (written != length) {
-        ESP_LOGW(TAG, "TinyUSB wrote only %lu of %u bytes", written, length);
-        return false;
+    uint32_t dropped = 0;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        midi_router_msg_t *msg;
+        while ((msg = midi_tx_router_pop(MIDI_OUT_DEVICE)) != NULL) {
+            // FIFO cheio: espera o host ler; desiste se o dispositivo desmontar
+            bool sent;
+            while (!(sent = board_hal_usb_device_write(msg->packet)) && board_hal_usb_device_mounted()) {
+                vTaskDelay(1);
+            }
+
+            if (sent) {
+                // TinyUSB não expõe conclusão por pacote: a escrita no FIFO é o último estágio
+                midi_latency_record(MIDI_LAT_SUBMIT, msg->origin_us);
+                MIDI_TRACE(MIDI_TRACE_DEVICE_TX, 4, msg->packet, 4);
+                midi_monitor_record(MIDI_MON_USB_TX, msg->packet);
+            } else {
+                dropped++;
+                ESP_LOGW(TAG, "Device unmounted, dropped packet (%lu total)", dropped);
+            }
+            midi_tx_router_release(msg);
+        }
     }
+}
 
-    ESP_LOGI(TAG, "DEVICE MIDI TX OK (%u bytes): %02X %02X %02X",
-             length,
-             data[0],
-             (length > 1 ? data[1] : 0),
-             (length > 2 ? data[2] : 0));
+// USB DEVICE RX -> tabelas de roteamento (padrão: MIDI DIN OUT).
+// Chamado pelo TinyUSB (na tarefa dele) quando o PC envia pacotes MIDI.
+void tud_midi_rx_cb(uint8_t itf)
+{
+    uint8_t routed[MIDI_OUT_COUNT][4];
+
+    while (1) {
+        // Packets are read straight into the USB->UART ring and transformed in
+        // place; only those routed to DIN are committed. Other outputs go
+        // through the router.
+        size_t available = 0;
+        uint8_t *slot = midi_uart_usb_reserve(&available);
+        size_t len = 0;
+        bool fifo_empty = false;
+        while (len + 4 <= available) {
+            if (!board_hal_usb_device_read(itf, &slot[len])) {
+                fifo_empty = true;
+                break;
+            }
+            midi_monitor_record(MIDI_MON_USB_RX, &slot[len]);
+            uint32_t mask = midi_route_apply(MIDI_IN_USB, &slot[len], routed);
+            midi_route_dispatch(mask, MIDI_OUT_MASK(MIDI_OUT_DIN), routed, MIDI_ORIGIN_NONE);
+            if (mask & MIDI_OUT_MASK(MIDI_OUT_DIN)) {
+                memcpy(&slot[len], routed[MIDI_OUT_DIN], 4);
+                len += 4;
+            }
+        }
+        midi_uart_usb_commit(len);
 
-    return true;
+        if (fifo_empty) {
+            break;
+        }
+        if (available < 4) {
+            // Ring full: drain TinyUSB anyway so the host is not stalled
+            uint8_t packet[4];
+            uint32_t dropped = 0;
+            while (board_hal_usb_device_read(itf, packet)) {
+                midi_monitor_record(MIDI_MON_USB_RX, packet);
+                uint32_t mask = midi_route_apply(MIDI_IN_USB, packet, routed);
+                midi_route_dispatch(mask, MIDI_OUT_MASK(MIDI_OUT_DIN), routed, MIDI_ORIGIN_NONE);
+                if ((mask & MIDI_OUT_MASK(MIDI_OUT_DIN)) &&
+                    !midi_uart_try_enqueue_usb(routed[MIDI_OUT_DIN], 4)) {
+                    dropped += 4;
+                }
+            }
+            if (dropped > 0) {
+                ESP_LOGW(TAG, "USB->UART ring full, dropped %lu bytes", dropped);
+            }
+            break;
+        }
+    }
 }
@@ -4,4 +4,5 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-bool midi_device_send(const uint8_t *data, size_t length);
+// Tarefa que drena a saída DEVICE do router (criar em main no modo DEVICE)
+void midi_device_tx_task(void *arg);
@@ -0,0 +1,124 @@
+//midi_latency.c
+#include "midi_latency.h"
+
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "MIDI_LATENCY";
+
+// Fixed linear buckets: 50 us wide up to 6.4 ms, plus an overflow bucket.
+// Resolution is well under one USB full-speed frame (1 ms).
+#define LAT_BUCKET_US       50
+#define LAT_BUCKETS         128
+
+typedef struct {
+    atomic_uint buckets[LAT_BUCKETS + 1];   // last one = overflow
+    atomic_uint max_us;
+} latency_hist_t;
+
+static latency_hist_t histograms[MIDI_LAT_STAGE_COUNT];
+
+static const char *const stage_names[MIDI_LAT_STAGE_COUNT] = {
+    [MIDI_LAT_ROUTER]   = "router",
+    [MIDI_LAT_DEQUEUE]  = "dequeue",
+    [MIDI_LAT_SUBMIT]   = "submit",
+    [MIDI_LAT_COMPLETE] = "complete",
+};
+
+void midi_latency_record(midi_latency_stage_t stage, int64_t origin_us)
+{
+    if (stage >= MIDI_LAT_STAGE_COUNT || origin_us <= 0) {
+        return;
+    }
+
+    int64_t delta = esp_timer_get_time() - origin_us;
+    if (delta < 0) {
+        delta = 0;
+    }
+    uint32_t us = delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta;
+
+    latency_hist_t *hist = &histograms[stage];
+    uint32_t bucket = us / LAT_BUCKET_US;
+    if (bucket > LAT_BUCKETS) {
+        bucket = LAT_BUCKETS;
+    }
+    atomic_fetch_add_explicit(&hist->buckets[bucket], 1, memory_order_relaxed);
+
+    unsigned max = atomic_load_explicit(&hist->max_us, memory_order_relaxed);
+    while (us > max &&
+           !atomic_compare_exchange_weak_explicit(&hist->max_us, &max, us,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void midi_latency_get_summary(midi_latency_stage_t stage, midi_latency_summary_t *summary)
+{
+    uint32_t counts[LAT_BUCKETS + 1];
+    uint32_t total = 0;
+
+    *summary = (midi_latency_summary_t){0};
+    if (stage >= MIDI_LAT_STAGE_COUNT) {
+        return;
+    }
+
+    // Snapshot first so both percentiles come from the same counts
+    latency_hist_t *hist = &histograms[stage];
+    for (int i = 0; i <= LAT_BUCKETS; i++) {
+        counts[i] = atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+        total += counts[i];
+    }
+    summary->count = total;
+    summary->overflow = counts[LAT_BUCKETS];
+    summary->max_us = atomic_load_explicit(&hist->max_us, memory_order_relaxed);
+    if (total == 0) {
+        return;
+    }
+
+    // Ceil so p99 of fewer than 100 samples is the largest one
+    uint32_t rank50 = (total + 1) / 2;
+    uint32_t rank99 = (uint32_t)(((uint64_t)total * 99 + 99) / 100);
+    uint32_t seen = 0;
+    for (int i = 0; i <= LAT_BUCKETS; i++) {
+        seen += counts[i];
+        uint32_t upper = (i == LAT_BUCKETS) ? summary->max_us : (uint32_t)(i + 1) * LAT_BUCKET_US;
+        if (upper > summary->max_us) {
+            upper = summary->max_us;
+        }
+        if (summary->p50_us == 0 && seen >= rank50) {
+            summary->p50_us = upper;
+        }
+        if (seen >= rank99) {
+            summary->p99_us = upper;
+            break;
+        }
+    }
+}
+
+const char *midi_latency_stage_name(midi_latency_stage_t stage)
+{
+    return stage < MIDI_LAT_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+void midi_latency_reset(void)
+{
+    for (int s = 0; s < MIDI_LAT_STAGE_COUNT; s++) {
+        for (int i = 0; i <= LAT_BUCKETS; i++) {
+            atomic_store_explicit(&histograms[s].buckets[i], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&histograms[s].max_us, 0, memory_order_relaxed);
+    }
+}
+
+void midi_latency_print(void)
+{
+    ESP_LOGI(TAG, "Latency from origin (us), %d us buckets:", LAT_BUCKET_US);
+    ESP_LOGI(TAG, "  %-9s %8s %7s %7s %7s", "stage", "count", "p50", "p99", "max");
+    for (int s = 0; s < MIDI_LAT_STAGE_COUNT; s++) {
+        midi_latency_summary_t sum;
+        midi_latency_get_summary((midi_latency_stage_t)s, &sum);
+        ESP_LOGI(TAG, "  %-9s %8lu %7lu %7lu %7lu%s", stage_names[s],
+                 sum.count, sum.p50_us, sum.p99_us, sum.max_us,
+                 sum.overflow ? " (overflow)" : "");
+    }
+}
@@ -0,0 +1,47 @@
+//midi_latency.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// End-to-end latency of outgoing MIDI, measured from the footswitch edge to
+// each stage. Only footswitch messages are timed: forwarded DIN/USB traffic
+// and raw sends carry MIDI_ORIGIN_NONE and stay out of the histograms (their
+// origin would be the router entry itself, a flood of ~0 us samples).
+#define MIDI_ORIGIN_NONE        0
+
+typedef enum {
+    MIDI_LAT_ROUTER = 0,    // router entry
+    MIDI_LAT_DEQUEUE,       // taken from the USB host TX queue
+    MIDI_LAT_SUBMIT,        // usb_host_transfer_submit / written to TinyUSB
+    MIDI_LAT_COMPLETE,      // USB host transfer completed
+    MIDI_LAT_STAGE_COUNT
+} midi_latency_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t p50_us;        // bucket upper bound (capped at max)
+    uint32_t p99_us;        // bucket upper bound (capped at max)
+    uint32_t max_us;        // exact
+    uint32_t overflow;      // samples beyond the last bucket
+} midi_latency_summary_t;
+
+// Record (now - origin_us) into the histogram of the given stage.
+// MIDI_ORIGIN_NONE (or any origin <= 0) is ignored.
+// Lock-free; callable from any task.
+void midi_latency_record(midi_latency_stage_t stage, int64_t origin_us);
+
+void midi_latency_get_summary(midi_latency_stage_t stage, midi_latency_summary_t *summary);
+const char *midi_latency_stage_name(midi_latency_stage_t stage);
+void midi_latency_reset(void);
+
+// Log the summary of every stage
+void midi_latency_print(void);
+
+#ifdef __cplusplus
+}
+#endif
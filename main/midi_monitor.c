@@ -0,0 +1,72 @@
+//midi_monitor.c
+#include "midi_monitor.h"
+#include <string.h>
+#include <stdatomic.h>
+
+#define HISTORY_MASK    (MIDI_MONITOR_HISTORY - 1)
+
+typedef struct {
+    atomic_uint messages;               // also the history write index
+    atomic_uint channel[16];
+    _Atomic uint32_t last[MIDI_MONITOR_HISTORY];  // packet bytes, little-endian
+} monitor_port_t;
+
+static monitor_port_t ports[MIDI_MON_PORT_COUNT];
+
+static inline void bump(atomic_uint *counter)
+{
+    // Single writer: a plain load/store pair is enough
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+void midi_monitor_record(midi_monitor_port_t port, const uint8_t packet[4])
+{
+    // CIN 0/1 are reserved/padding, CIN 4 is SysEx start/continue: a SysEx
+    // counts once, on its end packet
+    uint8_t cin = packet[0] & 0x0F;
+    if (cin < 0x2 || cin == 0x4 || port >= MIDI_MON_PORT_COUNT) {
+        return;
+    }
+
+    monitor_port_t *p = &ports[port];
+    uint8_t status = packet[1];
+    if (status >= 0x80 && status < 0xF0) {
+        bump(&p->channel[status & 0x0F]);
+    }
+
+    uint32_t word;
+    memcpy(&word, packet, sizeof(word));
+    unsigned index = atomic_load_explicit(&p->messages, memory_order_relaxed);
+    atomic_store_explicit(&p->last[index & HISTORY_MASK], word, memory_order_relaxed);
+    atomic_store_explicit(&p->messages, index + 1, memory_order_release);
+}
+
+void midi_monitor_record_packets(midi_monitor_port_t port, const uint8_t *packets, size_t length)
+{
+    for (size_t offset = 0; offset + 4 <= length; offset += 4) {
+        midi_monitor_record(port, &packets[offset]);
+    }
+}
+
+void midi_monitor_snapshot(midi_monitor_snapshot_t *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    for (int port = 0; port < MIDI_MON_PORT_COUNT; port++) {
+        monitor_port_t *p = &ports[port];
+        unsigned count = atomic_load_explicit(&p->messages, memory_order_acquire);
+        snapshot->messages[port] = count;
+
+        unsigned valid = count < MIDI_MONITOR_HISTORY ? count : MIDI_MONITOR_HISTORY;
+        for (unsigned i = 0; i < valid; i++) {
+            uint32_t word = atomic_load_explicit(&p->last[(count - 1 - i) & HISTORY_MASK], memory_order_relaxed);
+            memcpy(snapshot->last[port][i], &word, sizeof(word));
+        }
+        snapshot->last_count[port] = (uint8_t)valid;
+
+        for (int ch = 0; ch < 16; ch++) {
+            snapshot->channel_messages[ch] += atomic_load_explicit(&p->channel[ch], memory_order_relaxed);
+        }
+    }
+}
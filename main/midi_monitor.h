@@ -0,0 +1,44 @@
+//midi_monitor.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Activity counters for the OLED monitor page.
+// Each port has a single writer (the task that owns that end of the path),
+// so recording is a few relaxed stores with no locks or read-modify-write.
+// The display reads a snapshot; a value overwritten during the copy only
+// shows up one frame late.
+
+typedef enum {
+    MIDI_MON_USB_RX = 0,    // host RX callback / tud_midi_rx_cb
+    MIDI_MON_USB_TX,        // host OUT transfer submit / device FIFO write
+    MIDI_MON_DIN_IN,        // DIN parser output
+    MIDI_MON_DIN_OUT,       // packets encoded for the UART
+    MIDI_MON_PORT_COUNT
+} midi_monitor_port_t;
+
+#define MIDI_MONITOR_HISTORY    4   // last events kept per port (power of two)
+
+typedef struct {
+    uint32_t messages[MIDI_MON_PORT_COUNT];         // running totals
+    uint32_t channel_messages[16];                  // channel voice messages, all ports
+    uint8_t last[MIDI_MON_PORT_COUNT][MIDI_MONITOR_HISTORY][4];  // newest first
+    uint8_t last_count[MIDI_MON_PORT_COUNT];        // valid entries in last[]
+} midi_monitor_snapshot_t;
+
+// One USB-MIDI packet. Only from the port's owner task.
+void midi_monitor_record(midi_monitor_port_t port, const uint8_t packet[4]);
+
+// A run of USB-MIDI packets (length in bytes)
+void midi_monitor_record_packets(midi_monitor_port_t port, const uint8_t *packets, size_t length);
+
+void midi_monitor_snapshot(midi_monitor_snapshot_t *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,141 @@
+//midi_route.c
+#include "midi_route.h"
+#include "midi_board.h"     // midi_default_rules
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdatomic.h>
+
+static const char *TAG = "MIDI_ROUTE";
+
+// Two tables: one published for the input paths, one being compiled.
+// Readers announce themselves on the table they use (reader count) and
+// check it is still the published one before touching it; a writer only
+// recompiles a table once its count has dropped to zero.
+static struct {
+    midi_route_table_t table;
+    atomic_uint readers;
+} slots[2];
+static _Atomic(midi_route_table_t *) active_table = NULL;
+
+// Serializes writers (boot, console) and guards the rule copy below
+static SemaphoreHandle_t rules_mutex;
+static midi_route_rule_t active_rules[MIDI_ROUTE_MAX_RULES];
+static size_t active_rule_count;
+
+bool midi_route_set_rules(const midi_route_rule_t *rules, size_t count)
+{
+    if (count > MIDI_ROUTE_MAX_RULES) {
+        ESP_LOGE(TAG, "%u rules, at most %d", (unsigned)count, MIDI_ROUTE_MAX_RULES);
+        return false;
+    }
+
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+
+    int next = (atomic_load(&active_table) == &slots[0].table) ? 1 : 0;
+    midi_route_table_t *t = &slots[next].table;
+
+    // Packets that loaded this table before the previous swap may still be
+    // reading it. New readers see it is not published and back off.
+    while (atomic_load(&slots[next].readers) != 0) {
+        vTaskDelay(1);
+    }
+
+    bool ok = midi_route_table_compile(t, rules, count, midi_tx_router_usb_mask());
+    if (ok) {
+        atomic_store(&active_table, t);
+        memcpy(active_rules, rules, count * sizeof(rules[0]));
+        active_rule_count = count;
+    }
+
+    xSemaphoreGive(rules_mutex);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Rules need more than %d distinct value curves", MIDI_ROUTE_MAX_CURVES);
+        return false;
+    }
+    ESP_LOGI(TAG, "%u rules compiled (%u curves, outputs: buttons 0x%02X usb 0x%02X din 0x%02X)",
+             (unsigned)count, t->curve_count,
+             t->out_mask[MIDI_IN_BUTTONS], t->out_mask[MIDI_IN_USB], t->out_mask[MIDI_IN_DIN]);
+    return true;
+}
+
+size_t midi_route_get_rules(midi_route_rule_t *rules, size_t max)
+{
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+    size_t count = active_rule_count < max ? active_rule_count : max;
+    memcpy(rules, active_rules, count * sizeof(rules[0]));
+    xSemaphoreGive(rules_mutex);
+    return count;
+}
+
+bool midi_route_reset_rules(void)
+{
+    return midi_route_set_rules(midi_default_rules, MIDI_DEFAULT_RULE_COUNT);
+}
+
+void midi_route_init(void)
+{
+    rules_mutex = xSemaphoreCreateMutex();
+    midi_route_reset_rules();
+}
+
+uint32_t midi_route_apply(midi_input_t in, const uint8_t packet[4], uint8_t out[MIDI_OUT_COUNT][4])
+{
+    midi_route_table_t *t;
+    atomic_uint *readers;
+
+    // Count ourselves on the table, then make sure it was not swapped out in
+    // between: a writer that already saw zero readers may be rebuilding it
+    for (;;) {
+        t = atomic_load(&active_table);
+        if (t == NULL) {
+            return 0;
+        }
+        readers = &slots[t == &slots[1].table].readers;
+        atomic_fetch_add(readers, 1);
+        if (atomic_load(&active_table) == t) {
+            break;
+        }
+        atomic_fetch_sub(readers, 1);
+    }
+
+    uint32_t mask = midi_route_table_apply(t, in, packet, out);
+    atomic_fetch_sub_explicit(readers, 1, memory_order_release);
+    return mask;
+}
+
+bool midi_route_dispatch(uint32_t mask, uint32_t skip_mask, uint8_t out[MIDI_OUT_COUNT][4], int64_t origin_us)
+{
+    bool sent = false;
+    mask &= ~skip_mask;
+
+    while (mask) {
+        int first = __builtin_ctz(mask);
+        uint32_t group = MIDI_OUT_MASK(first);
+        for (int o = first + 1; o < MIDI_OUT_COUNT; o++) {
+            if ((mask & MIDI_OUT_MASK(o)) && memcmp(out[o], out[first], 4) == 0) {
+                group |= MIDI_OUT_MASK(o);
+            }
+        }
+        sent |= midi_tx_router_send_to(group, out[first], 4, origin_us);
+        mask &= ~group;
+    }
+    return sent;
+}
+
+bool midi_route_send(midi_input_t in, const uint8_t *data, size_t length, int64_t origin_us)
+{
+    if (!data || length == 0) {
+        return false;
+    }
+
+    uint8_t packet[4] = {0};
+    memcpy(packet, data, length < sizeof(packet) ? length : sizeof(packet));
+
+    uint8_t out[MIDI_OUT_COUNT][4];
+    uint32_t mask = midi_route_apply(in, packet, out);
+    return midi_route_dispatch(mask, 0, out, origin_us);
+}
@@ -0,0 +1,52 @@
+//midi_route.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "midi_tx_router.h"
+#include "midi_route_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Routing/transform stage between the MIDI inputs and the router outputs.
+// Rule types and the compiled tables live in midi_core (midi_route_table.h);
+// this module publishes the active table to the MIDI tasks and dispatches
+// the results through the router.
+
+#define MIDI_ROUTE_MAX_RULES        16
+
+// Compile the default rules (buttons -> USB + DIN, DIN -> USB, USB -> DIN).
+// Call after current_usb_mode is set, before any other midi_route call.
+void midi_route_init(void);
+
+// Compile and publish a new rule set (console 'route' command). Later rules
+// override the transform of earlier ones for the same input/output/status;
+// outputs add up. CC number/curve tables are per input/output, not per
+// channel. Callable from any task while MIDI is flowing: writers are
+// serialized and a table is only rebuilt once no packet is reading it.
+// May block a tick or so waiting for those readers.
+bool midi_route_set_rules(const midi_route_rule_t *rules, size_t count);
+
+// Back to the default rules
+bool midi_route_reset_rules(void);
+
+// Copy of the rules currently published. Returns how many were copied.
+size_t midi_route_get_rules(midi_route_rule_t *rules, size_t max);
+
+// Apply the tables to one USB-MIDI packet. Returns the output mask and
+// writes the transformed packet for each set bit into out[output].
+uint32_t midi_route_apply(midi_input_t in, const uint8_t packet[4], uint8_t out[MIDI_OUT_COUNT][4]);
+
+// Send the results of midi_route_apply through the router, excluding the
+// outputs in skip_mask. Outputs with identical packets share one message.
+bool midi_route_dispatch(uint32_t mask, uint32_t skip_mask, uint8_t out[MIDI_OUT_COUNT][4], int64_t origin_us);
+
+// apply + dispatch for a single packet
+bool midi_route_send(midi_input_t in, const uint8_t *data, size_t length, int64_t origin_us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -24,15 +24,17 @@ bool load_midi_commands(void)
     nvs_handle_t nvs_handle;
     esp_err_t err;
 
+    // Lidos numa cópia local e publicados comando a comando no final
+    midi_command_t commands[BUTTON_COUNT];
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        midi_command_set_default(&commands[i], i);
+    }
+
     err = nvs_open("midi_storage", NVS_READONLY, &nvs_handle);
     if (err != ESP_OK) {
         ESP_LOGI(TAG, "No saved MIDI commands found, using defaults");
         for (int i = 0; i < BUTTON_COUNT; i++) {
-            current_commands[i].data[0] = 0x0B;
-            current_commands[i].data[1] = 0xB0;
-            current_commands[i].data[2] = 0x00;
-            current_commands[i].data[3] = 0x00;
-            snprintf(current_commands[i].description, sizeof(current_commands[i].description), "Button %d", i + 1);
+            midi_command_publish(&current_commands[i], commands[i].data);
         }
         return false;
     }
@@ -40,16 +42,12 @@ bool load_midi_commands(void)
     bool success = true;
     for (int button = 0; button < BUTTON_COUNT; button++) {
         for (int i = 0; i < 4; i++) {
-            char key[15];
-            snprintf(key, sizeof(key), "btn%d_byte%d", button, i);
-            err = nvs_get_u8(nvs_handle, key, &current_commands[button].data[i]);
+            char key[MIDI_COMMAND_KEY_SIZE];
+            midi_command_key(key, button, i);
+            err = nvs_get_u8(nvs_handle, key, &commands[button].data[i]);
             if (err != ESP_OK) {
                 success = false;
-                current_commands[button].data[0] = 0x0B;
-                current_commands[button].data[1] = 0xB0;
-                current_commands[button].data[2] = 0x00;
-                current_commands[button].data[3] = 0x00;
-                snprintf(current_commands[button].description, sizeof(current_commands[button].description), "Button %d", button + 1);
+                midi_command_set_default(&commands[button], button);
                 break;
             }
         }
@@ -58,12 +56,16 @@ bool load_midi_commands(void)
 
     nvs_close(nvs_handle);
 
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        midi_command_publish(&current_commands[i], commands[i].data);
+    }
+
     if (success) {
         ESP_LOGI(TAG, "MIDI commands loaded successfully");
         for (int i = 0; i < BUTTON_COUNT; i++) {
             ESP_LOGI(TAG, "Button %d: %02X %02X %02X %02X", i + 1,
-                    current_commands[i].data[0], current_commands[i].data[1],
-                    current_commands[i].data[2], current_commands[i].data[3]);
+                    commands[i].data[0], commands[i].data[1],
+                    commands[i].data[2], commands[i].data[3]);
         }
     } else {
         ESP_LOGI(TAG, "Failed to load MIDI commands, using defaults");
@@ -84,10 +86,12 @@ void save_midi_commands(void)
     }
 
     for (int button = 0; button < BUTTON_COUNT; button++) {
+        uint8_t data[4];
+        midi_command_read(&current_commands[button], data);
         for (int i = 0; i < 4; i++) {
-            char key[15];
-            snprintf(key, sizeof(key), "btn%d_byte%d", button, i);
-            err = nvs_set_u8(nvs_handle, key, current_commands[button].data[i]);
+            char key[MIDI_COMMAND_KEY_SIZE];
+            midi_command_key(key, button, i);
+            err = nvs_set_u8(nvs_handle, key, data[i]);
             if (err != ESP_OK) {
                 ESP_LOGE(TAG, "Error saving button %d byte %d: %s", button, i, esp_err_to_name(err));
                 nvs_close(nvs_handle);
@@ -0,0 +1,150 @@
+//midi_trace.c
+#include "midi_trace.h"
+
+#if CONFIG_MIDI_TRACE
+
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+static const char *TAG = "MIDI_TRACE";
+
+#define TRACE_EVENTS        CONFIG_MIDI_TRACE_EVENTS
+#define TRACE_MASK          (TRACE_EVENTS - 1)
+#define TRACE_DRAIN_PERIOD_MS   50
+
+_Static_assert((TRACE_EVENTS & TRACE_MASK) == 0, "CONFIG_MIDI_TRACE_EVENTS must be a power of two");
+
+// Each slot carries a sequence number: 0 while a producer is writing it,
+// otherwise (index + 1) of the event it holds. The reader uses it to detect
+// events that are still being written or were overwritten while copying.
+typedef struct {
+    atomic_uint seq;
+    midi_trace_event_t event;
+} trace_slot_t;
+
+static trace_slot_t trace_ring[TRACE_EVENTS];
+static atomic_uint trace_head = 0;        // next index to claim (producers)
+static unsigned trace_tail = 0;           // next index to read (reader only)
+static atomic_flag trace_reader_busy = ATOMIC_FLAG_INIT;
+static uint32_t trace_lost = 0;
+
+static const char *const trace_names[MIDI_TRACE_EVENT_MAX] = {
+    [MIDI_TRACE_BUTTON_SEND]     = "BUTTON",
+    [MIDI_TRACE_ROUTER_HOST]     = "ROUTE_HOST",
+    [MIDI_TRACE_ROUTER_DEVICE]   = "ROUTE_DEV",
+    [MIDI_TRACE_ROUTER_DIN]      = "ROUTE_DIN",
+    [MIDI_TRACE_ROUTER_DROP]     = "ROUTE_DROP",
+    [MIDI_TRACE_HOST_SUBMIT]     = "HOST_SUBMIT",
+    [MIDI_TRACE_HOST_TX_DONE]    = "HOST_TX_DONE",
+    [MIDI_TRACE_HOST_TX_FAIL]    = "HOST_TX_FAIL",
+    [MIDI_TRACE_HOST_RX]         = "HOST_RX",
+    [MIDI_TRACE_DEVICE_TX]       = "DEVICE_TX",
+};
+
+// Lock-free, callable from any task. Never blocks; overwrites the oldest
+// event when the reader falls behind.
+void midi_trace_record(midi_trace_id_t id, uint16_t arg, const uint8_t *data, size_t length)
+{
+    unsigned index = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed);
+    trace_slot_t *slot = &trace_ring[index & TRACE_MASK];
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->event.timestamp_us = esp_timer_get_time();
+    slot->event.id = (uint8_t)id;
+    slot->event.reserved = 0;
+    slot->event.arg = arg;
+    memset(slot->event.data, 0, sizeof(slot->event.data));
+    if (data != NULL) {
+        memcpy(slot->event.data, data, length < sizeof(slot->event.data) ? length : sizeof(slot->event.data));
+    }
+
+    atomic_store_explicit(&slot->seq, index + 1, memory_order_release);
+}
+
+// Read the next event. Returns false when nothing complete is pending.
+static bool trace_read(midi_trace_event_t *out)
+{
+    while (1) {
+        unsigned head = atomic_load_explicit(&trace_head, memory_order_acquire);
+        if (trace_tail == head) {
+            return false;
+        }
+        if (head - trace_tail > TRACE_EVENTS) {
+            // Reader lapped: skip to the oldest event still in the ring
+            trace_lost += head - trace_tail - TRACE_EVENTS;
+            trace_tail = head - TRACE_EVENTS;
+        }
+
+        trace_slot_t *slot = &trace_ring[trace_tail & TRACE_MASK];
+        unsigned expected = trace_tail + 1;
+        unsigned seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+        if (seq != expected) {
+            if (seq == 0 || (int)(seq - expected) < 0) {
+                return false;   // producer still writing this slot
+            }
+            trace_lost++;       // overwritten by a newer event
+            trace_tail++;
+            continue;
+        }
+
+        *out = slot->event;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != expected) {
+            trace_lost++;       // overwritten while copying
+            trace_tail++;
+            continue;
+        }
+
+        trace_tail++;
+        return true;
+    }
+}
+
+static void trace_print(const midi_trace_event_t *ev)
+{
+    const char *name = (ev->id < MIDI_TRACE_EVENT_MAX && trace_names[ev->id] != NULL)
+                       ? trace_names[ev->id] : "?";
+    ESP_LOGI(TAG, "%10lld us  %-12s arg=%-4u %02X %02X %02X %02X",
+             ev->timestamp_us, name, ev->arg,
+             ev->data[0], ev->data[1], ev->data[2], ev->data[3]);
+}
+
+static void trace_drain(void)
+{
+    // Single reader at a time: the drain task and midi_trace_dump() may race
+    if (atomic_flag_test_and_set(&trace_reader_busy)) {
+        return;
+    }
+
+    midi_trace_event_t ev;
+    uint32_t lost_before = trace_lost;
+    while (trace_read(&ev)) {
+        trace_print(&ev);
+    }
+    if (trace_lost != lost_before) {
+        ESP_LOGW(TAG, "%lu trace events lost (ring of %d)", trace_lost - lost_before, TRACE_EVENTS);
+    }
+
+    atomic_flag_clear(&trace_reader_busy);
+}
+
+void midi_trace_dump(void)
+{
+    trace_drain();
+}
+
+void midi_trace_drain_task(void *arg)
+{
+    while (1) {
+        trace_drain();
+        vTaskDelay(pdMS_TO_TICKS(TRACE_DRAIN_PERIOD_MS));
+    }
+}
+
+#endif // CONFIG_MIDI_TRACE
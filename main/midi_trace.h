@@ -0,0 +1,69 @@
+//midi_trace.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary trace of the MIDI hot path.
+// Producers (any task, or the USB host callbacks) record a 16-byte event into
+// a lock-free ring; formatting to text happens later in a low-priority task
+// or in midi_trace_dump(). When the ring is full the oldest events are lost.
+
+typedef enum {
+    MIDI_TRACE_BUTTON_SEND = 1,   // arg = button index, data = command
+    MIDI_TRACE_ROUTER_HOST,       // queued for the output, data = packet
+    MIDI_TRACE_ROUTER_DEVICE,     // queued for the output, data = packet
+    MIDI_TRACE_ROUTER_DIN,        // queued for the output, data = packet
+    MIDI_TRACE_ROUTER_DROP,       // arg = output mask dropped, data = packet
+    MIDI_TRACE_HOST_SUBMIT,       // arg = events in transfer, data = first packet
+    MIDI_TRACE_HOST_TX_DONE,      // arg = bytes sent
+    MIDI_TRACE_HOST_TX_FAIL,      // arg = transfer status
+    MIDI_TRACE_HOST_RX,           // arg = bytes received, data = first packet
+    MIDI_TRACE_DEVICE_TX,         // arg = bytes written, data = packet
+    MIDI_TRACE_EVENT_MAX
+} midi_trace_id_t;
+
+typedef struct {
+    int64_t timestamp_us;
+    uint8_t id;
+    uint8_t reserved;
+    uint16_t arg;
+    uint8_t data[4];
+} midi_trace_event_t;
+
+#if CONFIG_MIDI_TRACE
+
+void midi_trace_record(midi_trace_id_t id, uint16_t arg, const uint8_t *data, size_t length);
+
+// Decode every pending event to the console now
+void midi_trace_dump(void);
+
+// Low-priority task decoding events to the console as they arrive
+// (CONFIG_MIDI_TRACE_CONSOLE_DRAIN)
+void midi_trace_drain_task(void *arg);
+
+#define MIDI_TRACE(id, arg, data, length)   midi_trace_record((id), (uint16_t)(arg), (data), (length))
+
+#else
+
+static inline void midi_trace_dump(void) {}
+#define MIDI_TRACE(id, arg, data, length)   do { } while (0)
+
+#endif
+
+// Text logging in the hot path, compiled out unless CONFIG_MIDI_HOT_PATH_LOG
+#if CONFIG_MIDI_HOT_PATH_LOG
+#define MIDI_HOT_LOGI(tag, format, ...)     ESP_LOGI(tag, format, ##__VA_ARGS__)
+#else
+#define MIDI_HOT_LOGI(tag, format, ...)     do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
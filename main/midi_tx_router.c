@@ -1,62 +1,214 @@
 //midi_tx_router.c
 #include "midi_tx_router.h"
-#include "midi_class_driver_txrx.h"
-#include "midi_device_tx.h"
 #include "esp_log.h"
-#include "tusb.h"
+#include "esp_timer.h"
+#include "midi_trace.h"
+#include "midi_latency.h"
+#include "midi_mpmc.h"   // filas lock-free (Vyukov) de índices do pool
+#include <string.h>
+#include <stdatomic.h>
 
 static const char *TAG = "MIDI_ROUTER";
 
 // DEFINIÇÃO REAL — gerará o símbolo para o linker
 usb_operation_mode_t current_usb_mode = USB_MODE_HOST;
 
+#define ROUTER_POOL_SIZE        128     // mensagens em voo somando todas as saídas
+#define ROUTER_QUEUE_LEN        64      // por saída
+
+_Static_assert((ROUTER_POOL_SIZE & (ROUTER_POOL_SIZE - 1)) == 0, "ROUTER_POOL_SIZE must be a power of two");
+_Static_assert((ROUTER_QUEUE_LEN & (ROUTER_QUEUE_LEN - 1)) == 0, "ROUTER_QUEUE_LEN must be a power of two");
+
+// Mensagem do pool + quantas saídas ainda a referenciam
+typedef struct {
+    midi_router_msg_t msg;
+    atomic_uint refs;
+} router_slot_t;
+
+typedef struct {
+    midi_output_ops_t ops;
+    atomic_bool registered;
+    atomic_uint enqueued;
+    atomic_uint dropped_full;
+    atomic_uint dropped_not_ready;
+} router_output_t;
+
+static router_slot_t pool[ROUTER_POOL_SIZE];
+static midi_mpmc_cell_t free_cells[ROUTER_POOL_SIZE];
+static midi_mpmc_queue_t free_queue = { .cells = free_cells, .mask = ROUTER_POOL_SIZE - 1 };
+static atomic_uint pool_exhausted = 0;
+
+static midi_mpmc_cell_t output_cells[MIDI_OUT_COUNT][ROUTER_QUEUE_LEN];
+static midi_mpmc_queue_t output_queues[MIDI_OUT_COUNT];
+static router_output_t outputs[MIDI_OUT_COUNT];
+
+#if CONFIG_MIDI_TRACE
+static const midi_trace_id_t output_trace_id[MIDI_OUT_COUNT] = {
+    [MIDI_OUT_HOST]   = MIDI_TRACE_ROUTER_HOST,
+    [MIDI_OUT_DEVICE] = MIDI_TRACE_ROUTER_DEVICE,
+    [MIDI_OUT_DIN]    = MIDI_TRACE_ROUTER_DIN,
+};
+#endif
+
+static void slot_unref(uint16_t index)
+{
+    if (atomic_fetch_sub_explicit(&pool[index].refs, 1, memory_order_acq_rel) == 1) {
+        midi_mpmc_enqueue(&free_queue, index);   // nunca falha: capacidade = pool
+    }
+}
+
+void midi_tx_router_init(void)
+{
+    midi_mpmc_init(&free_queue, free_cells, ROUTER_POOL_SIZE);
+    for (uint16_t i = 0; i < ROUTER_POOL_SIZE; i++) {
+        atomic_store_explicit(&pool[i].refs, 0, memory_order_relaxed);
+        midi_mpmc_enqueue(&free_queue, i);
+    }
+    for (int out = 0; out < MIDI_OUT_COUNT; out++) {
+        midi_mpmc_init(&output_queues[out], output_cells[out], ROUTER_QUEUE_LEN);
+    }
+    ESP_LOGI(TAG, "Router ready: %d outputs, %d shared messages, queue %d per output",
+             MIDI_OUT_COUNT, ROUTER_POOL_SIZE, ROUTER_QUEUE_LEN);
+}
+
+void midi_tx_router_register_output(midi_output_t out, const midi_output_ops_t *ops)
+{
+    if (out >= MIDI_OUT_COUNT || ops == NULL) {
+        return;
+    }
+    outputs[out].ops = *ops;
+    atomic_store(&outputs[out].registered, true);
+}
+
+uint32_t midi_tx_router_usb_mask(void)
+{
+    return (current_usb_mode == USB_MODE_DEVICE) ? MIDI_OUT_MASK(MIDI_OUT_DEVICE)
+                                                 : MIDI_OUT_MASK(MIDI_OUT_HOST);
+}
+
 bool midi_tx_router_send(const uint8_t *data, size_t length)
+{
+    return midi_tx_router_send_from(data, length, MIDI_ORIGIN_NONE);
+}
+
+bool midi_tx_router_send_from(const uint8_t *data, size_t length, int64_t origin_us)
+{
+    return midi_tx_router_send_to(midi_tx_router_usb_mask(), data, length, origin_us);
+}
+
+bool midi_tx_router_send_to(uint32_t mask, const uint8_t *data, size_t length, int64_t origin_us)
 {
     if (!data || length == 0) {
         ESP_LOGW(TAG, "Ignored empty MIDI message");
         return false;
     }
 
-    // -----------------------------------------------------
-    // HOST MODE
-    // -----------------------------------------------------
-    if (current_usb_mode == USB_MODE_HOST)
-    {
-        if (!midi_driver_ready_for_tx()) {
-            ESP_LOGW(TAG, "HOST: USB Host MIDI driver not ready");
-            return false;
+    midi_latency_record(MIDI_LAT_ROUTER, origin_us);
+
+    // Só as saídas registradas e prontas recebem a mensagem
+    uint32_t targets = 0;
+    for (int out = 0; out < MIDI_OUT_COUNT; out++) {
+        if (!(mask & MIDI_OUT_MASK(out))) {
+            continue;
+        }
+        router_output_t *o = &outputs[out];
+        if (!atomic_load(&o->registered) || (o->ops.ready != NULL && !o->ops.ready())) {
+            atomic_fetch_add_explicit(&o->dropped_not_ready, 1, memory_order_relaxed);
+            continue;
+        }
+        targets |= MIDI_OUT_MASK(out);
+    }
+    if (targets == 0) {
+        MIDI_TRACE(MIDI_TRACE_ROUTER_DROP, mask, data, length);
+        return false;
+    }
+
+    uint16_t index;
+    if (!midi_mpmc_dequeue(&free_queue, &index)) {
+        atomic_fetch_add_explicit(&pool_exhausted, 1, memory_order_relaxed);
+        MIDI_TRACE(MIDI_TRACE_ROUTER_DROP, targets, data, length);
+        return false;
+    }
+
+    // Uma única cópia, referenciada por todas as filas de destino
+    router_slot_t *slot = &pool[index];
+    memset(slot->msg.packet, 0, sizeof(slot->msg.packet));
+    memcpy(slot->msg.packet, data, length < sizeof(slot->msg.packet) ? length : sizeof(slot->msg.packet));
+    slot->msg.origin_us = origin_us;
+    atomic_store_explicit(&slot->refs, (unsigned)__builtin_popcount(targets), memory_order_release);
+
+    bool accepted = false;
+    for (int out = 0; out < MIDI_OUT_COUNT; out++) {
+        if (!(targets & MIDI_OUT_MASK(out))) {
+            continue;
+        }
+        router_output_t *o = &outputs[out];
+        if (midi_mpmc_enqueue(&output_queues[out], index)) {
+            atomic_fetch_add_explicit(&o->enqueued, 1, memory_order_relaxed);
+            MIDI_TRACE(output_trace_id[out], 1, data, length);
+            accepted = true;
+            if (o->ops.wake != NULL) {
+                o->ops.wake();
+            }
+        } else {
+            atomic_fetch_add_explicit(&o->dropped_full, 1, memory_order_relaxed);
+            MIDI_TRACE(MIDI_TRACE_ROUTER_DROP, MIDI_OUT_MASK(out), data, length);
+            slot_unref(index);
         }
+    }
 
-        bool ok = midi_send_data(data, length);
+    MIDI_HOT_LOGI(TAG, "SEND -> 0x%02lX = %s | %02X %02X %02X",
+                  (unsigned long)targets, accepted ? "OK" : "FAIL",
+                  data[0],
+                  (length > 1 ? data[1] : 0),
+                  (length > 2 ? data[2] : 0));
 
-        ESP_LOGI(TAG, "HOST SEND = %s | %02X %02X %02X",
-                 ok ? "OK" : "FAIL",
-                 data[0],
-                 (length > 1 ? data[1] : 0),
-                 (length > 2 ? data[2] : 0));
+    return accepted;
+}
 
-        return ok;
+midi_router_msg_t *midi_tx_router_pop(midi_output_t out)
+{
+    uint16_t index;
+    if (out >= MIDI_OUT_COUNT || !midi_mpmc_dequeue(&output_queues[out], &index)) {
+        return NULL;
     }
+    return &pool[index].msg;
+}
 
-    // -----------------------------------------------------
-    // DEVICE MODE
-    // -----------------------------------------------------
-    else if (current_usb_mode == USB_MODE_DEVICE)
-    {
-        bool ok = midi_device_send(data, length);
+bool midi_tx_router_pending(midi_output_t out)
+{
+    if (out >= MIDI_OUT_COUNT) {
+        return false;
+    }
+    return midi_mpmc_size(&output_queues[out]) != 0;
+}
 
-        ESP_LOGI(TAG, "DEVICE SEND = %s | %02X %02X %02X",
-                 ok ? "OK" : "FAIL",
-                 data[0],
-                 (length > 1 ? data[1] : 0),
-                 (length > 2 ? data[2] : 0));
+void midi_tx_router_release(midi_router_msg_t *msg)
+{
+    if (msg == NULL) {
+        return;
+    }
+    router_slot_t *slot = (router_slot_t *)((uint8_t *)msg - offsetof(router_slot_t, msg));
+    slot_unref((uint16_t)(slot - pool));
+}
 
-        return ok;
+void midi_tx_router_flush(midi_output_t out)
+{
+    midi_router_msg_t *msg;
+    while ((msg = midi_tx_router_pop(out)) != NULL) {
+        midi_tx_router_release(msg);
     }
+}
 
-    // -----------------------------------------------------
-    // INVALID MODE
-    // -----------------------------------------------------
-    ESP_LOGE(TAG, "Invalid USB mode: %d", current_usb_mode);
-    return false;
+void midi_tx_router_get_stats(midi_output_t out, midi_output_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (out >= MIDI_OUT_COUNT) {
+        return;
+    }
+    router_output_t *o = &outputs[out];
+    stats->enqueued = atomic_load(&o->enqueued);
+    stats->dropped_full = atomic_load(&o->dropped_full);
+    stats->dropped_not_ready = atomic_load(&o->dropped_not_ready);
+    stats->pending = midi_mpmc_size(&output_queues[out]);
 }
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include "midi_ports.h"   // saídas do router (HOST, DEVICE, DIN) e MIDI_OUT_MASK
+#include "midi_latency.h" // MIDI_ORIGIN_NONE
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,9 +20,63 @@ typedef enum {
 // Definida em main.c
 extern usb_operation_mode_t current_usb_mode;
 
-// Função única para enviar MIDI em HOST ou DEVICE
+// Mensagem compartilhada entre as saídas (sem cópia por destino).
+// Só leitura para os consumidores; devolvida com midi_tx_router_release().
+typedef struct {
+    uint8_t packet[4];          // evento USB-MIDI
+    int64_t origin_us;          // origem para midi_latency
+} midi_router_msg_t;
+
+// Callbacks de uma saída, registrados pelo dono dela
+typedef struct {
+    bool (*ready)(void);        // saída pode receber agora? NULL = sempre
+    void (*wake)(void);         // acorda o consumidor após enfileirar
+} midi_output_ops_t;
+
+typedef struct {
+    uint32_t enqueued;
+    uint32_t dropped_full;      // fila da saída cheia
+    uint32_t dropped_not_ready; // saída não pronta (ex.: dispositivo desconectado)
+    uint32_t pending;           // mensagens aguardando agora
+} midi_output_stats_t;
+
+// Chamar uma vez no boot, antes de qualquer envio
+void midi_tx_router_init(void);
+
+void midi_tx_router_register_output(midi_output_t out, const midi_output_ops_t *ops);
+
+// Saída USB ativa no modo atual (HOST ou DEVICE)
+uint32_t midi_tx_router_usb_mask(void);
+
+// Função única para enviar MIDI: vai para a saída USB do modo atual.
+// Sem instante de origem: não entra no histograma de latência.
 bool midi_tx_router_send(const uint8_t *data, size_t length);
 
+// Igual, com o instante de origem da mensagem (borda do footswitch, em
+// esp_timer_get_time) para o histograma de latência fim a fim, ou
+// MIDI_ORIGIN_NONE para mensagens que não devem ser medidas
+bool midi_tx_router_send_from(const uint8_t *data, size_t length, int64_t origin_us);
+
+// Envia para várias saídas (máscara MIDI_OUT_MASK). A mensagem é gravada uma
+// vez e referenciada por cada fila. Retorna true se ao menos uma saída aceitou.
+bool midi_tx_router_send_to(uint32_t outputs, const uint8_t *data, size_t length, int64_t origin_us);
+
+// ===== Lado do consumidor (só a tarefa dona da saída) =====
+
+// Próxima mensagem da saída, ou NULL se vazia
+midi_router_msg_t *midi_tx_router_pop(midi_output_t out);
+
+// Há mensagens esperando na saída?
+bool midi_tx_router_pending(midi_output_t out);
+
+// Devolve a referência desta saída à mensagem
+void midi_tx_router_release(midi_router_msg_t *msg);
+
+// Descarta tudo que está na fila da saída
+void midi_tx_router_flush(midi_output_t out);
+
+void midi_tx_router_get_stats(midi_output_t out, midi_output_stats_t *stats);
+
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
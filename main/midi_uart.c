@@ -1,23 +1,35 @@
 /*
  * MIDI UART helper library
  * Provides UART init, send (used by USB->UART forwarding), and a parser helper
- * to convert UART raw stream into USB MIDI 4-byte packets and forward them via midi_send_data().
+ * to convert UART raw stream into USB MIDI 4-byte packets and forward them via midi_route_send().
  *
  * Implements a queue-based low-latency forwarder for USB->UART:
  *  - driver enqueues received USB packets (non-blocking)
- *  - high-priority task drains the queue and writes to UART immediately
+ *  - high-priority task drains the queue, decodes the USB-MIDI event packets
+ *    into MIDI 1.0 bytes (running status, real-time first) and writes to UART
+ *
+ * And an event-driven UART->USB receiver:
+ *  - RX timeout is one byte time, so the UART ISR reports data as soon as the
+ *    line goes idle instead of waiting for the FIFO to fill
+ *  - RX task parses bytes and sends them through midi_tx_router (HOST or DEVICE)
  */
 
 #include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "driver/uart.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "midi_uart.h"
-#include "midi_class_driver_txrx.h" // for midi_send_data and midi_driver_ready_for_tx
+#include "midi_codec.h"
+#include "midi_tx_router.h" // the router's DIN output
+#include "midi_route.h"     // DIN IN -> routing rules
+#include "board_hal.h"      // UART reads/writes
+#include "midi_monitor.h"   // activity counters for the OLED monitor
 
 static const char *TAG = "MIDI_UART";
 
@@ -26,12 +38,48 @@ static const char *TAG = "MIDI_UART";
 #define UART_BAUD_RATE         31250
 #define UART_RX_PIN            4      // GPIO4 - MIDI IN (top)
 #define UART_TX_PIN            5      // GPIO5 - MIDI OUT (top)
-#define UART_BUFFER_SIZE       2048
+#define UART_BUFFER_SIZE       2048   // RX ring
+#define UART_TX_BUFFER_SIZE    256    // TX ring drained by the UART ISR (~80 ms of wire time; must exceed the 128-byte FIFO)
+#define UART_TX_WAIT_TICKS     1      // poll period while the TX ring is full
+#define UART_EVENT_QUEUE_LEN   20
+#define UART_RX_TIMEOUT_SYMS   1      // RX timeout interrupt after ~1 byte time (320 us) of idle line
+#define UART_RX_FULL_THRESH    3      // also interrupt every 3 bytes during a continuous stream
+#define UART_RX_READ_CHUNK     128
+
+// DIN throughput test at boot: feeds a dense CC stream through the USB->UART
+// path and reports line utilisation. Disabled by default.
+#define MIDI_UART_THROUGHPUT_TEST_ON_BOOT   0
+#define MIDI_UART_THROUGHPUT_TEST_MS        5000
+#define UART_BITS_PER_BYTE     10     // start + 8 data + stop
+
+static QueueHandle_t uart_event_queue = NULL;
+
+// USB->UART ring: single-producer/single-consumer ring of USB-MIDI event
+// packets (4 bytes each, so no per-item length header is needed).
+// Producer: the USB RX path of the active mode (class driver RX callback in
+// HOST mode, TinyUSB rx callback in DEVICE mode; only one exists per boot).
+// Consumer: usb_to_uart_q task. Indices run freely and are masked on access.
+#define USB_UART_RING_SIZE    4096    // bytes, power of two, multiple of 4
+#define USB_UART_RING_MASK    (USB_UART_RING_SIZE - 1)
+#define USB_UART_PACKET_SIZE  4
+#define USB_UART_DRAIN_MAX    256     // bytes of packets encoded per UART write
+#define USB_UART_DIN_MAX      ((USB_UART_DRAIN_MAX / USB_UART_PACKET_SIZE) * 3) // 3 MIDI bytes per packet at most
+
+_Static_assert((USB_UART_RING_SIZE & USB_UART_RING_MASK) == 0, "USB_UART_RING_SIZE must be a power of two");
+
+static uint8_t usb_uart_ring[USB_UART_RING_SIZE] __attribute__((aligned(4)));
+static atomic_uint usb_uart_head = 0;      // written by the producer
+static atomic_uint usb_uart_tail = 0;      // written by the consumer
+static atomic_uint usb_uart_high_water = 0;
+static atomic_uint usb_uart_dropped = 0;   // bytes dropped because the ring was full
+static atomic_uint din_tx_bytes = 0;       // bytes handed to the UART TX ring
+static TaskHandle_t usb_uart_task_handle = NULL;
 
-// USB->UART queue: each item holds up to 256 bytes of raw USB MIDI stream (+2 length bytes)
-static QueueHandle_t usb_uart_queue = NULL;
-#define USB_UART_QUEUE_LEN    256
-#define USB_UART_ITEM_SIZE    260 // 2 bytes length + up to 258 payload
+// Running status of the DIN OUT line, owned by usb_to_uart_q task (the only
+// writer of the port)
+static midi_din_encoder_t din_encoder;
+// DIN IN -> USB parser, owned by the uart_rx task
+static midi_stream_parser_t din_parser;
 
 void midi_uart_init(void)
 {
@@ -44,181 +92,325 @@ void midi_uart_init(void)
         .source_clk = UART_SCLK_DEFAULT,
     };
     
-    // Instalar driver UART
-    ESP_ERROR_CHECK(uart_driver_install(UART_NUM, UART_BUFFER_SIZE, UART_BUFFER_SIZE, 10, NULL, 0));
+    // Instalar driver UART (com fila de eventos para a tarefa de RX)
+    ESP_ERROR_CHECK(uart_driver_install(UART_NUM, UART_BUFFER_SIZE, UART_TX_BUFFER_SIZE, UART_EVENT_QUEUE_LEN, &uart_event_queue, 0));
     ESP_ERROR_CHECK(uart_param_config(UART_NUM, &uart_config));
     ESP_ERROR_CHECK(uart_set_pin(UART_NUM, UART_TX_PIN, UART_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+
+    // Low-latency RX: report bytes after one idle byte time or every few bytes
+    ESP_ERROR_CHECK(uart_set_rx_timeout(UART_NUM, UART_RX_TIMEOUT_SYMS));
+    ESP_ERROR_CHECK(uart_set_rx_full_threshold(UART_NUM, UART_RX_FULL_THRESH));
     
     ESP_LOGI(TAG, "UART MIDI initialized (baud=%d, RX=GPIO%d, TX=GPIO%d)", UART_BAUD_RATE, UART_RX_PIN, UART_TX_PIN);
 }
 
-// This function is intended to be called by the USB driver (via queue or fallback).
-void midi_uart_send_to_uart(const uint8_t *data, size_t length)
+static void uart_packet_to_router(const uint8_t packet[4], void *ctx)
 {
-    if (data == NULL || length == 0) {
-        ESP_LOGE(TAG, "midi_uart_send_to_uart: invalid args");
-        return;
-    }
-
-    // Send directly to UART
-    int written = uart_write_bytes(UART_NUM, (const char*)data, length);
-    if (written != (int)length) {
-        ESP_LOGW(TAG, "Direct UART write mismatch: expected %d wrote %d", (int)length, written);
-    }
-    // ensure TX finishes quickly
-    uart_wait_tx_done(UART_NUM, pdMS_TO_TICKS(20));
+    (void)ctx;
+    midi_monitor_record(MIDI_MON_DIN_IN, packet);
+    midi_route_send(MIDI_IN_DIN, packet, 4, MIDI_ORIGIN_NONE);
 }
 
-/*
- * Parse UART raw buffer and convert to USB MIDI packets (4 bytes each),
- * then call midi_send_data() for each packet.
- *
- * This helper implements a simple parser that assumes status bytes are present.
- */
+// Parse a chunk of MIDI 1.0 bytes from the DIN input and route the resulting
+// USB-MIDI packets. Parser state persists between chunks, so messages split
+// across reads, running status, SysEx and interleaved real-time are handled.
+// Only called from the uart_rx task.
 void midi_uart_parse_and_send_to_usb(const uint8_t *data, size_t length)
 {
     if (data == NULL || length == 0) return;
 
-    int pos = 0;
-    while (pos < (int)length) {
-        uint8_t status_byte = data[pos];
-        
-        if (status_byte >= 0x80) {
-            uint8_t message_type = status_byte & 0xF0;
-            uint8_t cable_number = 0; // Cable 0 for standard MIDI
-            uint8_t cin = 0;
-            uint8_t usb_packet[4] = {0};
-            
-            switch (message_type) {
-                case 0x80: // Note Off
-                case 0x90: // Note On
-                case 0xA0: // Polyphonic Key Pressure
-                case 0xB0: // Control Change
-                case 0xE0: // Pitch Bend
-                    cin = message_type >> 4;
-                    if (pos + 2 < (int)length) {
-                        usb_packet[0] = (cable_number << 4) | cin;
-                        usb_packet[1] = data[pos];
-                        usb_packet[2] = data[pos + 1];
-                        usb_packet[3] = data[pos + 2];
-                        
-                        if (midi_driver_ready_for_tx()) {
-                            midi_send_data(usb_packet, 4);
-                        }
-                        pos += 3;
-                    } else {
-                        pos = length;
-                    }
-                    break;
-                    
-                case 0xC0: // Program Change (2 bytes)
-                case 0xD0: // Channel Pressure (2 bytes)
-                    cin = message_type >> 4;
-                    if (pos + 1 < (int)length) {
-                        usb_packet[0] = (cable_number << 4) | cin;
-                        usb_packet[1] = data[pos];
-                        usb_packet[2] = data[pos + 1];
-                        usb_packet[3] = 0x00;
-                        
-                        if (midi_driver_ready_for_tx()) {
-                            midi_send_data(usb_packet, 4);
-                        }
-                        pos += 2;
-                    } else {
-                        pos = length;
-                    }
-                    break;
-                    
-                case 0xF0: // System Messages
-                    if (status_byte == 0xF0) { // SysEx Start
-                        usb_packet[0] = (cable_number << 4) | 0x04; // SysEx starts/continues
-                        usb_packet[1] = data[pos];
-                        usb_packet[2] = 0x00;
-                        usb_packet[3] = 0x00;
-                        if (midi_driver_ready_for_tx()) {
-                            midi_send_data(usb_packet, 4);
-                        }
-                        pos++;
-                    } else {
-                        usb_packet[0] = (cable_number << 4) | 0x05;
-                        usb_packet[1] = data[pos];
-                        usb_packet[2] = 0x00;
-                        usb_packet[3] = 0x00;
-                        if (midi_driver_ready_for_tx()) {
-                            midi_send_data(usb_packet, 4);
-                        }
-                        pos++;
+    midi_stream_parser_feed(&din_parser, data, length, uart_packet_to_router, NULL);
+}
+
+// UART RX task: waits on the UART driver event queue and forwards every chunk
+// to USB as soon as the RX-timeout / RX-full interrupt reports it.
+static void midi_uart_rx_task(void *arg)
+{
+    uint8_t buffer[UART_RX_READ_CHUNK];
+    uart_event_t event;
+
+    midi_stream_parser_init(&din_parser, 0);
+
+    while (1) {
+        if (xQueueReceive(uart_event_queue, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        switch (event.type) {
+            case UART_DATA: {
+                size_t remaining = event.size;
+                while (remaining > 0) {
+                    size_t chunk = remaining > sizeof(buffer) ? sizeof(buffer) : remaining;
+                    int len = board_hal_uart_read(UART_NUM, buffer, chunk, 0);
+                    if (len <= 0) {
+                        break;
                     }
-                    break;
-                    
-                default:
-                    pos++; // unknown, skip
-                    break;
+                    midi_uart_parse_and_send_to_usb(buffer, (size_t)len);
+                    remaining -= (size_t)len;
+                }
+                break;
             }
-        } else {
-            pos++;
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                ESP_LOGW(TAG, "UART RX overflow (event %d), flushing input", event.type);
+                uart_flush_input(UART_NUM);
+                xQueueReset(uart_event_queue);
+                midi_stream_parser_init(&din_parser, 0);   // partial message was lost
+                break;
+            case UART_FRAME_ERR:
+            case UART_PARITY_ERR:
+                ESP_LOGW(TAG, "UART RX line error (event %d)", event.type);
+                break;
+            default:
+                break;
         }
     }
 }
 
-// Internal task that drains usb_uart_queue and writes to UART with minimal latency.
+// Start the UART->USB receive task. midi_uart_init() must have been called.
+void midi_uart_start_rx_task(UBaseType_t priority, uint32_t stack_size, BaseType_t core)
+{
+    if (uart_event_queue == NULL) {
+        ESP_LOGE(TAG, "UART driver not installed, cannot start RX task");
+        return;
+    }
+    BaseType_t ok = xTaskCreatePinnedToCore(midi_uart_rx_task, "uart_rx", stack_size, NULL, priority, NULL, core);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create uart_rx task");
+    } else {
+        ESP_LOGI(TAG, "uart_rx task started (priority=%d, core=%d)", (int)priority, (int)core);
+    }
+}
+
+// Contiguous free space at the producer index, in bytes (multiple of 4)
+uint8_t *midi_uart_usb_reserve(size_t *available)
+{
+    unsigned head = atomic_load_explicit(&usb_uart_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&usb_uart_tail, memory_order_acquire);
+    size_t free_bytes = USB_UART_RING_SIZE - (head - tail);
+    size_t to_end = USB_UART_RING_SIZE - (head & USB_UART_RING_MASK);
+
+    *available = free_bytes < to_end ? free_bytes : to_end;
+    return &usb_uart_ring[head & USB_UART_RING_MASK];
+}
+
+// Publish length bytes written into the region from midi_uart_usb_reserve()
+// and wake the forwarding task.
+void midi_uart_usb_commit(size_t length)
+{
+    if (length == 0) return;
+
+    unsigned head = atomic_load_explicit(&usb_uart_head, memory_order_relaxed) + (unsigned)length;
+    atomic_store_explicit(&usb_uart_head, head, memory_order_release);
+
+    unsigned used = head - atomic_load_explicit(&usb_uart_tail, memory_order_relaxed);
+    if (used > atomic_load_explicit(&usb_uart_high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&usb_uart_high_water, used, memory_order_relaxed);
+    }
+
+    if (usb_uart_task_handle != NULL) {
+        xTaskNotifyGive(usb_uart_task_handle);
+    }
+}
+
+// Internal task that owns DIN OUT: drains the router's DIN output and the
+// USB->UART ring, and writes to UART with minimal latency.
 static void midi_uart_usb_to_uart_task(void *arg)
 {
-    uint8_t item[USB_UART_ITEM_SIZE];
+    uint8_t din[USB_UART_DIN_MAX];
+
+    midi_din_encoder_reset(&din_encoder);
+
     while (1) {
-        if (usb_uart_queue == NULL) {
-            vTaskDelay(pdMS_TO_TICKS(10));
+        bool consumed = false;
+        size_t din_len = 0;
+
+        // Encode only what the TX ring can take right now: the backlog stays
+        // in the packet ring and the router queue, where real-time hoisting
+        // and the router-first order still apply to the next batch
+        size_t tx_free = 0;
+        uart_get_tx_buffer_free_size(UART_NUM, &tx_free);
+        if (tx_free < 3) {
+            uart_wait_tx_done(UART_NUM, UART_TX_WAIT_TICKS);
             continue;
         }
-        if (xQueueReceive(usb_uart_queue, item, portMAX_DELAY) == pdTRUE) {
-            uint16_t len = (uint16_t)((item[0] << 8) | item[1]);
-            if (len > 0 && len <= (USB_UART_ITEM_SIZE - 2)) {
-                // Send directly to UART
-                int written = uart_write_bytes(UART_NUM, (const char*)(item + 2), len);
-                if (written != (int)len) {
-                    ESP_LOGW(TAG, "usb_to_uart task: wrote %d/%d bytes", written, (int)len);
-                }
-                // Wait briefly for TX to complete to maintain timing
-                uart_wait_tx_done(UART_NUM, pdMS_TO_TICKS(20));
+        size_t din_max = tx_free < sizeof(din) ? tx_free : sizeof(din);
+
+        // Router DIN output (footswitch commands and other routed messages)
+        midi_router_msg_t *msg;
+        while (din_len + 3 <= din_max && (msg = midi_tx_router_pop(MIDI_OUT_DIN)) != NULL) {
+            midi_monitor_record(MIDI_MON_DIN_OUT, msg->packet);
+            din_len += midi_din_encode_packet(&din_encoder, msg->packet, &din[din_len]);
+            midi_tx_router_release(msg);
+            consumed = true;
+        }
+
+        // USB->UART ring: encode straight out of it, one contiguous run at a time
+        unsigned tail = atomic_load_explicit(&usb_uart_tail, memory_order_relaxed);
+        unsigned head = atomic_load_explicit(&usb_uart_head, memory_order_acquire);
+        size_t room_packets = (din_max - din_len) / 3;
+        if (head != tail && room_packets > 0) {
+            size_t pending = head - tail;
+            size_t to_end = USB_UART_RING_SIZE - (tail & USB_UART_RING_MASK);
+            size_t len = pending < to_end ? pending : to_end;
+            if (len > room_packets * USB_UART_PACKET_SIZE) {
+                len = room_packets * USB_UART_PACKET_SIZE;
             }
+
+            // USB-MIDI event packets -> MIDI 1.0 byte stream
+            midi_monitor_record_packets(MIDI_MON_DIN_OUT, &usb_uart_ring[tail & USB_UART_RING_MASK], len);
+            din_len += midi_din_encode_packets(&din_encoder, &usb_uart_ring[tail & USB_UART_RING_MASK], len,
+                                               &din[din_len], din_max - din_len);
+            atomic_store_explicit(&usb_uart_tail, tail + (unsigned)len, memory_order_release);
+            consumed = true;
+        }
+
+        if (!consumed) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if (din_len == 0) {
+            continue;
+        }
+
+        // Fits in the TX ring, so this returns at once and the next batch is
+        // encoded while the ISR keeps the line busy
+        int written = board_hal_uart_write(UART_NUM, din, din_len);
+        if (written != (int)din_len) {
+            ESP_LOGW(TAG, "usb_to_uart task: wrote %d/%d bytes", written, (int)din_len);
+            midi_din_encoder_reset(&din_encoder);
+        }
+        if (written > 0) {
+            atomic_fetch_add_explicit(&din_tx_bytes, (unsigned)written, memory_order_relaxed);
         }
     }
 }
 
-// Non-blocking try to enqueue USB data for forwarding.
-// Returns true on success, false on failure (e.g., queue full or not initialized).
+static void din_output_wake(void)
+{
+    TaskHandle_t task = usb_uart_task_handle;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+// Non-blocking enqueue of USB-MIDI packets for forwarding (copying variant of
+// reserve/commit, for callers that already hold the packets in a buffer).
+// All-or-nothing: returns false if the ring cannot take the whole buffer.
 bool midi_uart_try_enqueue_usb(const uint8_t *data, size_t length)
 {
-    if (data == NULL || length == 0 || usb_uart_queue == NULL) return false;
-    if (length > USB_UART_ITEM_SIZE - 2) {
-        // too big to queue
+    if (data == NULL || length == 0 || usb_uart_task_handle == NULL) return false;
+
+    length &= ~(size_t)(USB_UART_PACKET_SIZE - 1);   // whole packets only
+    unsigned head = atomic_load_explicit(&usb_uart_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&usb_uart_tail, memory_order_acquire);
+    if (length > USB_UART_RING_SIZE - (head - tail)) {
+        atomic_fetch_add_explicit(&usb_uart_dropped, (unsigned)length, memory_order_relaxed);
         return false;
     }
-    uint8_t item[USB_UART_ITEM_SIZE];
-    item[0] = (uint8_t)((length >> 8) & 0xFF);
-    item[1] = (uint8_t)(length & 0xFF);
-    memcpy(item + 2, data, length);
-    BaseType_t res = xQueueSend(usb_uart_queue, item, 0); // non-blocking
-    return (res == pdTRUE);
+
+    size_t first = USB_UART_RING_SIZE - (head & USB_UART_RING_MASK);
+    if (first > length) {
+        first = length;
+    }
+    memcpy(&usb_uart_ring[head & USB_UART_RING_MASK], data, first);
+    memcpy(usb_uart_ring, data + first, length - first);
+    midi_uart_usb_commit(length);
+    return true;
 }
 
-// Start the usb_to_uart task and create the queue.
+void midi_uart_get_usb_ring_stats(midi_uart_ring_stats_t *stats)
+{
+    unsigned head = atomic_load(&usb_uart_head);
+    unsigned tail = atomic_load(&usb_uart_tail);
+
+    stats->size = USB_UART_RING_SIZE;
+    stats->used = head - tail;
+    stats->high_water = atomic_load(&usb_uart_high_water);
+    stats->dropped = atomic_load(&usb_uart_dropped);
+    stats->din_bytes = atomic_load(&din_tx_bytes);
+}
+
+// Sustained-throughput test: keeps the USB->UART ring topped up with Control
+// Change events (as a Blackbox sweeping a knob would) and measures how busy
+// the 31250 baud line stays. Acts as the ring producer while it runs, so call
+// it only with no USB MIDI input active.
+void midi_uart_din_throughput_test(uint32_t duration_ms)
+{
+    uint8_t packets[16 * USB_UART_PACKET_SIZE];
+    uint8_t value = 0;
+    uint32_t messages = 0;
+    uint32_t ring_full = 0;
+
+    uart_wait_tx_done(UART_NUM, portMAX_DELAY);   // start from an idle line
+    unsigned bytes_start = atomic_load(&din_tx_bytes);
+    int64_t start_us = esp_timer_get_time();
+    int64_t end_us = start_us + (int64_t)duration_ms * 1000;
+
+    while (esp_timer_get_time() < end_us) {
+        for (int i = 0; i < 16; i++) {
+            uint8_t *p = &packets[i * USB_UART_PACKET_SIZE];
+            p[0] = 0x0B;                // cable 0, CIN Control Change
+            p[1] = 0xB0;
+            p[2] = 0x01;                // Modulation
+            p[3] = value++ & 0x7F;
+        }
+        if (midi_uart_try_enqueue_usb(packets, sizeof(packets))) {
+            messages += 16;
+        } else {
+            ring_full++;
+            vTaskDelay(1);
+        }
+    }
+
+    // Let the ring and the TX FIFO drain so every counted byte is on the wire
+    while (atomic_load(&usb_uart_head) != atomic_load(&usb_uart_tail)) {
+        vTaskDelay(1);
+    }
+    uart_wait_tx_done(UART_NUM, portMAX_DELAY);
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    unsigned bytes = atomic_load(&din_tx_bytes) - bytes_start;
+
+    uint32_t line_bytes_per_s = (uint32_t)((int64_t)bytes * 1000000 / elapsed_us);
+    uint32_t utilisation_x10 = (uint32_t)((int64_t)bytes * UART_BITS_PER_BYTE * 10000000 /
+                                          ((int64_t)UART_BAUD_RATE * elapsed_us));
+
+    ESP_LOGI(TAG, "DIN throughput: %lu CC messages, %u bytes in %lld ms", messages, bytes, elapsed_us / 1000);
+    ESP_LOGI(TAG, "DIN throughput: %lu bytes/s of %d max, line busy %lu.%lu%%, producer waited %lu times",
+             line_bytes_per_s, UART_BAUD_RATE / UART_BITS_PER_BYTE,
+             utilisation_x10 / 10, utilisation_x10 % 10, ring_full);
+}
+
+#if MIDI_UART_THROUGHPUT_TEST_ON_BOOT
+static void midi_uart_throughput_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    midi_uart_din_throughput_test(MIDI_UART_THROUGHPUT_TEST_MS);
+    vTaskDelete(NULL);
+}
+#endif
+
+// Start the usb_to_uart task that drains the USB->UART ring.
 // priority: FreeRTOS priority for the task
 // stack_size: stack size in bytes
 // core: core id to pin the task (use 0 or 1)
 void midi_uart_start_usb_to_uart_task(UBaseType_t priority, uint32_t stack_size, BaseType_t core)
 {
-    if (usb_uart_queue == NULL) {
-        usb_uart_queue = xQueueCreate(USB_UART_QUEUE_LEN, USB_UART_ITEM_SIZE);
-        if (usb_uart_queue == NULL) {
-            ESP_LOGE(TAG, "Failed to create usb_uart_queue");
-            return;
-        }
-    }
-    BaseType_t ok = xTaskCreatePinnedToCore(midi_uart_usb_to_uart_task, "usb_to_uart_q", stack_size, NULL, priority, NULL, core);
+    BaseType_t ok = xTaskCreatePinnedToCore(midi_uart_usb_to_uart_task, "usb_to_uart_q", stack_size, NULL, priority,
+                                            &usb_uart_task_handle, core);
     if (ok != pdPASS) {
         ESP_LOGE(TAG, "Failed to create usb_to_uart_q task");
     } else {
         ESP_LOGI(TAG, "usb_to_uart_q task started (priority=%d, core=%d)", (int)priority, (int)core);
+
+        // This task is the consumer of the router's DIN output
+        static const midi_output_ops_t din_output_ops = {
+            .ready = NULL,
+            .wake = din_output_wake,
+        };
+        midi_tx_router_register_output(MIDI_OUT_DIN, &din_output_ops);
+#if MIDI_UART_THROUGHPUT_TEST_ON_BOOT
+        xTaskCreatePinnedToCore(midi_uart_throughput_task, "din_tput", 3072, NULL, 2, NULL, 1);
+#endif
     }
 }
@@ -2,6 +2,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "freertos/FreeRTOS.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -10,20 +11,41 @@ extern "C" {
 // Initialize UART for MIDI (configurable pins via defines or default)
 void midi_uart_init(void);
 
-// Send raw bytes to UART MIDI OUT
-void midi_uart_send_to_uart(const uint8_t *data, size_t length);
-
-// Parse raw UART buffer and forward to USB (uses midi_send_data internally)
+// Parse raw UART bytes (stateful: running status, SysEx, real-time) and forward
+// the USB-MIDI packets through midi_tx_router_send. Call from one task only.
 void midi_uart_parse_and_send_to_usb(const uint8_t *data, size_t length);
 
-// Try to enqueue raw USB MIDI packet bytes for low-latency forwarding to UART.
-// Non-blocking; returns true if queued, false if queue full or not initialized.
+// Try to enqueue USB-MIDI event packets (4 bytes each) for low-latency forwarding
+// to UART; they are decoded to MIDI 1.0 bytes before hitting the wire.
+// Non-blocking; returns true if queued, false if ring full or not initialized.
 bool midi_uart_try_enqueue_usb(const uint8_t *data, size_t length);
 
-// Start the internal USB->UART forwarding task which drains the queue and writes to UART.
+// Zero-copy enqueue for the (single) USB RX producer: write packets into the
+// returned region (*available bytes, contiguous) and publish them with commit.
+uint8_t *midi_uart_usb_reserve(size_t *available);
+void midi_uart_usb_commit(size_t length);
+
+typedef struct {
+    uint32_t size;         // ring capacity, bytes
+    uint32_t used;         // bytes waiting now
+    uint32_t high_water;   // max bytes ever waiting
+    uint32_t dropped;      // bytes dropped because the ring was full
+    uint32_t din_bytes;    // total bytes written to DIN OUT
+} midi_uart_ring_stats_t;
+
+void midi_uart_get_usb_ring_stats(midi_uart_ring_stats_t *stats);
+
+// Feed a dense CC stream through USB->UART for duration_ms and log the DIN
+// line utilisation. Only while no USB MIDI input is active.
+void midi_uart_din_throughput_test(uint32_t duration_ms);
+
+// Start the internal USB->UART forwarding task which drains the ring and writes to UART.
 // Call from main to create the task with appropriate priority.
 void midi_uart_start_usb_to_uart_task(UBaseType_t priority, uint32_t stack_size, BaseType_t core);
 
+// Start the UART->USB receive task (event-driven, RX timeout of ~1 byte time).
+void midi_uart_start_rx_task(UBaseType_t priority, uint32_t stack_size, BaseType_t core);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,10 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "power_management.h"
+#include "oled_display.h"
+#include "midi_latency.h"
+#include "midi_command.h"
+#include "board_hal.h"
 
 static const char *TAG = "NAV";
 
@@ -25,36 +29,50 @@ void init_navigation_buttons(void)
     ESP_LOGI(TAG, "Navigation buttons initialized");
 }
 
-void increment_nibble(uint8_t *byte, int nibble) {
-    if (nibble == 0) {
-        uint8_t high_nibble = (*byte >> 4) & 0x0F;
-        high_nibble = (high_nibble + 1) & 0x0F;
-        *byte = (high_nibble << 4) | (*byte & 0x0F);
-    } else {
-        uint8_t low_nibble = (*byte & 0x0F);
-        low_nibble = (low_nibble + 1) & 0x0F;
-        *byte = (*byte & 0xF0) | low_nibble;
+// O estado da navegação é compartilhado com os footswitches (cursor) e com
+// o power management (sai da edição no standby). Cada mudança é um
+// compare-and-swap sobre o snapshot mais novo; se outra tarefa mudou no meio,
+// refaz a conta em cima do estado novo.
+
+// Troca de modo se ainda estiver em `from`; *published recebe o estado publicado
+static bool switch_mode(menu_mode_t from, menu_mode_t to, ui_state_t *published)
+{
+    ui_state_t ui = ui_state_get();
+    while (ui.mode == from) {
+        ui_state_t next = ui;
+        next.mode = to;
+        if (ui_state_replace(&ui, next)) {
+            if (published) {
+                *published = next;
+            }
+            return true;
+        }
     }
+    return false;
 }
 
-void decrement_nibble(uint8_t *byte, int nibble) {
-    if (nibble == 0) {
-        uint8_t high_nibble = (*byte >> 4) & 0x0F;
-        high_nibble = (high_nibble - 1) & 0x0F;
-        *byte = (high_nibble << 4) | (*byte & 0x0F);
-    } else {
-        uint8_t low_nibble = (*byte & 0x0F);
-        low_nibble = (low_nibble - 1) & 0x0F;
-        *byte = (*byte & 0xF0) | low_nibble;
+// Move o cursor da lista (modo normal): step -1/+1, ou 0 para o primeiro botão
+static bool move_cursor(int step)
+{
+    ui_state_t ui = ui_state_get();
+    while (ui.mode == MODE_NORMAL) {
+        int button = step ? ui.button + step : 0;
+        if (button < 0 || button >= BUTTON_COUNT || button == ui.button) {
+            return false;
+        }
+        if (ui_state_replace(&ui, ui_state_select(ui, button))) {
+            return true;
+        }
     }
+    return false;
 }
 
 void handle_navigation(void)
 {
-    bool current_up = gpio_get_level(BTN_UP_GPIO);
-    bool current_down = gpio_get_level(BTN_DOWN_GPIO);
-    bool current_hash = gpio_get_level(BTN_HASH_GPIO);
-    bool current_star = gpio_get_level(BTN_STAR_GPIO);
+    bool current_up = board_hal_gpio_get_level(BTN_UP_GPIO);
+    bool current_down = board_hal_gpio_get_level(BTN_DOWN_GPIO);
+    bool current_hash = board_hal_gpio_get_level(BTN_HASH_GPIO);
+    bool current_star = board_hal_gpio_get_level(BTN_STAR_GPIO);
 
     if ((last_up_state && !current_up) ||
         (last_down_state && !current_down) ||
@@ -68,19 +86,23 @@ void handle_navigation(void)
 
     if (last_up_state && !current_up) {
         ESP_LOGI(TAG, "[ACTION] UP button pressed");
-        switch (current_mode) {
+        switch (ui_state_get().mode) {
             case MODE_NORMAL:
-                if (current_button > 0) {
-                    current_button--;
-                    if (current_button < scroll_offset) {
-                        scroll_offset = current_button;
-                    }
-                    update_display_partial();
+                if (move_cursor(-1)) {
+                    request_display_update();
                 }
                 break;
             case MODE_EDIT:
                 increment_nibble(&edit_command.data[edit_byte_index], edit_nibble_index);
-                update_display_partial();
+                request_display_update();
+                break;
+            case MODE_STATS:
+                break;
+            case MODE_MONITOR:
+                // Volta para a página de latência
+                if (switch_mode(MODE_MONITOR, MODE_STATS, NULL)) {
+                    request_display_update();
+                }
                 break;
         }
         vTaskDelay(pdMS_TO_TICKS(100));
@@ -88,19 +110,23 @@ void handle_navigation(void)
 
     if (last_down_state && !current_down) {
         ESP_LOGI(TAG, "[ACTION] DOWN button pressed");
-        switch (current_mode) {
+        switch (ui_state_get().mode) {
             case MODE_NORMAL:
-                if (current_button < BUTTON_COUNT - 1) {
-                    current_button++;
-                    if (current_button >= scroll_offset + VISIBLE_BUTTONS) {
-                        scroll_offset = current_button - VISIBLE_BUTTONS + 1;
-                    }
-                    update_display_partial();
+                if (move_cursor(1)) {
+                    request_display_update();
                 }
                 break;
             case MODE_EDIT:
                 decrement_nibble(&edit_command.data[edit_byte_index], edit_nibble_index);
-                update_display_partial();
+                request_display_update();
+                break;
+            case MODE_STATS:
+                // Próxima página: monitor de atividade MIDI
+                if (switch_mode(MODE_STATS, MODE_MONITOR, NULL)) {
+                    request_display_update();
+                }
+                break;
+            case MODE_MONITOR:
                 break;
         }
         vTaskDelay(pdMS_TO_TICKS(100));
@@ -108,15 +134,20 @@ void handle_navigation(void)
 
     if (last_star_state && !current_star) {
         ESP_LOGI(TAG, "[ACTION] STAR button pressed");
-        switch (current_mode) {
-            case MODE_NORMAL:
-                current_mode = MODE_EDIT;
-                edit_byte_index = 0;
-                edit_nibble_index = 0;
-                memcpy(edit_command.data, current_commands[current_button].data, sizeof(edit_command.data));
-                edit_initialized = false;
-                update_display_partial();
+        switch (ui_state_get().mode) {
+            case MODE_NORMAL: {
+                // O botão editado é o do snapshot publicado: no modo de edição
+                // os footswitches não movem mais o cursor
+                ui_state_t ui;
+                if (switch_mode(MODE_NORMAL, MODE_EDIT, &ui)) {
+                    edit_byte_index = 0;
+                    edit_nibble_index = 0;
+                    midi_command_read(&current_commands[ui.button], edit_command.data);
+                    edit_initialized = false;
+                    request_display_update();
+                }
                 break;
+            }
             case MODE_EDIT:
                 if (edit_nibble_index == 0) {
                     edit_nibble_index = 1;
@@ -124,7 +155,13 @@ void handle_navigation(void)
                     edit_nibble_index = 0;
                     edit_byte_index = (edit_byte_index + 1) % 4;
                 }
-                update_display_partial();
+                request_display_update();
+                break;
+            case MODE_STATS:
+                midi_latency_reset();
+                request_display_update();
+                break;
+            case MODE_MONITOR:
                 break;
         }
         vTaskDelay(pdMS_TO_TICKS(100));
@@ -132,35 +169,46 @@ void handle_navigation(void)
 
     if (last_hash_state && !current_hash) {
         ESP_LOGI(TAG, "[ACTION] HASH button pressed");
-        switch (current_mode) {
+        menu_mode_t mode = ui_state_get().mode;
+        switch (mode) {
             case MODE_NORMAL:
-                if (current_button != 0) {
-                    current_button = 0;
-                    scroll_offset = 0;
-                    update_display_partial();
+                if (move_cursor(0)) {
+                    request_display_update();
                     ESP_LOGI(TAG, "HASH: Returned to first button");
-                } else {
-                    ESP_LOGI(TAG, "HASH: Already at first button");
+                } else if (switch_mode(MODE_NORMAL, MODE_STATS, NULL)) {
+                    // Já no primeiro botão: abre a página de latência
+                    request_display_update();
+                    ESP_LOGI(TAG, "HASH: Latency stats page");
+                }
+                break;
+            case MODE_STATS:
+            case MODE_MONITOR:
+                if (switch_mode(mode, MODE_NORMAL, NULL)) {
+                    request_display_update();
                 }
                 break;
             case MODE_EDIT:
                 uint32_t press_start_time = xTaskGetTickCount();
-                while (!gpio_get_level(BTN_HASH_GPIO)) {
+                while (!board_hal_gpio_get_level(BTN_HASH_GPIO)) {
                     if ((xTaskGetTickCount() - press_start_time) > pdMS_TO_TICKS(1000)) {
-                        current_mode = MODE_NORMAL;
+                        switch_mode(MODE_EDIT, MODE_NORMAL, NULL);
                         edit_initialized = false;
-                        update_display_partial();
+                        request_display_update();
                         vTaskDelay(pdMS_TO_TICKS(300));
                         break;
                     }
                     vTaskDelay(pdMS_TO_TICKS(50));
                 }
-                if ((xTaskGetTickCount() - press_start_time) <= pdMS_TO_TICKS(1000)) {
-                    memcpy(current_commands[current_button].data, edit_command.data, sizeof(edit_command.data));
+                // Salva só se ainda estiver editando (o standby pode ter cancelado).
+                // O comando novo é publicado antes de voltar à lista, numa só
+                // escrita atômica; o botão não muda durante a edição.
+                ui_state_t ui = ui_state_get();
+                if ((xTaskGetTickCount() - press_start_time) <= pdMS_TO_TICKS(1000) && ui.mode == MODE_EDIT) {
+                    midi_command_publish(&current_commands[ui.button], edit_command.data);
                     save_midi_commands();
-                    current_mode = MODE_NORMAL;
+                    switch_mode(MODE_EDIT, MODE_NORMAL, NULL);
                     edit_initialized = false;
-                    update_display_partial();
+                    request_display_update();
                 }
                 break;
             default:
@@ -180,9 +228,16 @@ void navigation_button_task(void *arg)
     ESP_LOGI(TAG, "Navigation task started - FIXED VERSION");
 
     TickType_t xLastWakeTime = xTaskGetTickCount();
+    int stats_refresh = 0;
 
     while (1) {
         vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(50));
         handle_navigation();
+
+        // Página de latência: atualiza os valores a cada 500 ms
+        if (ui_state_get().mode == MODE_STATS && ++stats_refresh >= 10) {
+            stats_refresh = 0;
+            request_display_update();
+        }
     }
 }
@@ -1,11 +1,35 @@
 #include "oled_display.h"
+#include "oled_screens.h"
 #include "globals.h"
 #include "ssd1306.h"
+#include "midi_latency.h"
+#include "midi_monitor.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <string.h>
+#include <stdatomic.h>
 
 static const char *TAG = "OLED";
 
+// Intervalo mínimo entre dois quadros
+#define OLED_FRAME_US       (1000000 / CONFIG_OLED_MAX_FPS)
+
+// Task dona do SSD1306: único lugar que desenha e envia, depois de init_oled.
+// NULL até display_task iniciar
+static TaskHandle_t display_task_handle = NULL;
+
+// Pedidos pendentes (páginas + OLED_REQ_POWER), acumulados até o próximo quadro
+static atomic_uint pending_requests = 0;
+static atomic_uint request_count = 0;
+
+// Telas desenhadas no buffer de dev (oled_screens.c)
+static oled_screens_t screens = { .dev = &dev };
+
+// Tempo de cada redesenho (desenho no buffer + envio das páginas sujas)
+static oled_redraw_stats_t redraw_stats;
+
 void init_oled(void)
 {
     ESP_LOGI(TAG, "Initializing OLED with I2C NG Driver...");
@@ -20,103 +44,169 @@ void init_oled(void)
     display_initialized = true;
     ESP_LOGI(TAG, "OLED initialized successfully");
 
-    update_display_partial();
+    // Primeiro quadro completo quando display_task iniciar
+    atomic_fetch_or(&pending_requests, OLED_PAGES_ALL);
 }
 
-void update_display_partial(void)
+// Lê o que a tela atual mostra: um snapshot da navegação por quadro (modo,
+// cursor e rolagem sempre coerentes) e só os dados do modo atual
+static void read_screen_input(oled_screen_input_t *in)
 {
-    switch (current_mode) {
+    in->ui = ui_state_get();
+    in->display_on = display_on;
+    in->edit_initialized = &edit_initialized;
+    in->now_us = esp_timer_get_time();
+
+    switch (in->ui.mode) {
         case MODE_NORMAL:
-            ssd1306_display_text(&dev, 0, "BUTTON CONFIG   ", 16, false);
-            ssd1306_display_text(&dev, 1, "----------------", 16, false);
-
-            for (int i = 0; i < VISIBLE_BUTTONS; i++) {
-                int button_index = scroll_offset + i;
-                char button_line[18];
-                char *btn_ptr = button_line;
-
-                if (button_index < BUTTON_COUNT) {
-                    *btn_ptr++ = (button_index == current_button) ? '>' : ' ';
-                    *btn_ptr++ = 'B';
-                    int btn_num = button_index + 1;
-                    if (btn_num >= 10) {
-                        *btn_ptr++ = '1';
-                        *btn_ptr++ = '0' + (btn_num - 10);
-                    } else {
-                        *btn_ptr++ = '0' + btn_num;
-                    }
-                    *btn_ptr++ = ':';
-                    for (int j = 0; j < 4; j++) {
-                        uint8_t byte = current_commands[button_index].data[j];
-                        *btn_ptr++ = "0123456789ABCDEF"[byte >> 4];
-                        *btn_ptr++ = "0123456789ABCDEF"[byte & 0x0F];
-                    }
-                    *btn_ptr = '\0';
-
-                    ssd1306_display_text(&dev, 2 + i, button_line, strlen(button_line), false);
-                } else {
-                    ssd1306_display_text(&dev, 2 + i, "                ", 16, false);
-                }
+            for (int i = 0; i < BUTTON_COUNT; i++) {
+                midi_command_read(&current_commands[i], in->commands[i].data);
             }
-            ssd1306_display_text(&dev, 7, "*:Edit          ", 16, false);
             break;
-
         case MODE_EDIT:
-            if (!edit_initialized) {
-                char title[16] = "                ";
-                int btn_num = current_button + 1;
-
-                if (btn_num >= 10) {
-                    memcpy(title, "Edit BT 10     ", 16);
-                    title[8] = '1';
-                    title[9] = '0' + (btn_num - 10);
-                } else {
-                    memcpy(title, "Edit BT 1      ", 16);
-                    title[7] = ' ';
-                    title[8] = '0' + btn_num;
-                }
-                ssd1306_display_text(&dev, 0, title, strlen(title), false);
-                ssd1306_display_text(&dev, 1, "----------------", 16, false);
-
-                ssd1306_display_text(&dev, 5, "Up/Dn:Change    ", 16, false);
-                ssd1306_display_text(&dev, 6, "*:Next #:Save   ", 16, false);
-                ssd1306_display_text(&dev, 7, "Hold#:Cancel    ", 16, false);
-
-                edit_initialized = true;
-                ssd1306_display_text(&dev, 2, "                ", 16, false);
-                ssd1306_display_text(&dev, 3, "                ", 16, false);
-                ssd1306_display_text(&dev, 4, "                ", 16, false);
+            in->edit_command = edit_command;
+            in->edit_byte_index = edit_byte_index;
+            in->edit_nibble_index = edit_nibble_index;
+            break;
+        case MODE_STATS:
+            for (int stage = 0; stage < MIDI_LAT_STAGE_COUNT; stage++) {
+                midi_latency_get_summary((midi_latency_stage_t)stage, &in->latency[stage]);
             }
+            break;
+        case MODE_MONITOR:
+            // Sem travar o caminho MIDI
+            midi_monitor_snapshot(&in->monitor);
+            break;
+    }
+}
 
-            char display_line[20];
-            char *ptr = display_line;
-
-            for (int byte_idx = 0; byte_idx < 4; byte_idx++) {
-                uint8_t byte = edit_command.data[byte_idx];
-                char nibble_high = "0123456789ABCDEF"[byte >> 4];
-                char nibble_low = "0123456789ABCDEF"[byte & 0x0F];
-
-                if (byte_idx == edit_byte_index) {
-                    if (edit_nibble_index == 0) {
-                        *ptr++ = '[';
-                        *ptr++ = nibble_high;
-                        *ptr++ = ']';
-                        *ptr++ = nibble_low;
-                    } else {
-                        *ptr++ = nibble_high;
-                        *ptr++ = '[';
-                        *ptr++ = nibble_low;
-                        *ptr++ = ']';
-                    }
-                } else {
-                    *ptr++ = nibble_high;
-                    *ptr++ = nibble_low;
-                }
-            }
-            *ptr = '\0';
+// Um quadro: aplica os pedidos acumulados no buffer e envia só o que mudou
+// (uma janela numa única transação ou uma por página suja, o que mover menos bytes)
+static uint32_t compose_frame(uint32_t requests)
+{
+    int64_t start = esp_timer_get_time();
+
+    static oled_screen_input_t input;
+    read_screen_input(&input);
+    oled_screens_compose(&screens, requests, &input);
+    int pages = ssd1306_flush(&dev);
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    redraw_stats.redraws++;
+    redraw_stats.last_us = elapsed;
+    redraw_stats.last_pages = (uint32_t)pages;
+    if (elapsed > redraw_stats.max_us) {
+        redraw_stats.max_us = elapsed;
+    }
+    ESP_LOGD(TAG, "Redraw: %lu us, %d pages sent", (unsigned long)elapsed, pages);
+    return elapsed;
+}
 
-            ssd1306_display_text(&dev, 3, display_line, strlen(display_line), false);
-            ssd1306_display_text(&dev, 4, "                ", 16, false);
-            break;
+void oled_get_redraw_stats(oled_redraw_stats_t *stats)
+{
+    *stats = redraw_stats;
+    stats->requests = atomic_load_explicit(&request_count, memory_order_relaxed);
+}
+
+// Custo de ssd1306_draw_text (atlas de glifos) num dispositivo de rascunho,
+// sem tocar no buffer do display nem no barramento
+void oled_text_bench(uint32_t lines, oled_text_bench_t *result)
+{
+    static SSD1306_t scratch;
+    static const char text[] = "B12:0B507F00 >#*";
+
+    memset(&scratch, 0, sizeof(scratch));
+    scratch._width = OLED_WIDTH;
+    scratch._height = OLED_HEIGHT;
+    scratch._pages = OLED_HEIGHT / 8;
+    scratch._flip = dev._flip;
+
+    // Alterna invertido/normal: todas as palavras da linha mudam
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < lines; i++) {
+        ssd1306_draw_text(&scratch, i % scratch._pages, text, 16, (i / scratch._pages) & 1);
+    }
+    int64_t changed = esp_timer_get_time() - start;
+
+    // Mesmo texto de novo: nada muda
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < lines; i++) {
+        ssd1306_draw_text(&scratch, 0, text, 16, false);
+    }
+    int64_t unchanged = esp_timer_get_time() - start;
+
+    result->lines = lines;
+    result->changed_ns = lines ? (uint32_t)(changed * 1000 / lines) : 0;
+    result->unchanged_ns = lines ? (uint32_t)(unchanged * 1000 / lines) : 0;
+}
+
+static void post_request(uint32_t requests)
+{
+    atomic_fetch_or_explicit(&pending_requests, requests, memory_order_release);
+    atomic_fetch_add_explicit(&request_count, 1, memory_order_relaxed);
+
+    TaskHandle_t task = display_task_handle;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+// Marca páginas como "sujas" sem bloquear: o redesenho acontece em display_task,
+// fora do caminho botão -> MIDI. Pedidos dentro do mesmo quadro geram um único redraw.
+void request_display_pages(uint8_t pages)
+{
+    post_request(pages);
+}
+
+void request_display_update(void)
+{
+    post_request(OLED_PAGES_ALL);
+}
+
+// display_on mudou: a display_task desenha o standby ou a tela atual
+void request_display_power(void)
+{
+    post_request(OLED_REQ_POWER);
+}
+
+void display_task(void *arg)
+{
+    display_task_handle = xTaskGetCurrentTaskHandle();
+    ESP_LOGI(TAG, "Display task started (max %d fps)", CONFIG_OLED_MAX_FPS);
+
+    int64_t last_frame_us = -OLED_FRAME_US;
+    int64_t frame_us = OLED_FRAME_US;
+
+    while (1) {
+        // Pedidos feitos antes da task existir já estão em pending_requests
+        if (atomic_load_explicit(&pending_requests, memory_order_relaxed) == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        // Limita a taxa de quadros; pedidos que chegam durante a espera
+        // entram no mesmo quadro
+        int64_t wait_us = last_frame_us + frame_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            TickType_t ticks = pdMS_TO_TICKS((wait_us + 999) / 1000);
+            vTaskDelay(ticks > 0 ? ticks : 1);
+        }
+
+        uint32_t requests = atomic_exchange_explicit(&pending_requests, 0, memory_order_acquire);
+        if (requests == 0 || !display_initialized) {
+            continue;
+        }
+        last_frame_us = esp_timer_get_time();
+        uint32_t elapsed = compose_frame(requests);
+
+        // Monitor MIDI: quadros contínuos, espaçados para o desenho não
+        // passar de CONFIG_OLED_MONITOR_CPU_PERCENT do core
+        frame_us = OLED_FRAME_US;
+        if (ui_state_get().mode == MODE_MONITOR && display_on) {
+            int64_t budget_us = (int64_t)elapsed * 100 / CONFIG_OLED_MONITOR_CPU_PERCENT;
+            if (budget_us > frame_us) {
+                frame_us = budget_us;
+            }
+            atomic_fetch_or_explicit(&pending_requests, OLED_PAGES_ALL, memory_order_relaxed);
+        }
     }
 }
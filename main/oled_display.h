@@ -1,3 +1,28 @@
 #pragma once
+#include <stdint.h>
+
+typedef struct {
+    uint32_t redraws;       // quadros desenhados
+    uint32_t requests;      // pedidos recebidos (vários por quadro se coalescidos)
+    uint32_t last_us;       // último redesenho (buffer + enfileirar a transferência I2C)
+    uint32_t max_us;
+    uint32_t last_pages;    // páginas enviadas no último redesenho
+} oled_redraw_stats_t;
+
+// Páginas do display para request_display_pages (bit n = página n)
+#define OLED_PAGES_ALL      0xFF
+#define OLED_PAGES_LIST     0x7C    // linhas 2..6: lista de botões / corpo da tela
+
+typedef struct {
+    uint32_t lines;
+    uint32_t changed_ns;    // por linha de 16 caracteres, todas as palavras mudam
+    uint32_t unchanged_ns;  // por linha, só a comparação com o buffer
+} oled_text_bench_t;
+
 void init_oled(void);
-void update_display_partial(void);
+void request_display_update(void);
+void request_display_pages(uint8_t pages);
+void request_display_power(void);
+void display_task(void *arg);
+void oled_get_redraw_stats(oled_redraw_stats_t *stats);
+void oled_text_bench(uint32_t lines, oled_text_bench_t *result);
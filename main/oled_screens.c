@@ -0,0 +1,186 @@
+//oled_screens.c
+#include "oled_screens.h"
+#include "midi_ui_format.h"
+#include <stdio.h>
+#include <string.h>
+
+// Só desenha as linhas das páginas pedidas neste quadro
+static void draw_line(oled_screens_t *s, int page, const char *text, int text_len)
+{
+    if (s->frame_pages & (1u << page)) {
+        ssd1306_draw_text(s->dev, page, text, text_len, false);
+    }
+}
+
+static void draw_normal_page(oled_screens_t *s, const oled_screen_input_t *in)
+{
+    draw_line(s, 0, "BUTTON CONFIG   ", 16);
+    draw_line(s, 1, "----------------", 16);
+
+    for (int i = 0; i < VISIBLE_BUTTONS; i++) {
+        int button_index = in->ui.scroll_offset + i;
+        char button_line[18];
+
+        if (button_index < BUTTON_COUNT) {
+            size_t len = midi_format_button_line(button_line, button_index, in->commands[button_index].data,
+                                                 button_index == in->ui.button);
+            draw_line(s, 2 + i, button_line, (int)len);
+        } else {
+            draw_line(s, 2 + i, "                ", 16);
+        }
+    }
+    draw_line(s, 7, "*:Edit          ", 16);
+}
+
+static void draw_edit_page(oled_screens_t *s, const oled_screen_input_t *in)
+{
+    if (!*in->edit_initialized) {
+        // Entrada no modo de edição: a tela inteira muda
+        s->frame_pages = OLED_PAGES_ALL;
+        char title[24];
+        snprintf(title, sizeof(title), "Edit BT %-8d", in->ui.button + 1);
+        draw_line(s, 0, title, 16);
+        draw_line(s, 1, "----------------", 16);
+
+        draw_line(s, 5, "Up/Dn:Change    ", 16);
+        draw_line(s, 6, "*:Next #:Save   ", 16);
+        draw_line(s, 7, "Hold#:Cancel    ", 16);
+
+        *in->edit_initialized = true;
+        draw_line(s, 2, "                ", 16);
+        draw_line(s, 3, "                ", 16);
+        draw_line(s, 4, "                ", 16);
+    }
+
+    char display_line[20];
+    size_t len = midi_format_edit_line(display_line, in->edit_command.data, in->edit_byte_index,
+                                       in->edit_nibble_index);
+    draw_line(s, 3, display_line, (int)len);
+    draw_line(s, 4, "                ", 16);
+}
+
+// Página de latência: borda do footswitch -> cada estágio, p50/p99/max
+static void draw_stats_page(oled_screens_t *s, const oled_screen_input_t *in)
+{
+    static const char *const stage_labels[MIDI_LAT_STAGE_COUNT] = { "RTR ", "DEQ ", "SUB ", "CMP " };
+
+    draw_line(s, 0, "LATENCY ms      ", 16);
+    draw_line(s, 1, "     p50 p99 max", 16);
+
+    for (int stage = 0; stage < MIDI_LAT_STAGE_COUNT; stage++) {
+        const midi_latency_summary_t *sum = &in->latency[stage];
+
+        char line[17];
+        char p50[5], p99[5], max[5];
+        midi_format_latency_ms(p50, sum->p50_us);
+        midi_format_latency_ms(p99, sum->p99_us);
+        midi_format_latency_ms(max, sum->max_us);
+        snprintf(line, sizeof(line), "%s%s%s%s", stage_labels[stage], p50, p99, max);
+        draw_line(s, 2 + stage, line, 16);
+    }
+
+    char count_line[17];
+    snprintf(count_line, sizeof(count_line), "n=%-14lu", (unsigned long)in->latency[MIDI_LAT_ROUTER].count);
+    draw_line(s, 6, count_line, 16);
+    draw_line(s, 7, "#:Bk *:Rst \x02:Mon", 16);
+}
+
+// Monitor de atividade MIDI: mensagens/s por porta, últimos eventos e uma
+// barra por canal, a partir do snapshot dos contadores
+static void draw_monitor_page(oled_screens_t *s, const oled_screen_input_t *in)
+{
+    const midi_monitor_snapshot_t *snap = &in->monitor;
+
+    // Taxas recalculadas a cada segundo
+    int64_t elapsed_us = in->now_us - s->monitor.rate_time_us;
+    if (elapsed_us >= 1000000) {
+        for (int port = 0; port < MIDI_MON_PORT_COUNT; port++) {
+            uint32_t delta = snap->messages[port] - s->monitor.rate_base[port];
+            // Primeiro quadro depois de um tempo fora da página: só reinicia a base
+            s->monitor.rate[port] = elapsed_us < 2000000 ? (uint32_t)((uint64_t)delta * 1000000 / elapsed_us) : 0;
+            s->monitor.rate_base[port] = snap->messages[port];
+        }
+        s->monitor.rate_time_us = in->now_us;
+    }
+
+    char line[17];
+    char a[6], b[6];
+    midi_format_rate(a, s->monitor.rate[MIDI_MON_USB_RX]);
+    midi_format_rate(b, s->monitor.rate[MIDI_MON_DIN_IN]);
+    snprintf(line, sizeof(line), "RX U%s D%s", a, b);
+    draw_line(s, 0, line, 16);
+    midi_format_rate(a, s->monitor.rate[MIDI_MON_USB_TX]);
+    midi_format_rate(b, s->monitor.rate[MIDI_MON_DIN_OUT]);
+    snprintf(line, sizeof(line), "TX U%s D%s", a, b);
+    draw_line(s, 1, line, 16);
+
+    static const char *const port_labels[MIDI_MON_PORT_COUNT] = { "UR", "UT", "DI", "DO" };
+    for (int port = 0; port < MIDI_MON_PORT_COUNT; port++) {
+        midi_format_event_line(line, port_labels[port], snap->last[port], snap->last_count[port]);
+        draw_line(s, 2 + port, line, 16);
+    }
+
+    // Página 6: uma barra de 7 px por canal (1..16), sobe com atividade e
+    // cai 1 px por quadro
+    if (s->frame_pages & (1u << 6)) {
+        uint8_t bars[128];
+        for (int ch = 0; ch < 16; ch++) {
+            uint32_t delta = snap->channel_messages[ch] - s->monitor.channel_prev[ch];
+            s->monitor.channel_prev[ch] = snap->channel_messages[ch];
+
+            uint8_t level = s->monitor.channel_level[ch] > 0 ? s->monitor.channel_level[ch] - 1 : 0;
+            if (delta > 0) {
+                uint8_t target = delta >= 4 ? 8 : (uint8_t)(4 + delta);
+                if (target > level) level = target;
+            }
+            s->monitor.channel_level[ch] = level;
+
+            // Bit 7 é a linha de baixo da página
+            uint8_t column = (uint8_t)(0xFF << (8 - level));
+            memset(&bars[ch * 8], column, 7);
+            bars[ch * 8 + 7] = 0;
+        }
+        if (s->dev->_flip) {
+            ssd1306_flip(bars, sizeof(bars));
+        }
+        ssd1306_draw_image(s->dev, 6, 0, bars, sizeof(bars));
+    }
+
+    draw_line(s, 7, "\x01:Lat  #:Back   ", 16);
+}
+
+void oled_screens_compose(oled_screens_t *s, uint32_t requests, const oled_screen_input_t *in)
+{
+    if (requests & OLED_REQ_POWER) {
+        // Standby/volta: parte de uma tela limpa
+        for (int page = 0; page < s->dev->_pages; page++) {
+            ssd1306_draw_text(s->dev, page, "                ", 16, false);
+        }
+        if (in->display_on) {
+            *in->edit_initialized = false;
+            requests |= OLED_PAGES_ALL;
+        } else {
+            ssd1306_draw_text(s->dev, 3, "   STANDBY...   ", 16, false);
+        }
+    }
+
+    if (!in->display_on || !(requests & OLED_PAGES_ALL)) {
+        return;
+    }
+    s->frame_pages = (uint8_t)(requests & OLED_PAGES_ALL);
+
+    switch (in->ui.mode) {
+        case MODE_NORMAL:
+            draw_normal_page(s, in);
+            break;
+        case MODE_EDIT:
+            draw_edit_page(s, in);
+            break;
+        case MODE_STATS:
+            draw_stats_page(s, in);
+            break;
+        case MODE_MONITOR:
+            draw_monitor_page(s, in);
+            break;
+    }
+}
@@ -0,0 +1,50 @@
+//oled_screens.h
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "ssd1306.h"
+#include "globals.h"
+#include "oled_display.h"
+#include "midi_command.h"
+#include "midi_latency.h"
+#include "midi_monitor.h"
+
+// Composição das telas no buffer do SSD1306 (só RAM, nada vai para o
+// barramento). Não usa FreeRTOS nem lê globais: tudo o que a tela mostra
+// chega em oled_screen_input_t. Compila no firmware (oled_display.c) e no
+// host (host/oled_emu.c), que confere os quadros contra um golden.
+
+// Pedido de standby/volta (display_on mudou), junto com as páginas
+#define OLED_REQ_POWER      (1u << 8)
+
+// O que um quadro mostra. Só os campos do modo atual precisam estar
+// preenchidos (commands no NORMAL, latency no STATS, monitor no MONITOR).
+typedef struct {
+    ui_state_t ui;                                      // modo, cursor e rolagem
+    bool display_on;
+    bool *edit_initialized;                             // false: redesenha a tela de edição inteira
+    midi_command_t commands[BUTTON_COUNT];
+    midi_command_t edit_command;
+    int edit_byte_index;
+    int edit_nibble_index;
+    midi_latency_summary_t latency[MIDI_LAT_STAGE_COUNT];
+    midi_monitor_snapshot_t monitor;
+    int64_t now_us;                                     // relógio das taxas do monitor
+} oled_screen_input_t;
+
+// Estado entre quadros
+typedef struct {
+    SSD1306_t *dev;
+    uint8_t frame_pages;                        // páginas redesenhadas no quadro atual
+    struct {
+        int64_t rate_time_us;
+        uint32_t rate_base[MIDI_MON_PORT_COUNT];
+        uint32_t rate[MIDI_MON_PORT_COUNT];     // mensagens/s
+        uint32_t channel_prev[16];
+        uint8_t channel_level[16];              // altura da barra, 0..8 px
+    } monitor;
+} oled_screens_t;
+
+// Aplica os pedidos (páginas OLED_PAGES_* e/ou OLED_REQ_POWER) ao buffer de
+// s->dev. O envio fica com quem chama (ssd1306_flush).
+void oled_screens_compose(oled_screens_t *s, uint32_t requests, const oled_screen_input_t *in);
@@ -2,7 +2,7 @@
 #include "globals.h"
 #include "esp_log.h"
 #include "esp_pm.h"
-#include "ssd1306.h"
+#include "oled_display.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <stdio.h>
@@ -47,17 +47,10 @@ void display_power_save(bool enable)
 {
     if (!display_initialized) return;
 
-    if (enable) {
-        ssd1306_clear_screen(&dev, false);
-        update_display_partial();
-        display_on = true;
-        ESP_LOGI(TAG, " Display ON - Standby exited");
-    } else {
-        ssd1306_clear_screen(&dev, false);
-        ssd1306_display_text(&dev, 3, "   STANDBY...   ", 16, false);
-        display_on = false;
-        ESP_LOGI(TAG, " Display OFF - Standby mode");
-    }
+    // O desenho fica com a display_task (dona do SSD1306)
+    display_on = enable;
+    request_display_power();
+    ESP_LOGI(TAG, enable ? " Display ON - Standby exited" : " Display OFF - Standby mode");
 }
 
 void update_cpu_activity_time(void) {
@@ -96,10 +89,16 @@ void power_management_task(void *arg)
         }
 
         if (display_inactive_ms > 15000 && display_on) {
-            if (current_mode == MODE_EDIT) {
-                ESP_LOGI(TAG, "🖥️ AUTO-CANCEL EDIT MODE (standby timeout)");
-                current_mode = MODE_NORMAL;
-                edit_initialized = false;
+            // Só cancela se ainda estiver editando no snapshot que for trocado
+            ui_state_t ui = ui_state_get();
+            while (ui.mode == MODE_EDIT) {
+                ui_state_t next = ui;
+                next.mode = MODE_NORMAL;
+                if (ui_state_replace(&ui, next)) {
+                    ESP_LOGI(TAG, "🖥️ AUTO-CANCEL EDIT MODE (standby timeout)");
+                    edit_initialized = false;
+                    break;
+                }
             }
             ESP_LOGI(TAG, "🖥️ DISPLAY STANDBY (no navigation)");
             display_power_save(false);